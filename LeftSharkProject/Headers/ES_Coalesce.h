@@ -0,0 +1,71 @@
+/****************************************************************************
+ Module
+     ES_Coalesce.h
+ Description
+     header file for the event coalescers of the Events & Services framework
+ Notes
+     A coalescer sits between a high-rate interrupt source and the service
+     that it posts to. Instead of one event per byte (or per edge), the
+     interrupt response hands its data to the coalescer, which keeps it in
+     a ring and only posts an event when it does not already have one
+     waiting in the service's queue. The service then takes everything that
+     has built up since, so it sees one event per burst and the burst costs
+     one queue slot however long it is.
+
+     A coalescer without a ring just counts, for sources that have no data
+     to pass on.
+
+     There must be only one producer (one interrupt response, on the same
+     core as the framework) and the consumer must be the service that the
+     event goes to:
+
+       static uint8_t RxBytes[64];     // must be a power of 2
+       static ES_Coalescer_t RxCoalescer;
+
+       init:  ES_InitCoalescer( &RxCoalescer, MyPriority, ES_RX_BYTES,
+                                RxBytes, sizeof(RxBytes) );
+       ISR:   ES_CoalescePostISR( &RxCoalescer, NewByte );
+       run:   case ES_RX_BYTES:
+                while ( (n = ES_CoalesceTake( &RxCoalescer, Buf,
+                                              sizeof(Buf) )) != 0 ) ...
+
+     The event is posted with ES_PostToServiceISR, so the service must have
+     an ISR queue attached. Its EventParam is not used. The service may
+     find nothing to take when it gets the event, if it already took the
+     data while handling an earlier one.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/17/26 18:00 afb      started coding
+*****************************************************************************/
+
+#ifndef ES_Coalesce_H
+#define ES_Coalesce_H
+
+#include "ES_Configure.h"
+#include "ES_Types.h"
+#include "ES_Events.h"
+#include "ES_Port.h"
+
+typedef struct {
+    ES_Atomic16_t Head;    // count of items taken, written by the consumer
+    ES_Atomic16_t Tail;    // count of items added, written by the producer
+    ES_Atomic16_t Pending; // 1 while an event is on its way to the service
+    uint8_t * pData;       // the ring, NULL for a counting coalescer
+    uint16_t Mask;         // ring size - 1
+    uint16_t NumDropped;   // items lost because the ring was full
+    uint16_t NumPosted;    // events posted, one per burst
+    uint8_t WhichService;
+    ES_EventTyp_t EventType;
+}ES_Coalescer_t;
+
+// public functions
+bool ES_InitCoalescer( ES_Coalescer_t * pCoal, uint8_t WhichService,
+                       ES_EventTyp_t EventType, uint8_t * pData,
+                       uint16_t DataSize );
+bool ES_CoalescePostISR( ES_Coalescer_t * pCoal, uint8_t Data );
+uint16_t ES_CoalesceTake( ES_Coalescer_t * pCoal, uint8_t * pDest,
+                          uint16_t MaxItems );
+
+#endif /* ES_Coalesce_H */
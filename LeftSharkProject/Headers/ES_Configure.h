@@ -9,6 +9,25 @@
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/17/26 21:30 afb      added ES_LOG_LEVEL, ES_LOG_SIZE and LOG_MESSAGE_LIST
+ 10/17/26 21:00 afb      added ES_ENABLE_TRACE and ES_TRACE_SIZE
+ 10/17/26 20:30 afb      added ES_ENABLE_SIM and ES_SIM_MAX_STIMULI
+ 10/17/26 20:00 afb      added ES_ENABLE_NODES and SERVICE_CONTEXT_LIST
+ 10/17/26 19:30 afb      added ES_ENABLE_THREADS and ES_NUM_THREADS
+ 10/17/26 19:00 afb      added ES_ENABLE_PREEMPTION
+ 10/17/26 18:30 afb      added ES_ENABLE_EDF
+ 10/17/26 18:00 afb      added ES_RX_BYTES
+ 10/17/26 17:30 afb      ES_PACKET_RECEIVED is published, not sent to DIST_LIST0
+ 10/17/26 17:00 afb      added ES_ENABLE_STATIC_DISPATCH
+ 10/17/26 15:00 afb      added the payload buffers and ES_PACKET_RECEIVED
+ 10/17/26 14:30 afb      added ES_NUM_SHORT_TIMERS
+ 10/17/26 13:00 afb      added ES_NUM_TIMERS
+ 10/17/26 12:30 afb      added ES_ENABLE_TICKLESS_IDLE
+ 10/17/26 12:00 afb      added ES_ENABLE_QUEUE_STATS and ES_NUM_EVENT_TYPES
+ 10/17/26 11:30 afb      added ES_ENABLE_PROFILING
+ 10/17/26 11:00 afb      added the burst limit & batch function columns
+ 10/17/26 10:30 afb      replaced the 16 numbered service blocks with the
+                         SERVICE_LIST table and raised MAX_NUM_SERVICES to 256
   10/11/15 18:00 jec      added new event type ES_SHORT_TIMEOUT
   10/21/13 20:54 jec      lots of added entries to bring the number of timers
                          and services up to 16 each
@@ -23,228 +42,193 @@
 
 /****************************************************************************/
 // The maximum number of services sets an upper bound on the number of 
-// services that the framework will handle. Reasonable values are 8 and 16
-// corresponding to an 8-bit(uint8_t) and 16-bit(uint16_t) Ready variable size
-#define MAX_NUM_SERVICES 16
+// services that the framework will handle. The Ready set is kept as a two
+// level bitmap (16 groups of 16 services), so any value up to 256 will work
+#define MAX_NUM_SERVICES 256
 
 /****************************************************************************/
-// This macro determines that nuber of services that are *actually* used in
-// a particular application. It will vary in value from 1 to MAX_NUM_SERVICES
-#define NUM_SERVICES 2
+// This is the list of the services that are *actually* used in a particular
+// application, with one SERVICE() entry per service. The first entry, at
+// index 0, is the lowest priority, with increasing priority with each entry
+// after it. Every Events and Services application must have a Service 0.
+// Each entry is:
+//   SERVICE( the name of the Init function,
+//            the name of the Run function,
+//            How big should this services Queue be?,
+//            How many events may it take per burst? (see ES_ENABLE_BURST_DRAIN),
+//            the name of the batch run function, or NO_BATCH_FUNC )
+// The header files with the public function prototypes for the services are
+// listed in ES_ServiceHeaders.h
+#define SERVICE_LIST(SERVICE) \
+  SERVICE( InitRxSM,     RunRxSM,     5,  5,  NO_BATCH_FUNC ) \
+  SERVICE( InitMapKeys,  RunMapKeys,  3,  1,  NO_BATCH_FUNC )
 
-/****************************************************************************/
-// These are the definitions for Service 0, the lowest priority service.
-// Every Events and Services application must have a Service 0. Further 
-// services are added in numeric sequence (1,2,3,...) with increasing 
-// priorities
-// the header file with the public function prototypes
-#define SERV_0_HEADER "RxSM.h"
-// the name of the Init function
-#define SERV_0_INIT InitRxSM
-// the name of the run function
-#define SERV_0_RUN RunRxSM
-// How big should this services Queue be?
-#define SERV_0_QUEUE_SIZE 5
+#define NO_BATCH_FUNC ((BatchRunFunc_t *)0)
 
 /****************************************************************************/
-// The following sections are used to define the parameters for each of the
-// services. You only need to fill out as many as the number of services 
-// defined by NUM_SERVICES
-/****************************************************************************/
-// These are the definitions for Service 1
-#if NUM_SERVICES > 1
-// the header file with the public function prototypes
-#define SERV_1_HEADER "MapKeys.h"
-// the name of the Init function
-#define SERV_1_INIT InitMapKeys
-// the name of the run function
-#define SERV_1_RUN RunMapKeys
-// How big should this services Queue be?
-#define SERV_1_QUEUE_SIZE 3
-#endif
+// With ES_ENABLE_BURST_DRAIN defined, ES_Run lets the service that it selects
+// drain up to its burst limit of events before it processes pending
+// interrupts and looks for a higher priority service again. A service with
+// a batch run function gets the whole burst in one call, as a contiguous
+// array: ES_Event RunBatch( ES_Event const * pEvents, uint8_t NumEvents )
+// ES_MAX_BURST caps the burst limits and sizes the array.
+// Comment out the ES_ENABLE_BURST_DRAIN define to dispatch one event per
+// selection.
+//#define ES_ENABLE_BURST_DRAIN
+#define ES_MAX_BURST 8
 
 /****************************************************************************/
-// These are the definitions for Service 2
-#if NUM_SERVICES > 2
-// the header file with the public function prototypes
-#define SERV_2_HEADER "TestHarnessService2.h"
-// the name of the Init function
-#define SERV_2_INIT InitTestHarnessService2
-// the name of the run function
-#define SERV_2_RUN RunTestHarnessService2
-// How big should this services Queue be?
-#define SERV_2_QUEUE_SIZE 3
-#endif
+// With ES_ENABLE_STATIC_DISPATCH defined, ES_Run calls the run functions by
+// name, from a switch on the service number generated from SERVICE_LIST,
+// rather than through the function pointers in ServDescList. The compiler
+// can then inline the run functions (given cross-module optimization). The
+// TEST harness in ES_Framework.c times the two against each other.
+//#define ES_ENABLE_STATIC_DISPATCH
 
 /****************************************************************************/
-// These are the definitions for Service 3
-#if NUM_SERVICES > 3
-// the header file with the public function prototypes
-#define SERV_3_HEADER "TestHarnessService3.h"
-// the name of the Init function
-#define SERV_3_INIT InitTestHarnessService3
-// the name of the run function
-#define SERV_3_RUN RunTestHarnessService3
-// How big should this services Queue be?
-#define SERV_3_QUEUE_SIZE 3
-#endif
+// With ES_ENABLE_EDF defined, every posted event carries a deadline in
+// ES_Timer ticks and ES_Run dispatches to the ready service whose next event
+// is due first (earliest deadline first) rather than to the highest
+// priority one. ES_PostToServiceDeadline sets the deadline, every other post
+// uses ES_EDF_DEFAULT_DEADLINE (less than 32768). Events that are dispatched
+// late are counted, see ES_GetDeadlineMisses. With it commented out, the
+// deadlines are ignored and the static priority dispatch is unchanged.
+//#define ES_ENABLE_EDF
+#define ES_EDF_DEFAULT_DEADLINE 1000
 
 /****************************************************************************/
-// These are the definitions for Service 4
-#if NUM_SERVICES > 4
-// the header file with the public function prototypes
-#define SERV_4_HEADER "TestHarnessService4.h"
-// the name of the Init function
-#define SERV_4_INIT InitTestHarnessService4
-// the name of the run function
-#define SERV_4_RUN RunTestHarnessService4
-// How big should this services Queue be?
-#define SERV_4_QUEUE_SIZE 3
-#endif
+// With ES_ENABLE_PREEMPTION defined, a post that makes a service ready
+// that is higher priority than the one running runs it at once, nested on
+// the same stack above the lower one, instead of after the lower one
+// returns to ES_Run. Posts from interrupt responses get there through
+// PendSV as the interrupts unwind. The run functions must then not share
+// data with higher priority services without a critical region or
+// ES_SchedLock. It can not be used with ES_ENABLE_EDF. With it commented
+// out, a service always runs to completion before ES_Run picks the next.
+//#define ES_ENABLE_PREEMPTION
 
 /****************************************************************************/
-// These are the definitions for Service 5
-#if NUM_SERVICES > 5
-// the header file with the public function prototypes
-#define SERV_5_HEADER "TestHarnessService5.h"
-// the name of the Init function
-#define SERV_5_INIT InitTestHarnessService5
-// the name of the run function
-#define SERV_5_RUN RunTestHarnessService5
-// How big should this services Queue be?
-#define SERV_5_QUEUE_SIZE 3
-#endif
+// With ES_ENABLE_THREADS defined, which is only for the host build
+// (ES_PORT_POSIX), each service runs on a thread of its own and is posted
+// to through a lock-free mailbox, so that a ground station can spread the
+// services across cores. ES_PostToService may then be called from any
+// thread. A service still gets one event at a time, so its run function
+// needs no locks of its own, but services no longer run one after the
+// other and must not share data without a critical region. ES_NUM_THREADS
+// sets how many threads there are, service n runs on thread
+// n % ES_NUM_THREADS, and 0 gives one per service. It can not be used with
+// ES_ENABLE_BURST_DRAIN, ES_ENABLE_EDF, ES_ENABLE_PREEMPTION or
+// ES_ENABLE_QUEUE_STATS. With it commented out, ES_Run runs every service
+// on the one thread.
+//#define ES_ENABLE_THREADS
+#define ES_NUM_THREADS 0
 
 /****************************************************************************/
-// These are the definitions for Service 6
-#if NUM_SERVICES > 6
-// the header file with the public function prototypes
-#define SERV_6_HEADER "TestHarnessService6.h"
-// the name of the Init function
-#define SERV_6_INIT InitTestHarnessService6
-// the name of the run function
-#define SERV_6_RUN RunTestHarnessService6
-// How big should this services Queue be?
-#define SERV_6_QUEUE_SIZE 3
-#endif
-
-/****************************************************************************/
-// These are the definitions for Service 7
-#if NUM_SERVICES > 7
-// the header file with the public function prototypes
-#define SERV_7_HEADER "TestHarnessService7.h"
-// the name of the Init function
-#define SERV_7_INIT InitTestHarnessService7
-// the name of the run function
-#define SERV_7_RUN RunTestHarnessService7
-// How big should this services Queue be?
-#define SERV_7_QUEUE_SIZE 3
-#endif
+// With ES_ENABLE_NODES defined, which is only for the host build
+// (ES_PORT_POSIX), the framework and the services keep their variables in a
+// context per node rather than in statics, so that one process can simulate
+// thousands of nodes, each with its own queues, timers and service states,
+// stepped on a pool of threads (see ES_Nodes.h). Every service that keeps
+// state must put it in a struct through ES_CONTEXT_VARS (ES_Context.h) and
+// be named in SERVICE_CONTEXT_LIST. It can not be used with
+// ES_ENABLE_THREADS, ES_ENABLE_PREEMPTION, ES_ENABLE_PROFILING or
+// ES_ENABLE_TICKLESS_IDLE.
+//#define ES_ENABLE_NODES
+#define SERVICE_CONTEXT_LIST(VARS) \
+  VARS( RxSM ) \
+  VARS( MapKeys )
 
 /****************************************************************************/
-// These are the definitions for Service 8
-#if NUM_SERVICES > 8
-// the header file with the public function prototypes
-#define SERV_8_HEADER "TestHarnessService8.h"
-// the name of the Init function
-#define SERV_8_INIT InitTestHarnessService8
-// the name of the run function
-#define SERV_8_RUN RunTestHarnessService8
-// How big should this services Queue be?
-#define SERV_8_QUEUE_SIZE 3
-#endif
+// With ES_ENABLE_SIM defined, which is only for the host build
+// (ES_PORT_POSIX), there is no real tick: ES_SimRun (ES_Sim.h) moves the
+// time straight on to the next timer expiry or scheduled stimulus, so hours
+// of protocol time run in seconds and every run of a simulation gives the
+// same results, tick for tick. The event checkers are not run, stimuli take
+// their place. ES_SIM_MAX_STIMULI is how many stimuli may be waiting at
+// once. It can not be used with ES_ENABLE_THREADS, ES_ENABLE_PREEMPTION,
+// ES_ENABLE_TICKLESS_IDLE or ES_ENABLE_NODES.
+//#define ES_ENABLE_SIM
+#define ES_SIM_MAX_STIMULI 64
 
 /****************************************************************************/
-// These are the definitions for Service 9
-#if NUM_SERVICES > 9
-// the header file with the public function prototypes
-#define SERV_9_HEADER "TestHarnessService9.h"
-// the name of the Init function
-#define SERV_9_INIT InitTestHarnessService9
-// the name of the run function
-#define SERV_9_RUN RunTestHarnessService9
-// How big should this services Queue be?
-#define SERV_9_QUEUE_SIZE 3
-#endif
+// With ES_ENABLE_PROFILING defined, the framework times every call to a run
+// function and how long each event waited in its queue, per service (see
+// ES_Profile.h). This adds a 32-bit time stamp to every ES_Event. With it
+// commented out, the hooks compile out completely.
+//#define ES_ENABLE_PROFILING
 
 /****************************************************************************/
-// These are the definitions for Service 10
-#if NUM_SERVICES > 10
-// the header file with the public function prototypes
-#define SERV_10_HEADER "TestHarnessService10.h"
-// the name of the Init function
-#define SERV_10_INIT InitTestHarnessService10
-// the name of the run function
-#define SERV_10_RUN RunTestHarnessService10
-// How big should this services Queue be?
-#define SERV_10_QUEUE_SIZE 3
-#endif
+// With ES_ENABLE_QUEUE_STATS defined, the post functions keep a high-water
+// depth, a count of posts and a count of failed posts by event type for
+// every service's queue. Read them with ES_GetQueueStats (ES_Framework.h)
+// to size the queues in SERVICE_LIST from data.
+//#define ES_ENABLE_QUEUE_STATS
 
 /****************************************************************************/
-// These are the definitions for Service 11
-#if NUM_SERVICES > 11
-// the header file with the public function prototypes
-#define SERV_11_HEADER "TestHarnessService11.h"
-// the name of the Init function
-#define SERV_11_INIT InitTestHarnessService11
-// the name of the run function
-#define SERV_11_RUN RunTestHarnessService11
-// How big should this services Queue be?
-#define SERV_11_QUEUE_SIZE 3
-#endif
+// With ES_ENABLE_TRACE defined, every post, dispatch and timeout is written
+// to a ring of the last ES_TRACE_SIZE records (a power of 2, 12 bytes each)
+// that keeps its contents across a reset. ES_TraceDump (ES_Trace.h) sends it
+// over the console in binary, Tools/ES_TraceDecode.c turns that into a
+// timeline. It can not be used with ES_ENABLE_NODES.
+//#define ES_ENABLE_TRACE
+#define ES_TRACE_SIZE 128
 
 /****************************************************************************/
-// These are the definitions for Service 12
-#if NUM_SERVICES > 12
-// the header file with the public function prototypes
-#define SERV_12_HEADER "TestHarnessService12.h"
-// the name of the Init function
-#define SERV_12_INIT InitTestHarnessService12
-// the name of the run function
-#define SERV_12_RUN RunTestHarnessService12
-// How big should this services Queue be?
-#define SERV_12_QUEUE_SIZE 3
-#endif
+// ES_LOG_LEVEL picks the log statements (ES_Log.h) that are compiled:
+// ES_LOG_LEVEL_NONE, _ERROR, _WARN, _INFO or _DEBUG, each with the ones
+// before it. The rest compile out. A logged message takes a word, and a
+// word per argument, of a ring of ES_LOG_SIZE words (a power of 2) until
+// ES_Run sends it. Room for the longest packet that RxSM logs, a byte at
+// a time, is 2 * LONGEST_PACKET_LENGTH words.
+#define ES_LOG_LEVEL ES_LOG_LEVEL_INFO
+#define ES_LOG_SIZE 512
 
 /****************************************************************************/
-// These are the definitions for Service 13
-#if NUM_SERVICES > 13
-// the header file with the public function prototypes
-#define SERV_13_HEADER "TestHarnessService13.h"
-// the name of the Init function
-#define SERV_13_INIT InitTestHarnessService13
-// the name of the run function
-#define SERV_13_RUN RunTestHarnessService13
-// How big should this services Queue be?
-#define SERV_13_QUEUE_SIZE 3
-#endif
+// The messages for the log, one MESSAGE() per format, with the name that
+// the log statements use. Only the number of the message and its arguments
+// are kept, the formats are only compiled into Tools/ES_LogDecode.c. The
+// arguments are 32-bit integers, so use only %x, %u, %i, %c and the like.
+#define LOG_MESSAGE_LIST(MESSAGE) \
+  MESSAGE( LOG_RX_PACKET_BYTE,       "\n\r%x" ) \
+  MESSAGE( LOG_RX_PACKET_END,        "\n\rEOT*****************\n\n\r" ) \
+  MESSAGE( LOG_RX_OVERRUN_ERROR,     "\n\rOverRun Error in UART Rx : Connection Lost" ) \
+  MESSAGE( LOG_RX_BREAK_ERROR,       "\n\rBreak Error in UART Rx : Connection Lost" ) \
+  MESSAGE( LOG_RX_PARITY_ERROR,      "\n\rParity Error in UART Rx : Connection Lost" ) \
+  MESSAGE( LOG_RX_FRAMING_ERROR,     "\n\rFraming Error in UART Rx : Connection Lost" ) \
+  MESSAGE( LOG_RX_INIT,              "\n\rInit to WaitFor0x7E State" ) \
+  MESSAGE( LOG_RX_GOOD_START,        "\n\rGood Start Delimiter:   WaitFor0x7E --> WaitForMSBLen State" ) \
+  MESSAGE( LOG_RX_GOOD_MSB,          "\n\rGood MSB:   WaitForMSBLen --> WaitForLSBLen State" ) \
+  MESSAGE( LOG_RX_MSB_TIMEOUT,       "\n\rTimeout:    WaitForMSBLen --> WaitFor0x7E State" ) \
+  MESSAGE( LOG_RX_MSB_UART_ERROR,    "\n\rUART Error:  WaitForMSB --> WaitFor0x7E State" ) \
+  MESSAGE( LOG_RX_GOOD_LSB,          "\n\rGood LSB:   WaitForLSBLen --> ReadDataPacket State" ) \
+  MESSAGE( LOG_RX_LSB_TIMEOUT,       "\n\rTimeout:  WaitForLSB --> WaitFor0x7E State" ) \
+  MESSAGE( LOG_RX_LSB_UART_ERROR,    "\n\rUART Error:  WaitForMLSB --> WaitFor0x7E State" ) \
+  MESSAGE( LOG_RX_READ_ENTERED,      "\n\rEntered ReadDataPacket" ) \
+  MESSAGE( LOG_RX_DATA_BYTE,         "    DataByte Read = %i" ) \
+  MESSAGE( LOG_RX_BYTES_LEFT,        "    BytesLeft = %i" ) \
+  MESSAGE( LOG_RX_CHECKSUM,          "\n\rRead CheckSum = %i" ) \
+  MESSAGE( LOG_RX_CHECKSUM_MISMATCH, "\n\rChkSum Mismatch:  ReadDataPacket --> WaitFor0x7E State" ) \
+  MESSAGE( LOG_RX_PACKET_RECEIVED,   "\n\rPacket Received" ) \
+  MESSAGE( LOG_RX_PACKET_COMPLETE,   "\n\rPacket Complete: Head to WaitFor0x7E State" ) \
+  MESSAGE( LOG_RX_READ_TIMEOUT,      "\n\rTimeout:  ReadDataPacket --> WaitFor0x7E State" ) \
+  MESSAGE( LOG_RX_READ_UART_ERROR,   "\n\rUART Error: ReadDataPacket --> WaitFor0x7E State" )
 
 /****************************************************************************/
-// These are the definitions for Service 14
-#if NUM_SERVICES > 14
-// the header file with the public function prototypes
-#define SERV_14_HEADER "TestHarnessService14.h"
-// the name of the Init function
-#define SERV_14_INIT InitTestHarnessService14
-// the name of the run function
-#define SERV_14_RUN RunTestHarnessService14
-// How big should this services Queue be?
-#define SERV_14_QUEUE_SIZE 3
-#endif
+// With ES_ENABLE_TICKLESS_IDLE defined, when ES_Run finds nothing to do the
+// port stops the tick, sleeps (WFI on the target) until the next ES_Timer
+// is due or some other interrupt arrives, and then credits the ticks that it
+// skipped. The event checkers only run when something wakes the processor,
+// so ES_TICKLESS_MAX_IDLE_TICKS limits how long a sleep may be, to bound
+// the latency of checkers that poll hardware without an interrupt (like
+// Check4Keystroke).
+//#define ES_ENABLE_TICKLESS_IDLE
+#define ES_TICKLESS_MAX_IDLE_TICKS 100
 
 /****************************************************************************/
-// These are the definitions for Service 15
-#if NUM_SERVICES > 15
-// the header file with the public function prototypes
-#define SERV_15_HEADER "TestHarnessService15.h"
-// the name of the Init function
-#define SERV_15_INIT InitTestHarnessService15
-// the name of the run function
-#define SERV_15_RUN RunTestHarnessService15
-// How big should this services Queue be?
-#define SERV_15_QUEUE_SIZE 3
-#endif
-
+// The number of services is counted from SERVICE_LIST, it will vary in value
+// from 1 to MAX_NUM_SERVICES
+#define ES_COUNT_SERVICE( Init, Run, QueueSize, BurstLimit, RunBatch ) +1
+#define NUM_SERVICES (0 SERVICE_LIST(ES_COUNT_SERVICE))
 
 /****************************************************************************/
 // Name/define the events of interest
@@ -260,13 +244,30 @@ typedef enum {  ES_NO_EVENT = 0,
                 ES_0x7E_RECEIVED,
                 ES_BYTE_RECEIVED,
                 ES_UART_ERROR_FLAG,
-                ES_UNLOCK} ES_EventTyp_t ;
+                ES_UNLOCK,
+                ES_PACKET_RECEIVED, /* EventParam is an ES_Payload handle */
+                ES_RX_BYTES, /* RxISR has bytes waiting in its coalescer */
+                ES_NUM_EVENT_TYPES /* keep this last, it counts the others */
+} ES_EventTyp_t ;
+
+/****************************************************************************/
+// Events that carry more than EventParam put the handle of a reference
+// counted payload buffer in EventParam (see ES_Payload.h). List those event
+// types here so that the framework can count the references as they are
+// posted and dispatched. ES_NUM_PAYLOADS buffers of ES_PAYLOAD_SIZE bytes
+// are set aside for them.
+#define ES_IS_PAYLOAD_EVENT( Type ) ( (Type) == ES_PACKET_RECEIVED )
+#define ES_NUM_PAYLOADS 4
+#define ES_PAYLOAD_SIZE 0x96
 
 /****************************************************************************/
 // These are the definitions for the Distribution lists. Each definition
 // should be a comma separated list of post functions to indicate which
 // services are on that distribution list.
 #define NUM_DIST_LISTS 1
+// DIST_LIST0 gets the 'L' key from Check4Keystroke. Event types that several
+// services consume are better sent with ES_Publish, which only posts to the
+// services that ES_Subscribe'd to that type (see ES_Framework.c)
 #if NUM_DIST_LISTS > 0 
 #define DIST_LIST0 PostRxSM
 #endif
@@ -300,6 +301,20 @@ typedef enum {  ES_NO_EVENT = 0,
 // This is the list of event checking functions 
 #define EVENT_CHECK_LIST Check4Keystroke
 
+/****************************************************************************/
+// The number of ES_Timers, at least 16. The running timers are kept in a
+// sorted delta list, so the cost of a tick does not grow with the number
+// that are running and a few hundred is fine. Timers 0-15 are bound to
+// their services below, any others are bound at run time with
+// ES_Timer_SetPostFunc (ES_Timers.h)
+#define ES_NUM_TIMERS 16
+
+/****************************************************************************/
+// The number of microsecond timers in ES_ShortTimer, at least 2. Timers 0
+// and 1 are TIMER_A & TIMER_B of ES_ShortTimerStart, the others are started
+// for any service with ES_ShortTimerStartuS (ES_ShortTimer.h)
+#define ES_NUM_SHORT_TIMERS 8
+
 /****************************************************************************/
 // These are the definitions for the post functions to be executed when the
 // corresponding timer expires. All 16 must be defined. If you are not using
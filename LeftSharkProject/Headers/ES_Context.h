@@ -0,0 +1,77 @@
+/****************************************************************************
+ Module
+     ES_Context.h
+ Description
+     header file for the per node module variables of the Events & Services
+     framework
+ Notes
+     Every module that keeps state gathers its variables into one struct
+     and reaches them through ES_CONTEXT, for example:
+
+       typedef struct {
+           uint8_t MyPriority;
+           MyState_t CurrentState;
+       }MyServiceVars_t;
+
+       ES_CONTEXT_VARS( MyServiceVars_t, MyService );
+       #define pVars ES_CONTEXT( MyServiceVars_t, MyService )
+
+       ...  pVars->CurrentState = Waiting;
+
+     Normally that is just a static struct, so the code is the same as with
+     separate statics. With ES_ENABLE_NODES (host build only) it is a slice
+     of the context of the node that the calling thread is running, so that
+     one process can run thousands of copies of the framework and the
+     services side by side (see ES_Nodes.h). The module must then be in
+     CONTEXT_LIST (the framework's own) or SERVICE_CONTEXT_LIST (in
+     ES_Configure.h), and its variables start out zeroed, so anything that
+     needs another starting value has to be set by its init function.
+
+     Constant tables, and state that is the same for every node (like the
+     timer post functions, which are bound by the inits), stay ordinary
+     statics.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/17/26 20:00 afb      started coding
+*****************************************************************************/
+
+#ifndef ES_Context_H
+#define ES_Context_H
+
+#include "ES_Configure.h"
+#include "ES_Types.h"
+
+#ifdef ES_ENABLE_NODES
+#include <stddef.h>
+
+// the framework modules that keep per node state, ahead of the services'
+#define CONTEXT_LIST(VARS) \
+    VARS(ES_Framework) \
+    VARS(ES_Timers) \
+    VARS(ES_Payload) \
+    VARS(ES_Port) \
+    SERVICE_CONTEXT_LIST(VARS)
+
+#define ES_CONTEXT_INDEX( Name ) Name##ContextIndex,
+enum { CONTEXT_LIST(ES_CONTEXT_INDEX) ES_NUM_CONTEXT_VARS };
+
+// the context of the node that this thread is running, and where each
+// module's variables start in a context (filled in by ES_NodesInit)
+extern __thread uint8_t * ES_pContext;
+extern size_t ES_ContextOffsets[ES_NUM_CONTEXT_VARS];
+
+#define ES_CONTEXT_VARS( Type, Name ) \
+    size_t const Name##ContextSize = sizeof(Type)
+#define ES_CONTEXT( Type, Name ) \
+    ((Type *)(ES_pContext + ES_ContextOffsets[Name##ContextIndex]))
+
+#else
+
+#define ES_CONTEXT_VARS( Type, Name ) static Type Name##Vars
+#define ES_CONTEXT( Type, Name ) (&Name##Vars)
+
+#endif
+
+#endif /* ES_Context_H */
@@ -26,8 +26,7 @@
 
 /****************************************************************************
  Function
-   ES_DeferEvent  (wrapper for ES_EnQueueLIFO)
-   this is a straight re-naming to aid readability
+   ES_DeferEvent
  Parameters
    ES_Event * pBlock : pointer to the block of memory in use as the Queue
    ES_Event Event2Add : event to be added to the Queue
@@ -35,8 +34,11 @@
    bool : true if the add was successful, false if not
  Description
    if it will fit, adds Event2Add to the Queue
+ Notes
+   no longer a straight re-naming of ES_EnQueueLIFO: a deferred payload
+   event holds a reference to its payload until it is recalled
  ***************************************************************************/
-#define ES_DeferEvent( a,b ) ES_EnQueueLIFO( a, b )
+bool ES_DeferEvent( ES_Event * pBlock, ES_Event Event2Add );
 
 /****************************************************************************
  Function
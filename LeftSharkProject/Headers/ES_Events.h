@@ -8,6 +8,8 @@
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/17/26 18:30 afb      added the deadline for ES_ENABLE_EDF
+ 10/17/26 11:30 afb      added the post time stamp for ES_ENABLE_PROFILING
  08/05/13 15:19 jec      modifications to suit new portable type definitions
  01/15/12 11:46 jec      moved event enum to config file, changed prefixes to ES
  10/23/11 22:01 jec      customized for Remote Lock problem
@@ -23,6 +25,12 @@
 typedef struct ES_Event_t {
     ES_EventTyp_t EventType;    // what kind of event?
     uint16_t   EventParam;      // parameter value for use w/ this event
+#ifdef ES_ENABLE_PROFILING
+    uint32_t   PostStamp;       // when it was posted, see ES_Profile.h
+#endif
+#ifdef ES_ENABLE_EDF
+    uint16_t   Deadline;        // ES_Timer_GetTime() when it is due
+#endif
 }ES_Event;
 
 
@@ -8,6 +8,18 @@
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/17/26 22:30 afb      added ES_IsAnyServiceReady
+ 10/17/26 20:00 afb      added ES_RunToIdle
+ 10/17/26 19:30 afb      the scheduler lock takes the critical region lock
+                         with ES_ENABLE_THREADS
+ 10/17/26 19:00 afb      added ES_Activate and the scheduler lock for
+                         ES_ENABLE_PREEMPTION
+ 10/17/26 18:30 afb      added ES_PostToServiceDeadline and the EDF deadline
+                         miss counts
+ 10/17/26 17:30 afb      added ES_Subscribe, ES_Unsubscribe & ES_Publish
+ 10/17/26 16:30 afb      widened the queue depths and stats to 16 bits
+ 10/17/26 16:00 afb      added ES_AttachISRQueue & ES_PostToServiceISR
+ 10/17/26 12:00 afb      added the queue depth & queue stats functions
  11/02/13 17:06 jec      added ES_PostToServiceLIFO prototype
  08/05/13 15:00 jec      added #include for ES_Port.h to get portability stuff
  10/17/06 07:41 jec      started coding
@@ -23,6 +35,7 @@
 #include "ES_PostList.h"
 #include "ES_Events.h"
 #include "ES_Timers.h"
+#include "ES_Queue.h"
 
 typedef enum {
               Success = 0,
@@ -35,8 +48,55 @@ typedef enum {
 
 ES_Return_t ES_Initialize( TimerRate_t NewRate  );
 ES_Return_t ES_Run( void );
+ES_Return_t ES_RunToIdle( void );
 bool ES_PostAll( ES_Event ThisEvent );
 bool ES_PostToService( uint8_t WhichService, ES_Event ThisEvent);
 bool ES_PostToServiceLIFO( uint8_t WhichService, ES_Event TheEvent);
+bool ES_PostToServiceDeadline( uint8_t WhichService, ES_Event TheEvent,
+                               uint16_t RelDeadline );
+uint16_t ES_GetQueueDepth( uint8_t WhichService );
+bool ES_IsAnyServiceReady( void );
+bool ES_Subscribe( uint8_t WhichService, ES_EventTyp_t EventType );
+bool ES_Unsubscribe( uint8_t WhichService, ES_EventTyp_t EventType );
+bool ES_Publish( ES_Event ThisEvent );
+bool ES_AttachISRQueue( uint8_t WhichService, ES_SPSCQueue_t * pQueue );
+bool ES_PostToServiceISR( uint8_t WhichService, ES_Event TheEvent);
+
+#ifdef ES_ENABLE_EDF
+uint32_t ES_GetDeadlineMisses( uint8_t WhichService );
+void ES_ResetDeadlineMisses( void );
+#endif
+
+#ifdef ES_ENABLE_PREEMPTION
+void ES_Activate( void );
+void ES_SchedLock( void );
+void ES_SchedUnlock( void );
+// for the framework modules, so that they can lock only when they need to
+#define ES_SCHED_LOCK()   ES_SchedLock()
+#define ES_SCHED_UNLOCK() ES_SchedUnlock()
+#elif defined(ES_ENABLE_THREADS)
+// the service threads and the tick share the timer list, so on the host
+// the lock is the (recursive) critical region lock
+#define ES_SCHED_LOCK()   EnterCritical()
+#define ES_SCHED_UNLOCK() ExitCritical()
+#else
+#define ES_SCHED_LOCK()
+#define ES_SCHED_UNLOCK()
+#endif
+
+#ifdef ES_ENABLE_QUEUE_STATS
+typedef struct {
+    uint16_t Capacity;      // how many events the queue can hold
+    uint16_t Depth;         // how many it held when the snapshot was taken
+    uint16_t HighWater;     // the most it has held since the last reset
+    uint32_t NumPosts;      // successful posts
+    uint32_t NumFailed;     // posts that found the queue full
+    uint16_t FailedByType[ES_NUM_EVENT_TYPES]; // NumFailed by EventType
+} ES_QueueStats_t;
+
+bool ES_GetQueueStats( uint8_t WhichService, ES_QueueStats_t * pStats );
+void ES_ResetQueueStats( void );
+void ES_PrintQueueStats( void );
+#endif
 
 #endif   // ES_Framework_H
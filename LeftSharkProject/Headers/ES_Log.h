@@ -0,0 +1,118 @@
+/****************************************************************************
+ Module
+     ES_Log.h
+ Description
+     header file for the deferred binary log of the Events & Services
+     framework
+ Notes
+     A log statement names a message from LOG_MESSAGE_LIST (ES_Configure.h)
+     and gives its arguments:
+         ES_LOG_INFO( LOG_RX_PACKET_BYTE, pData[i] );
+     Only the message's number and the arguments go into a ring, so a log
+     statement costs a few stores rather than a printf, and the format
+     strings are not in the image at all. ES_Run sends one message at a time
+     over the console when it would otherwise idle, as a frame of:
+         0x00, the message number, the number of arguments,
+         each argument as an unsigned LEB128 (7 bits a byte, low bits first)
+     Tools/ES_LogDecode.c passes the console text through and turns the
+     frames back into the text that printf would have made.
+
+     ES_LOG_LEVEL (ES_Configure.h) sets which statements are compiled, the
+     rest expand to nothing, arguments and all. With ES_ENABLE_NODES there
+     is no console for a node to log to, so they all compile out.
+
+     The arguments are 32 bits, so the formats may only use the integer
+     conversions, and at most ES_LOG_MAX_ARGS of them. Log statements may be
+     used from the services, the event checkers and the interrupt responses,
+     but not inside a critical region.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/17/26 21:30 afb      started coding
+*****************************************************************************/
+
+#ifndef ES_Log_H
+#define ES_Log_H
+
+#include "ES_Configure.h"
+#include "ES_Types.h"
+
+// the values for ES_LOG_LEVEL, each one includes the ones above it
+#define ES_LOG_LEVEL_NONE   0
+#define ES_LOG_LEVEL_ERROR  1
+#define ES_LOG_LEVEL_WARN   2
+#define ES_LOG_LEVEL_INFO   3
+#define ES_LOG_LEVEL_DEBUG  4
+
+#define ES_LOG_MAX_ARGS 4
+
+// the first byte of a frame, printf never sends it
+#define ES_LOG_FRAME_START 0x00
+
+// the message number of the frame that says how many messages were lost
+// to a full ring, its one argument is the count
+#define ES_LOG_LOST_MESSAGES 0xFF
+
+// the message numbers, from LOG_MESSAGE_LIST, there may be up to 255
+#define ES_LOG_MESSAGE_ID( Name, Format ) Name,
+
+typedef enum {
+  LOG_MESSAGE_LIST(ES_LOG_MESSAGE_ID)
+  ES_NUM_LOG_MESSAGES
+}ES_LogMessage_t;
+
+#if defined(ES_ENABLE_NODES) || !defined(ES_LOG_LEVEL)
+#undef ES_LOG_LEVEL
+#define ES_LOG_LEVEL ES_LOG_LEVEL_NONE
+#endif
+
+#if ES_LOG_LEVEL > ES_LOG_LEVEL_NONE
+
+// public functions
+bool ES_LogDrain( void );
+
+// for the macros below, pWords is the message number and then the arguments
+void ES_LogWrite( uint32_t const * pWords, uint8_t NumWords );
+
+#define ES_LOG_WRITE( ... ) \
+  do { \
+    uint32_t const ES_LogWords[] = { __VA_ARGS__ }; \
+    ES_LogWrite( ES_LogWords, \
+                 (uint8_t)( sizeof(ES_LogWords) / sizeof(ES_LogWords[0]) ) ); \
+  } while (0)
+
+// sends the next message, true if there was one
+#define ES_LOG_DRAIN() ES_LogDrain()
+
+#else /* logging disabled */
+
+#define ES_LOG_DRAIN() false
+
+#endif
+
+#if ES_LOG_LEVEL >= ES_LOG_LEVEL_ERROR
+#define ES_LOG_ERROR( ... ) ES_LOG_WRITE( __VA_ARGS__ )
+#else
+#define ES_LOG_ERROR( ... )
+#endif
+
+#if ES_LOG_LEVEL >= ES_LOG_LEVEL_WARN
+#define ES_LOG_WARN( ... ) ES_LOG_WRITE( __VA_ARGS__ )
+#else
+#define ES_LOG_WARN( ... )
+#endif
+
+#if ES_LOG_LEVEL >= ES_LOG_LEVEL_INFO
+#define ES_LOG_INFO( ... ) ES_LOG_WRITE( __VA_ARGS__ )
+#else
+#define ES_LOG_INFO( ... )
+#endif
+
+#if ES_LOG_LEVEL >= ES_LOG_LEVEL_DEBUG
+#define ES_LOG_DEBUG( ... ) ES_LOG_WRITE( __VA_ARGS__ )
+#else
+#define ES_LOG_DEBUG( ... )
+#endif
+
+#endif /* ES_Log_H */
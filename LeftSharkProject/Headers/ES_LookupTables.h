@@ -17,12 +17,20 @@
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/17/26 22:30 afb      the notes no longer have the tick looking up the
+                         active timers, it only touches the list head
+ 10/17/26 10:05 afb      ES_GetMSBitSet is now an inline count-leading-zeros
+                         on compilers that provide one, the nybble table walk
+                         is kept as ES_GetMSBitSetByTable
  10/20/13 21:19 jec      got rid of BitNum2ClrMask and replaced with #define
                          replaced Byte2MSBNum with function ES_GetMSBSet
                          replaced Byte2MSBNum array with Nybble2MSBNum
  08/05/13 15:45 jec      added #include for ES_Types.h since we depend on it
  01/15/12 13:03 jec      started coding
 *****************************************************************************/
+#ifndef ES_LookupTables_H
+#define ES_LookupTables_H
+
 #include "ES_Types.h"
 /*
   Since we moved up to 16 timers & services, this table got too big to justify
@@ -39,16 +47,32 @@ extern uint16_t const BitNum2SetMask[];
 
 /*
   this table is used to go from an unsigned 4bit value to the most significant
-  bit that is set in that nybble. It is used in the determination of priorities
-  from the Ready variable and in determining active timers in 
-  the timer interrupt response. Index into the array with (ByteVal-1) to get 
-  the correct MS Bit num.
+  bit that is set in that nybble. It is used by ES_GetMSBitSetByTable, where
+  there is no CLZ to find the priorities from the Ready variable. Index into
+  the array with (ByteVal-1) to get the correct MS Bit num.
 */
 extern uint8_t const Nybble2MSBitNum[15];
 
 /****************************************************************************
  Function
-   ES_GetMSBSet
+   ES_GetMSBitSetByTable
+ Parameters
+   uint16_t  Val2Check The number to find the MSB in
+ Returns
+   bit number of the MSB that is set in Val2Check, 128 if Val2Check = 0
+ Description
+   find the MSB that is set in Val2Check and returns that bit number by
+   walking the value a nybble at a time through Nybble2MSBitNum
+ Notes
+   portable fallback for ES_GetMSBitSet on compilers without a CLZ
+ Author
+   J. Edward Carryer, 10/20/13, 17:03
+****************************************************************************/
+uint8_t ES_GetMSBitSetByTable( uint16_t Val2Check);
+
+/****************************************************************************
+ Function
+   ES_GetMSBitSet
  Parameters
    uint16_t  Val2Check The number to find the MSB in
  Returns
@@ -56,8 +80,27 @@ extern uint8_t const Nybble2MSBitNum[15];
  Description
    find the MSB that is set in Val2Check and returns that bit number
  Notes
-   
+   This is called twice on every dispatch in ES_Run (once for the Ready
+   group, once within it) and once per subscriber on every ES_Publish, so
+   where the compiler gives us a count-leading-zeros (the CLZ instruction
+   on the Cortex-M4, __builtin_clz on the host) it is inlined as a single
+   CLZ and a subtract. The tick no longer calls it at all, it only counts
+   down the delta at the head of the active timer list.
  Author
    J. Edward Carryer, 10/20/13, 17:03
 ****************************************************************************/
-uint8_t ES_GetMSBitSet( uint16_t Val2Check);
+#if defined(__ARMCC_VERSION) && (__ARMCC_VERSION < 6000000)
+#define ES_HAVE_CLZ
+static __inline uint8_t ES_GetMSBitSet( uint16_t Val2Check){
+  return (Val2Check == 0) ? 128 : (uint8_t)(31 - __clz(Val2Check));
+}
+#elif defined(__GNUC__)
+#define ES_HAVE_CLZ
+static inline uint8_t ES_GetMSBitSet( uint16_t Val2Check){
+  return (Val2Check == 0) ? 128 : (uint8_t)(31 - __builtin_clz(Val2Check));
+}
+#else
+#define ES_GetMSBitSet( Val2Check ) ES_GetMSBitSetByTable( Val2Check )
+#endif
+
+#endif /* ES_LookupTables_H */
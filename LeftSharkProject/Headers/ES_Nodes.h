@@ -0,0 +1,59 @@
+/****************************************************************************
+ Module
+     ES_Nodes.h
+ Description
+     header file for running many copies (nodes) of the Events & Services
+     framework in one host process
+ Notes
+     With ES_ENABLE_NODES (ES_PORT_POSIX only) the variables of the framework
+     and of the services live in a context per node (see ES_Context.h), so a
+     ground station simulation can run thousands of nodes side by side, each
+     with its own queues, timers and service states.
+
+     A node has no tick and no event checkers of its own. It is driven in
+     steps: ES_NodeStep credits the node with some ticks and then runs its
+     services until every queue is empty. ES_NodesRun steps a whole set of
+     nodes for a number of rounds on a pool of threads that steal work from
+     each other, so a node that takes long does not hold its thread's share
+     up. Anything that is posted to a node (from the hook, say) must be
+     posted between ES_NodeEnter and ES_NodeLeave.
+
+     A node is only ever run by one thread at a time, so nodes need no locks.
+     Nodes must not post to each other directly, only through the hook,
+     between rounds or on the node's own step.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/17/26 20:00 afb      started coding
+*****************************************************************************/
+
+#ifndef ES_Nodes_H
+#define ES_Nodes_H
+
+#include "ES_Types.h"
+#include "ES_Framework.h"
+
+typedef struct {
+    uint8_t * pContext;       // this node's slice of every module's variables
+    ES_Return_t Status;       // Success until a step fails
+    uint32_t NumSteps;
+}ES_Node_t;
+
+// called for every node at the start of its step in every round, inside the
+// node, to post whatever the node sees in that round
+typedef void ES_NodeHook_t( ES_Node_t * pNode, uint32_t NodeNum,
+                            uint32_t Round );
+
+// public functions
+bool ES_NodesInit( void );
+bool ES_NodeCreate( ES_Node_t * pNode );
+void ES_NodeDestroy( ES_Node_t * pNode );
+void ES_NodeEnter( ES_Node_t * pNode );
+void ES_NodeLeave( void );
+ES_Return_t ES_NodeStep( ES_Node_t * pNode, uint32_t NumTicks );
+bool ES_NodesRun( ES_Node_t * pNodes, uint32_t NumNodes, uint16_t NumThreads,
+                  uint32_t NumRounds, uint32_t TicksPerRound,
+                  ES_NodeHook_t * pHook );
+
+#endif /* ES_Nodes_H */
@@ -0,0 +1,72 @@
+/****************************************************************************
+ Module
+     ES_Payload.h
+ Description
+     header file for the reference counted event payloads of the Events &
+     Services framework
+ Notes
+     An ES_Event only has room for a 16-bit parameter, so an event that
+     needs to carry more (a received packet, say) carries the handle of a
+     payload buffer in its EventParam instead. The event types that do this
+     are picked out by ES_IS_PAYLOAD_EVENT in ES_Configure.h.
+
+     Each buffer has a reference count. ES_PayloadAlloc hands back a buffer
+     with a count of 1, which belongs to the caller. Every successful post of
+     a payload event adds a reference for the queue that it is in, and ES_Run
+     drops that reference when the run function that the event went to
+     returns. So the producer fills the buffer, posts (to as many services or
+     lists as it likes) and then releases its own reference; the buffer goes
+     back to the pool when the last service has finished with it.
+
+     A service that wants to keep the payload after its run function returns
+     must take its own reference with ES_PayloadAddRef.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/17/26 22:30 afb      ES_PAYLOAD_HOLD & ES_PAYLOAD_DROP wrapped in
+                         do { } while (0)
+ 10/17/26 15:30 afb      added ES_PayloadGetPoolStats
+ 10/17/26 15:00 afb      started coding
+*****************************************************************************/
+
+#ifndef ES_Payload_H
+#define ES_Payload_H
+
+#include "ES_Configure.h"
+#include "ES_Types.h"
+#include "ES_Events.h"
+#include "ES_Pool.h"
+
+// the handle returned when there are no free buffers
+#define ES_NO_PAYLOAD 0xFFFF
+
+// public functions
+void ES_PayloadInit( void );
+uint16_t ES_PayloadAlloc( void );
+void ES_PayloadAddRef( uint16_t Handle );
+void ES_PayloadRelease( uint16_t Handle );
+uint8_t * ES_PayloadData( uint16_t Handle );
+uint16_t ES_PayloadGetLength( uint16_t Handle );
+void ES_PayloadSetLength( uint16_t Handle, uint16_t Length );
+uint16_t ES_PayloadNumFree( void );
+void ES_PayloadGetPoolStats( ES_PoolStats_t * pStats );
+
+// hooks for the framework, a payload event holds a reference while it is in
+// a queue (a service or deferral queue) until it has been dispatched.
+// Both are single statements, so they are safe in an unbraced if/else
+#define ES_PAYLOAD_HOLD( ThisEvent ) \
+  do { \
+    if ( ES_IS_PAYLOAD_EVENT((ThisEvent).EventType) ){ \
+      ES_PayloadAddRef( (ThisEvent).EventParam ); \
+    } \
+  } while (0)
+
+#define ES_PAYLOAD_DROP( ThisEvent ) \
+  do { \
+    if ( ES_IS_PAYLOAD_EVENT((ThisEvent).EventType) ){ \
+      ES_PayloadRelease( (ThisEvent).EventParam ); \
+    } \
+  } while (0)
+
+#endif /* ES_Payload_H */
@@ -0,0 +1,72 @@
+/****************************************************************************
+ Module
+     ES_Pool.h
+ Description
+     header file for the fixed-block memory pools of the Events & Services
+     framework
+ Notes
+     A pool hands out blocks of one size from a block of memory supplied by
+     its owner, in the same way that ES_InitQueue builds a queue in a block
+     of memory. Declare the memory with ES_POOL_MEM, for example:
+
+       static ES_POOL_MEM( MsgMem, sizeof(Msg_t), 8 );
+       static ES_Pool_t MsgPool;
+       ES_PoolInit( &MsgPool, MsgMem, sizeof(Msg_t), 8 );
+
+     Alloc and free take the same time however full the pool is, and may be
+     called from interrupt responses. A free block holds the link to the
+     next free block in its first sizeof(void *) bytes, so anything that
+     must survive being freed belongs after that.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/17/26 15:30 afb      started coding
+*****************************************************************************/
+
+#ifndef ES_Pool_H
+#define ES_Pool_H
+
+#include "ES_Types.h"
+
+// blocks are rounded up to a whole number of pointers, which keeps them
+// aligned and leaves room for the free list link
+#define ES_POOL_BLOCK_WORDS( BlockSize ) \
+            (((BlockSize) + sizeof(void *) - 1) / sizeof(void *))
+
+// declares the memory for a pool of NumBlocks blocks of BlockSize bytes
+#define ES_POOL_MEM( Name, BlockSize, NumBlocks ) \
+            void * Name[ES_POOL_BLOCK_WORDS(BlockSize) * (NumBlocks)]
+
+typedef struct {
+    void * pFree;         // the first free block
+    uint8_t * pStart;     // the first block
+    uint16_t BlockSize;   // in bytes, after rounding up
+    uint16_t NumBlocks;
+    uint16_t NumFree;     // blocks on the free list
+    uint16_t HighWater;   // the most blocks that have been in use at once
+    uint16_t NumFailed;   // allocs that found the pool empty
+}ES_Pool_t;
+
+typedef struct {
+    uint16_t BlockSize;
+    uint16_t NumBlocks;
+    uint16_t NumUsed;
+    uint16_t HighWater;
+    uint16_t NumFailed;
+}ES_PoolStats_t;
+
+// public functions
+void ES_PoolInit( ES_Pool_t * pPool, void * pMem, uint16_t BlockSize,
+                  uint16_t NumBlocks );
+void * ES_PoolAlloc( ES_Pool_t * pPool );
+bool ES_PoolFree( ES_Pool_t * pPool, void * pBlock );
+uint16_t ES_PoolBlockNum( ES_Pool_t const * pPool, void const * pBlock );
+void * ES_PoolBlock( ES_Pool_t const * pPool, uint16_t BlockNum );
+void ES_PoolGetStats( ES_Pool_t * pPool, ES_PoolStats_t * pStats );
+void ES_PoolResetStats( ES_Pool_t * pPool );
+
+// ES_PoolBlockNum's answer for a pointer that is not a block of the pool
+#define ES_POOL_NO_BLOCK 0xFFFF
+
+#endif /* ES_Pool_H */
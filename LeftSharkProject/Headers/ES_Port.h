@@ -9,6 +9,22 @@
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/17/26 21:00 afb     added ES_CYCLE_COUNT_HZ, ES_NOINIT and the 32-bit
+                        fetch & increment for ES_Trace
+ 10/17/26 20:30 afb     ES_VIRTUAL_TIME, _HW_AddTicks for ES_ENABLE_SIM too
+ 10/17/26 20:00 afb     added _HW_AddTicks for ES_ENABLE_NODES, whose
+                        critical regions are empty
+ 10/17/26 19:00 afb     added the interrupt mask and PendSV hooks for
+                        ES_ENABLE_PREEMPTION, and the host's simulated
+                        interrupt
+ 10/17/26 16:00 afb     added the 16-bit atomics for the ready set and the
+                        single producer queues
+ 10/17/26 13:30 afb     added _HW_GetTimeUs and ES_Timer_GetTimeUs
+ 10/17/26 12:30 afb     _HW_Idle is a function on the target with
+                        ES_ENABLE_TICKLESS_IDLE
+ 10/17/26 11:30 afb     added the cycle counter used by ES_Profile
+ 10/17/26 09:10 afb     added the ES_PORT_POSIX branch for the Linux host port
+                        and the _HW_Idle hook called from ES_Run
  10/14/15 21:50 jec     added prototype for ES_Timer_GetTime
  01/18/15 13:24 jec     clean up and adapt to use TI driver lib functions
                         for implementing EnterCritical & ExitCritical
@@ -25,8 +41,10 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#ifndef ES_PORT_POSIX
 #include "termio.h"
-#include "bitdefs.h"       /* generic bit defs (BIT0HI, BIT0LO,...) */
+#endif
+#include "BITDEFS.H"       /* generic bit defs (BIT0HI, BIT0LO,...) */
 #include "Bin_Const.h"     /* macros to specify binary constants in C */
 #include "ES_Types.h"
 
@@ -48,6 +66,97 @@
 // simple reference to the variable
 #define ES_READ_FLASH_BYTE(_flash_var_)    (_flash_var_)                  
 
+#ifdef ES_PORT_POSIX
+// The POSIX host port (ES_Port_POSIX.c) runs the framework as a Linux process.
+// There are no interrupts to mask, so the critical region wrappers take a
+// (recursive) process wide lock instead. Anything that stands in for an
+// interrupt on the host (another thread, a signal handler) must use the same
+// wrappers around its access to the framework.
+void _HW_EnterCritical(void);
+void _HW_ExitCritical(void);
+
+#ifdef ES_ENABLE_NODES
+// a node is only ever run by one thread at a time and has no interrupts, so
+// its critical regions need no lock (and one lock would serialize them all)
+#define EnterCritical()	{ }
+#define ExitCritical() { }
+#else
+#define EnterCritical()	{ _HW_EnterCritical(); }
+#define ExitCritical() { _HW_ExitCritical(); }
+#endif
+
+/* Rate constants for the host tick. On the host the tick is generated by a
+   timerfd, so the values are simply the tick period in microseconds.
+ */
+typedef enum {	ES_Timer_RATE_OFF  	=   (0),
+				ES_Timer_RATE_100uS = 100,
+				ES_Timer_RATE_500uS = 500,
+				ES_Timer_RATE_1mS	= 1000,
+				ES_Timer_RATE_2mS	= 2000,
+				ES_Timer_RATE_4mS	= 4000,
+				ES_Timer_RATE_5mS	= 5000,
+				ES_Timer_RATE_8mS	= 8000,
+				ES_Timer_RATE_10mS	= 10000,
+				ES_Timer_RATE_16mS	= 16000,
+				ES_Timer_RATE_32mS	= 32000
+} TimerRate_t;
+
+// the host has no kbhit(), so ES_Port_POSIX.c provides non-blocking versions
+// of the keystroke test & fetch that read directly from stdin
+int kbhit(void);
+int _HW_GetNewKey(void);
+#define IsNewKeyReady()  ( kbhit() != 0 )
+#define GetNewKey()      _HW_GetNewKey()
+
+// on the host, idling blocks the process until the next tick or keystroke
+void _HW_Idle(void);
+
+// time stamps for the profiler come from CLOCK_MONOTONIC, in nanoseconds
+uint32_t _HW_GetCycleCount(void);
+#define ES_CYCLE_COUNT_UNITS "ns"
+#define ES_CYCLE_COUNT_HZ 1000000000UL
+
+// a process has nothing that survives a reset, so this is ordinary memory
+#define ES_NOINIT
+
+// 16-bit words shared with interrupt responses (other threads here) without
+// a critical region use C11 atomics. The loads acquire and the stores
+// release, so whatever was written before a store is seen after the load.
+#include <stdatomic.h>
+typedef _Atomic uint16_t ES_Atomic16_t;
+#define _HW_AtomicSetBits16( pWord, Mask )   atomic_fetch_or( (pWord), (Mask) )
+#define _HW_AtomicClearBits16( pWord, Mask ) \
+            atomic_fetch_and( (pWord), (uint16_t)~(Mask) )
+#define _HW_AtomicLoad16( pWord ) \
+            atomic_load_explicit( (pWord), memory_order_acquire )
+#define _HW_AtomicStore16( pWord, Value ) \
+            atomic_store_explicit( (pWord), (Value), memory_order_release )
+
+// a 32-bit counter that posts from any thread may take numbers from
+typedef _Atomic uint32_t ES_Atomic32_t;
+#define _HW_AtomicFetchInc32( pWord ) \
+            atomic_fetch_add_explicit( (pWord), 1, memory_order_relaxed )
+
+// a periodic signal that plays the part of an interrupt, for load and
+// latency tests. pISR runs in the signal handler, see ES_Port_POSIX.c
+void _HW_SimInterruptStart(uint32_t PeriodUs, void (*pISR)(void));
+
+#ifdef ES_ENABLE_PREEMPTION
+// the simulated interrupt and a second signal that stands in for PendSV
+// are blocked while "interrupts are off"
+void _HW_DisableInts(void);
+void _HW_EnableInts(void);
+void _HW_PendScheduler(void);
+#endif
+
+#if defined(ES_ENABLE_NODES) || defined(ES_ENABLE_SIM)
+// no tick of its own, time only passes when ES_NodeStep or ES_Sim credit it
+#define ES_VIRTUAL_TIME
+void _HW_AddTicks(uint32_t NumTicks);
+#endif
+
+#else /* Cortex-M4 (TM4C123G) target */
+
 // these macros provide the wrappers for critical regions, where ints will be off
 // but the state of the interrupt enable prior to entry will be restored.
 // allocation of temp var for saving interrupt enable status should be defined
@@ -94,12 +203,96 @@ typedef enum {	ES_Timer_RATE_OFF  	=   (0),
 #define IsNewKeyReady()  ( kbhit() != 0 )
 #define GetNewKey()      getchar()
 
+#ifdef ES_ENABLE_TICKLESS_IDLE
+// stops SysTick and sleeps until the next timer is due, see ES_Port.c
+void _HW_Idle(void);
+#else
+// the event checkers must be polled continuously on the target, so there is
+// nothing to do while idle
+#define _HW_Idle()
+#endif
+
+// time stamps for the profiler come straight from the DWT cycle counter
+// (DWT_CYCCNT), in core clocks. _HW_CycleCounterInit must be called first.
+#define _HW_GetCycleCount()  (*(volatile uint32_t *)0xE0001004UL)
+#define ES_CYCLE_COUNT_UNITS "cycles"
+#define ES_CYCLE_COUNT_HZ 40000000UL // the SysCtlClockSet in main.c
+
+// variables that the C startup must leave alone, so that they keep what
+// was in them across a reset. The scatter file (LaunchPad.sct) puts the
+// ES_NoInit section in an UNINIT region at the top of the RAM.
+#define ES_NOINIT __attribute__((section("ES_NoInit"), zero_init))
+
+// 16-bit words shared with interrupt responses without a critical region.
+// The read-modify-writes use LDREXH/STREXH, so an interrupt that changes the
+// word between the load and the store makes the store fail and we go round
+// again. The DMBs keep the compiler (and the core) from moving the queue
+// slot accesses across the index accesses.
+typedef volatile uint16_t ES_Atomic16_t;
+
+static __inline void _HW_AtomicSetBits16( ES_Atomic16_t * pWord, uint16_t Mask ){
+  uint16_t Value;
+  do {
+    Value = __ldrex( pWord );
+  } while ( __strex( (uint16_t)(Value | Mask), pWord ) != 0 );
+}
+
+static __inline void _HW_AtomicClearBits16( ES_Atomic16_t * pWord,
+                                            uint16_t Mask ){
+  uint16_t Value;
+  do {
+    Value = __ldrex( pWord );
+  } while ( __strex( (uint16_t)(Value & ~Mask), pWord ) != 0 );
+}
+
+static __inline uint16_t _HW_AtomicLoad16( ES_Atomic16_t * pWord ){
+  uint16_t Value = *pWord;
+  __dmb( 0xF );
+  return Value;
+}
+
+static __inline void _HW_AtomicStore16( ES_Atomic16_t * pWord, uint16_t Value ){
+  __dmb( 0xF );
+  *pWord = Value;
+}
+
+// returns the old value, an interrupt between the LDREX and the STREX makes
+// us take the next number instead
+typedef volatile uint32_t ES_Atomic32_t;
+
+static __inline uint32_t _HW_AtomicFetchInc32( ES_Atomic32_t * pWord ){
+  uint32_t Value;
+  do {
+    Value = __ldrex( pWord );
+  } while ( __strex( Value + 1, pWord ) != 0 );
+  return Value;
+}
+
+#ifdef ES_ENABLE_PREEMPTION
+// ES_Activate runs between the run functions with PRIMASK set, and a post
+// asks for it by pending PendSV (PENDSVSET in the ICSR). The barriers make
+// sure that PendSV is taken before the post returns when nothing masks it.
+#define _HW_DisableInts()   __disable_irq()
+#define _HW_EnableInts()    __enable_irq()
+#define _HW_PendScheduler() \
+  { *(volatile uint32_t *)0xE000ED04UL = 0x10000000UL; \
+    __dsb( 0xF ); __isb( 0xF ); }
+#endif
+
+#endif /* ES_PORT_POSIX */
+
 // prototypes for the hardware specific routines
 void _HW_Timer_Init(TimerRate_t Rate);
 bool _HW_Process_Pending_Ints( void );
 uint16_t _HW_GetTickCount(void);
+uint64_t _HW_GetTimeUs(void);
+void _HW_CycleCounterInit(void);
+#ifdef ES_ENABLE_PREEMPTION
+void _HW_PreemptInit(void);
+#endif
 void ConsoleInit(void);
-// and the one Framework function that we define here
+// and the Framework functions that we define here
 uint16_t ES_Timer_GetTime(void);
+uint64_t ES_Timer_GetTimeUs(void);
 
 #endif
@@ -0,0 +1,82 @@
+/****************************************************************************
+ Module
+     ES_Profile.h
+ Description
+     header file for the run time & queue wait profiler of the Events &
+     Services framework
+ Notes
+     Everything here is conditional on ES_ENABLE_PROFILING (ES_Configure.h).
+     With it undefined, the hooks that ES_Framework.c uses expand to nothing,
+     ES_Event does not carry a post time stamp and ES_Profile.c is empty.
+
+     The times are in units of the port's _HW_GetCycleCount(): core clocks
+     on the target and nanoseconds on the host (see ES_CYCLE_COUNT_UNITS).
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/17/26 19:00 afb      ES_PROFILE_RUN_BEGIN takes the service, so that a
+                         run preempted by another one keeps its start time
+ 10/17/26 11:30 afb      started coding
+*****************************************************************************/
+
+#ifndef ES_Profile_H
+#define ES_Profile_H
+
+#include "ES_Configure.h"
+#include "ES_Types.h"
+#include "ES_Events.h"
+#include "ES_Port.h"
+
+#ifdef ES_ENABLE_PROFILING
+
+// one histogram bin per bit of a 32-bit time, bin n counts the samples from
+// 2^n to (2^(n+1))-1. Bin 0 also holds samples of 0.
+#define ES_PROFILE_NUM_BINS 32
+
+typedef struct {
+    uint32_t Count;      // number of samples
+    uint32_t Min;        // shortest sample
+    uint32_t Max;        // longest sample
+    uint64_t Total;      // sum of the samples, for the mean
+    uint32_t Histogram[ES_PROFILE_NUM_BINS]; // log2 histogram
+}ES_ProfileStats_t;
+
+typedef struct {
+    ES_ProfileStats_t RunTime;   // time spent in the run function
+    ES_ProfileStats_t QueueWait; // time from post until dispatch
+}ES_ServiceProfile_t;
+
+// public functions
+void ES_Profile_Init( void );
+void ES_Profile_Reset( void );
+bool ES_Profile_GetService( uint8_t WhichService,
+                            ES_ServiceProfile_t * pProfile );
+uint32_t ES_Profile_Mean( ES_ProfileStats_t const * pStats );
+void ES_Profile_Print( void );
+
+// hooks for ES_Framework.c, use the macros below rather than these
+void ES_Profile_Dequeued( uint8_t WhichService, ES_Event const * pEvent );
+void ES_Profile_RunBegin( uint8_t WhichService );
+void ES_Profile_RunEnd( uint8_t WhichService );
+
+#define ES_PROFILE_INIT()                 ES_Profile_Init()
+#define ES_PROFILE_STAMP(ThisEvent)  \
+            ((ThisEvent).PostStamp = _HW_GetCycleCount())
+#define ES_PROFILE_DEQUEUED(WhichService, ThisEvent) \
+            ES_Profile_Dequeued((WhichService), &(ThisEvent))
+#define ES_PROFILE_RUN_BEGIN(WhichService) \
+            ES_Profile_RunBegin(WhichService)
+#define ES_PROFILE_RUN_END(WhichService)  ES_Profile_RunEnd(WhichService)
+
+#else /* profiling disabled, the hooks compile out */
+
+#define ES_PROFILE_INIT()
+#define ES_PROFILE_STAMP(ThisEvent)
+#define ES_PROFILE_DEQUEUED(WhichService, ThisEvent)
+#define ES_PROFILE_RUN_BEGIN(WhichService)
+#define ES_PROFILE_RUN_END(WhichService)
+
+#endif /* ES_ENABLE_PROFILING */
+
+#endif /* ES_Profile_H */
@@ -9,6 +9,11 @@
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/17/26 18:30 afb      added the peek functions
+ 10/17/26 16:30 afb      added the ring queues with a separate header
+ 10/17/26 16:00 afb      added the single producer/single consumer queues
+ 10/17/26 12:00 afb      added ES_QueueDepth prototype
+ 10/17/26 11:00 afb      added ES_DeQueueBlock prototype
  08/05/13 15:19 jec      modifications to suit new portable type definitions
  01/15/12 09:36 jec      converted to use new types from ES_Types.h
  10/17/11 07:49 jec      new header to match the rest of the framework
@@ -19,6 +24,29 @@
 
 #include "ES_Types.h"
 #include "ES_Events.h"
+#include "ES_Port.h"
+
+// A ring queue keeps its header apart from the slots, so every slot holds
+// an event and it can hold up to 65535 of them. When the number of slots is
+// a power of two the index wraps with a mask, otherwise with a compare.
+typedef struct {
+    ES_Event * pSlots;
+    uint16_t Size;        // number of slots
+    uint16_t Mask;        // Size - 1 when Size is a power of two, else 0
+    uint16_t Head;        // the slot that the next event comes out of
+    uint16_t NumEntries;
+}ES_RingQueue_t;
+
+// A single producer/single consumer queue, for posting from one interrupt
+// response to a service without turning interrupts off. The producer only
+// writes Tail and the consumer only writes Head, both count up forever and
+// wrap at 16 bits, so the number of slots must be a power of two.
+typedef struct {
+    ES_Atomic16_t Head;   // count of events taken, written by the consumer
+    ES_Atomic16_t Tail;   // count of events added, written by the producer
+    uint16_t Mask;        // number of slots - 1
+    ES_Event * pSlots;
+}ES_SPSCQueue_t;
 
 /* prototypes for public functions */
 
@@ -26,8 +54,29 @@ uint8_t ES_InitQueue( ES_Event * pBlock, uint8_t BlockSize );
 bool ES_EnQueueFIFO( ES_Event * pBlock, ES_Event Event2Add );
 bool ES_EnQueueLIFO( ES_Event * pBlock, ES_Event Event2Add );
 uint8_t ES_DeQueue( ES_Event * pBlock, ES_Event * pReturnEvent );
+uint8_t ES_DeQueueBlock( ES_Event * pBlock, ES_Event * pDest, 
+                         uint8_t MaxEvents, uint8_t * pNumTaken );
 //void EF_FlushQueue( unsigned char * pBlock );
 bool ES_IsQueueEmpty( ES_Event * pBlock );
+uint8_t ES_QueueDepth( ES_Event * pBlock );
+
+void ES_InitRingQueue( ES_RingQueue_t * pQueue, ES_Event * pSlots,
+                       uint16_t NumSlots );
+bool ES_RingEnQueueFIFO( ES_RingQueue_t * pQueue, ES_Event Event2Add );
+bool ES_RingEnQueueLIFO( ES_RingQueue_t * pQueue, ES_Event Event2Add );
+uint16_t ES_RingDeQueue( ES_RingQueue_t * pQueue, ES_Event * pReturnEvent );
+uint16_t ES_RingDeQueueBlock( ES_RingQueue_t * pQueue, ES_Event * pDest,
+                              uint16_t MaxEvents, uint16_t * pNumTaken );
+bool ES_IsRingQueueEmpty( ES_RingQueue_t const * pQueue );
+uint16_t ES_RingQueueDepth( ES_RingQueue_t const * pQueue );
+bool ES_RingQueuePeek( ES_RingQueue_t * pQueue, ES_Event * pReturnEvent );
+
+bool ES_InitSPSCQueue( ES_SPSCQueue_t * pQueue, ES_Event * pSlots,
+                       uint16_t NumSlots );
+bool ES_SPSCEnQueue( ES_SPSCQueue_t * pQueue, ES_Event Event2Add );
+uint16_t ES_SPSCDeQueue( ES_SPSCQueue_t * pQueue, ES_Event * pReturnEvent );
+uint16_t ES_SPSCQueueDepth( ES_SPSCQueue_t * pQueue );
+bool ES_SPSCQueuePeek( ES_SPSCQueue_t * pQueue, ES_Event * pReturnEvent );
 
 #endif /*ES_Queue_H */
 
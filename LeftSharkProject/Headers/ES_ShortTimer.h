@@ -3,12 +3,18 @@
 #ifndef ES_ShortTimer_H
 #define ES_ShortTimer_H
 #include <stdint.h>
+#include <stdbool.h>
 #include "driverlib/timer.h"
 #include "ES_Configure.h"
 
 #define SHORT_TIMER_UNUSED MAX_NUM_SERVICES
 
-void ES_ShortTimerInit(uint8_t TimeAPrio, uint8_t TimeBPrio);
+void ES_ShortTimerInit(uint16_t TimeAPrio, uint16_t TimeBPrio);
 void ES_ShortTimerStart( uint32_t Which, uint16_t TimeoutValue);
+// timers 2 to ES_NUM_SHORT_TIMERS-1, for any service, EventParam is Num
+bool ES_ShortTimerStartuS( uint16_t Num, uint16_t WhichService,
+                           uint32_t TimeoutuS );
+// any timer, including TIMER_A (0) & TIMER_B (1)
+bool ES_ShortTimerStop( uint16_t Num );
 
 #endif //ES_ShortTimer_H
@@ -0,0 +1,45 @@
+/****************************************************************************
+ Module
+     ES_Sim.h
+ Description
+     header file for the virtual time simulator of the host build of the
+     Events & Services framework
+ Notes
+     With ES_ENABLE_SIM (ES_PORT_POSIX only) nothing ticks by itself.
+     ES_SimRun runs the services until every queue is empty and then moves
+     the time straight on to whatever happens next: the next timer expiry
+     or the next stimulus scheduled with ES_SimPostAt. A stimulus is a
+     function that is called at its tick to do what the outside world would
+     (post key strokes, bytes from the radio, ...), and may schedule more.
+
+     Nothing in a simulation depends on the clock, so a run gives the same
+     results, tick for tick, every time, and the time between events costs
+     nothing: hours of link timeouts run in seconds.
+
+     On a tick where a timer expires and a stimulus is due, the timeout is
+     posted, and the services have run, before the stimulus is called.
+     Stimuli due on the same tick are called in the order they were posted.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/17/26 20:30 afb      started coding
+*****************************************************************************/
+
+#ifndef ES_Sim_H
+#define ES_Sim_H
+
+#include "ES_Types.h"
+#include "ES_Framework.h"
+
+// what a stimulus is called with, the Param that it was posted with
+typedef void ES_SimStimulus_t( uint32_t Param );
+
+// public functions
+ES_Return_t ES_SimInitialize( TimerRate_t NewRate );
+bool ES_SimPostAt( uint64_t AtTick, ES_SimStimulus_t * pStimulus,
+                   uint32_t Param );
+ES_Return_t ES_SimRun( uint64_t UntilTick );
+uint64_t ES_SimNow( void );
+
+#endif /* ES_Sim_H */
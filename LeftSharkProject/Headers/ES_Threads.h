@@ -0,0 +1,50 @@
+/****************************************************************************
+ Module
+     ES_Threads.h
+ Description
+     header file for the multi-threaded runtime of the host build of the
+     Events & Services framework
+ Notes
+     With ES_ENABLE_THREADS (ES_PORT_POSIX only) every service is owned by
+     one worker thread and is posted to through a lock-free mailbox, so that
+     the services of a ground station can be spread across cores while each
+     still handles one event at a time, in the order they were posted.
+
+     Service n goes on thread n % NumThreads, so with fewer threads than
+     services a thread runs a group of them, highest priority first, just
+     as ES_Run does.
+
+     ES_Framework.c drives this through the normal post functions, the
+     services do not call it directly. ES_Run keeps the tick and the event
+     checkers on its own thread, and as before only runs the checkers once
+     the services have caught up. See ES_Threads_POSIX.c.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/17/26 19:30 afb      started coding
+*****************************************************************************/
+
+#ifndef ES_Threads_H
+#define ES_Threads_H
+
+#include "ES_Types.h"
+#include "ES_Events.h"
+
+// hands one event to a service, false if its run function reported an error
+typedef bool ES_ThreadRunFunc_t( uint8_t WhichService, ES_Event ThisEvent );
+
+// public functions
+bool ES_ThreadsInit( uint16_t NumServices, uint16_t NumThreads,
+                     uint16_t const * pMailboxSizes,
+                     ES_ThreadRunFunc_t * pRunFunc );
+bool ES_ThreadsStart( void );
+void ES_ThreadsStop( void );
+bool ES_ThreadsFailed( void );
+bool ES_ThreadsPending( void );
+void ES_ThreadsWaitIdle( void );
+bool ES_ThreadPost( uint8_t WhichService, ES_Event ThisEvent );
+bool ES_ThreadPostFront( uint8_t WhichService, ES_Event ThisEvent );
+uint16_t ES_ThreadQueueDepth( uint8_t WhichService );
+
+#endif /* ES_Threads_H */
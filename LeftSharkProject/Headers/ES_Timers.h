@@ -14,6 +14,11 @@
  History
  When           Who	What/Why
  -------------- ---	--------
+ 10/17/26 20:30 afb  added ES_Timer_Ticks_Resp
+ 10/17/26 14:00 afb  added the periodic timer functions
+ 10/17/26 13:30 afb  32 bit durations, added ES_Timer_GetTimeUs
+ 10/17/26 13:00 afb  timer numbers are now uint16_t, added ES_Timer_SetPostFunc
+ 10/17/26 12:30 afb  added ES_Timer_GetTicksToNextExpiry
  10/13/15 20:48 jec  removed prototype for IsTimerActive, I had removed the code
                      a couple of years ago
  08/13/13 12:03 jec  added prototype for ES_Timer_Tick_Resp as part of 
@@ -31,8 +36,10 @@
 #ifndef ES_Timers_H
 #define ES_Timers_H
 
+#include "ES_Configure.h"
 #include "ES_Port.h"
 #include "ES_Types.h"
+#include "ES_PostList.h"
 
 
 typedef enum { ES_Timer_ERR           = -1,
@@ -41,13 +48,23 @@ typedef enum { ES_Timer_ERR           = -1,
                ES_Timer_NOT_ACTIVE    =  0
 } ES_TimerReturn_t;
 
+// returned by ES_Timer_GetTicksToNextExpiry when no timer is running
+#define ES_TIMER_NO_EXPIRY 0xFFFFFFFFUL
+
 void             ES_Timer_Init(TimerRate_t Rate);
 void             ES_Timer_Tick_Resp(void);
-ES_TimerReturn_t ES_Timer_InitTimer(uint8_t Num, uint16_t NewTime);
-ES_TimerReturn_t ES_Timer_SetTimer(uint8_t Num, uint16_t NewTime);
-ES_TimerReturn_t ES_Timer_StartTimer(uint8_t Num);
-ES_TimerReturn_t ES_Timer_StopTimer(uint8_t Num);
+void             ES_Timer_Ticks_Resp(uint32_t NumTicks);
+ES_TimerReturn_t ES_Timer_SetPostFunc(uint16_t Num, pPostFunc PostFunc);
+ES_TimerReturn_t ES_Timer_InitTimer(uint16_t Num, uint32_t NewTime);
+ES_TimerReturn_t ES_Timer_SetTimer(uint16_t Num, uint32_t NewTime);
+ES_TimerReturn_t ES_Timer_InitPeriodicTimer(uint16_t Num, uint32_t Period);
+uint16_t         ES_Timer_GetMissedPeriods(uint16_t Num);
+void             ES_Timer_TimeoutDispatched(uint16_t Num);
+ES_TimerReturn_t ES_Timer_StartTimer(uint16_t Num);
+ES_TimerReturn_t ES_Timer_StopTimer(uint16_t Num);
 uint16_t         ES_Timer_GetTime(void);
+uint64_t         ES_Timer_GetTimeUs(void);
+uint32_t         ES_Timer_GetTicksToNextExpiry(void);
 
 #endif   /* ES_Timers_H */
 /*------------------------------ End of file ------------------------------*/
@@ -0,0 +1,103 @@
+/****************************************************************************
+ Module
+     ES_Trace.h
+ Description
+     header file for the binary event trace of the Events & Services
+     framework
+ Notes
+     Everything but the record format is conditional on ES_ENABLE_TRACE
+     (ES_Configure.h). With it undefined, the hooks that ES_Framework.c and
+     ES_Timers.c use expand to nothing and ES_Trace.c is empty.
+
+     The trace is a ring of the last ES_TRACE_SIZE records, one for every
+     post, dispatch and timeout. Writing a record takes a slot number with
+     one LDREX/STREX, reads the cycle counter and stores 12 bytes, so the
+     hooks may be called from the interrupt responses too.
+
+     The ring is in ES_NOINIT memory. If ES_TraceInit finds a good ring
+     there after a reset it keeps it, and adds an ES_TRACE_RESET record, so
+     the events that led up to a crash or a watchdog reset can be dumped
+     after it.
+
+     The dump that ES_TraceDump writes to the console is, all little endian:
+         "ESTRACE1"                        8 bytes, to find it in a capture
+         uint32_t Size                     ES_TRACE_SIZE
+         uint32_t Head                     records written since cleared
+         uint32_t ClockHz                  rate of the Stamps
+         ES_TraceRecord_t Records[Size]    by slot, record n is in n % Size
+     Tools/ES_TraceDecode.c turns a capture that holds a dump into a
+     timeline.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/17/26 21:00 afb      started coding
+*****************************************************************************/
+
+#ifndef ES_Trace_H
+#define ES_Trace_H
+
+#include "ES_Configure.h"
+#include "ES_Types.h"
+#include "ES_Events.h"
+#include "ES_Port.h"
+
+#define ES_TRACE_SYNC "ESTRACE1"
+#define ES_TRACE_SYNC_LEN 8
+
+// what a record is of
+typedef enum {  ES_TRACE_RESET = 0,   // ES_TraceInit ran, the Stamps restart
+                ES_TRACE_POST,        // Service's queue took the event
+                ES_TRACE_POST_FAILED, // Service's queue was full
+                ES_TRACE_DISPATCH,    // the event was handed to Service
+                ES_TRACE_TIMEOUT      // timer number Service expired
+} ES_TraceKind_t;
+
+typedef struct {
+    uint32_t Stamp;      // _HW_GetCycleCount() when it was written
+    uint16_t EventType;
+    uint16_t EventParam;
+    uint16_t Seq;        // low 16 bits of the record number, to spot a
+                         // slot that was being written when we dumped
+    uint8_t Service;     // the service's index, the timer for a timeout
+    uint8_t Kind;        // an ES_TraceKind_t
+}ES_TraceRecord_t;
+
+#ifdef ES_ENABLE_TRACE
+
+#if ( ES_TRACE_SIZE & ( ES_TRACE_SIZE - 1 ) ) != 0
+#error ES_TRACE_SIZE must be a power of 2
+#endif
+
+// public functions
+void ES_TraceInit( void );
+void ES_TraceDump( void );
+
+// the hook for ES_Framework.c and ES_Timers.c, use the macros below
+void ES_TraceWrite( ES_TraceKind_t Kind, uint8_t Service,
+                    uint16_t EventType, uint16_t EventParam );
+
+#define ES_TRACE_INIT()                   ES_TraceInit()
+#define ES_TRACE_POST(WhichService, ThisEvent, Posted) \
+            ES_TraceWrite( (Posted) ? ES_TRACE_POST : ES_TRACE_POST_FAILED, \
+                           (uint8_t)(WhichService), \
+                           (uint16_t)(ThisEvent).EventType, \
+                           (ThisEvent).EventParam )
+#define ES_TRACE_DISPATCH(WhichService, ThisEvent) \
+            ES_TraceWrite( ES_TRACE_DISPATCH, (uint8_t)(WhichService), \
+                           (uint16_t)(ThisEvent).EventType, \
+                           (ThisEvent).EventParam )
+#define ES_TRACE_TIMEOUT(WhichTimer) \
+            ES_TraceWrite( ES_TRACE_TIMEOUT, (uint8_t)(WhichTimer), \
+                           (uint16_t)ES_TIMEOUT, (uint16_t)(WhichTimer) )
+
+#else /* tracing disabled, the hooks compile out */
+
+#define ES_TRACE_INIT()
+#define ES_TRACE_POST(WhichService, ThisEvent, Posted)
+#define ES_TRACE_DISPATCH(WhichService, ThisEvent)
+#define ES_TRACE_TIMEOUT(WhichTimer)
+
+#endif /* ES_ENABLE_TRACE */
+
+#endif /* ES_Trace_H */
@@ -0,0 +1,168 @@
+/****************************************************************************
+ Module
+     ES_Coalesce.c
+ Description
+     event coalescers, which merge the events from a high-rate interrupt
+     source into one event per burst
+ Notes
+     The ring works like an ES_SPSCQueue_t of bytes: the producer only
+     writes Tail and the consumer only writes Head, so neither side turns
+     interrupts off.
+
+     Pending decides who posts. The producer sets it and posts when it adds
+     an item and finds it clear. The consumer clears it before it looks for
+     items, so an item that arrives after the consumer has looked always
+     finds Pending clear and posts a fresh event, and one that arrives
+     before is taken with the rest. The worst case is an extra event that
+     finds nothing to take.
+
+     See ES_Coalesce.h for how to use one.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/17/26 18:00 afb      Began Coding
+****************************************************************************/
+
+/*----------------------------- Include Files -----------------------------*/
+#include "ES_Configure.h"
+#include "ES_Framework.h"
+#include "ES_Coalesce.h"
+
+/*--------------------------- External Variables --------------------------*/
+
+/*----------------------------- Module Defines ----------------------------*/
+// the most a counting coalescer can hold, one less than the counts wrap at
+#define MAX_COUNT 0xFFFE
+
+/*------------------------------ Module Types -----------------------------*/
+
+/*---------------------------- Module Functions ---------------------------*/
+
+/*---------------------------- Module Variables ---------------------------*/
+
+/*------------------------------ Module Code ------------------------------*/
+/****************************************************************************
+ Function
+     ES_InitCoalescer
+ Parameters
+     ES_Coalescer_t * pCoal, the coalescer to set up
+     uint8_t WhichService, the service to post to (index into ServDescList)
+     ES_EventTyp_t EventType, the type of the event to post
+     uint8_t * pData, the memory for the ring, NULL for a counting coalescer
+     uint16_t DataSize, the size of the ring, must be a power of 2
+ Returns
+     bool, false if the ring size is not a power of 2
+ Description
+     empties the coalescer and clears its counts
+ Notes
+     called from the service's init function, before it enables the
+     interrupt that will post to it
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+bool ES_InitCoalescer( ES_Coalescer_t * pCoal, uint8_t WhichService,
+                       ES_EventTyp_t EventType, uint8_t * pData,
+                       uint16_t DataSize ){
+  if ( (pData != (uint8_t *)0) &&
+       ((DataSize == 0) || ((DataSize & (DataSize - 1)) != 0)) ){
+    return false;
+  }
+  pCoal->pData = pData;
+  pCoal->Mask = (pData != (uint8_t *)0) ? (uint16_t)(DataSize - 1) : MAX_COUNT;
+  pCoal->WhichService = WhichService;
+  pCoal->EventType = EventType;
+  pCoal->NumDropped = 0;
+  pCoal->NumPosted = 0;
+  _HW_AtomicStore16( &pCoal->Head, 0 );
+  _HW_AtomicStore16( &pCoal->Tail, 0 );
+  _HW_AtomicStore16( &pCoal->Pending, 0 );
+  return true;
+}
+
+/****************************************************************************
+ Function
+     ES_CoalescePostISR
+ Parameters
+     ES_Coalescer_t * pCoal, the coalescer
+     uint8_t Data, the item to add, ignored by a counting coalescer
+ Returns
+     bool, false if the item was dropped because the coalescer was full
+ Description
+     adds the item and, if the service does not already have an event on
+     its way, posts one
+ Notes
+     only the producer may call this. If the post fails the item stays in
+     the ring and the next one tries the post again.
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+bool ES_CoalescePostISR( ES_Coalescer_t * pCoal, uint8_t Data ){
+  uint16_t Tail = _HW_AtomicLoad16( &pCoal->Tail );
+  ES_Event ThisEvent;
+
+  if ( (uint16_t)(Tail - _HW_AtomicLoad16( &pCoal->Head )) > pCoal->Mask ){
+    pCoal->NumDropped++;
+    return false;
+  }
+  if ( pCoal->pData != (uint8_t *)0 ){
+    pCoal->pData[ Tail & pCoal->Mask ] = Data;
+  }
+  _HW_AtomicStore16( &pCoal->Tail, (uint16_t)(Tail + 1) );
+
+  if ( _HW_AtomicLoad16( &pCoal->Pending ) == 0 ){
+    _HW_AtomicStore16( &pCoal->Pending, 1 );
+    ThisEvent.EventType = pCoal->EventType;
+    ThisEvent.EventParam = 0;
+    if ( ES_PostToServiceISR( pCoal->WhichService, ThisEvent ) == true ){
+      pCoal->NumPosted++;
+    }else{
+      _HW_AtomicStore16( &pCoal->Pending, 0 );
+    }
+  }
+  return true;
+}
+
+/****************************************************************************
+ Function
+     ES_CoalesceTake
+ Parameters
+     ES_Coalescer_t * pCoal, the coalescer
+     uint8_t * pDest, where to copy the items to, unused (and may be NULL)
+                      for a counting coalescer
+     uint16_t MaxItems, the most items to take (the size of pDest)
+ Returns
+     uint16_t, the number of items taken, 0 once the coalescer is empty
+ Description
+     takes the items that have built up, oldest first
+ Notes
+     only the service that the event goes to may call this. Call it until
+     it returns 0, anything that arrives after that posts a new event.
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+uint16_t ES_CoalesceTake( ES_Coalescer_t * pCoal, uint8_t * pDest,
+                          uint16_t MaxItems ){
+  uint16_t Head;
+  uint16_t NumItems;
+  uint16_t i;
+
+  // from here on a new item posts a new event
+  _HW_AtomicClearBits16( &pCoal->Pending, 1 );
+
+  Head = _HW_AtomicLoad16( &pCoal->Head );
+  NumItems = (uint16_t)(_HW_AtomicLoad16( &pCoal->Tail ) - Head);
+  if ( NumItems > MaxItems ){
+    NumItems = MaxItems;
+  }
+  if ( pCoal->pData != (uint8_t *)0 ){
+    for ( i = 0; i < NumItems; i++ ){
+      pDest[i] = pCoal->pData[ (uint16_t)(Head + i) & pCoal->Mask ];
+    }
+  }
+  _HW_AtomicStore16( &pCoal->Head, (uint16_t)(Head + NumItems) );
+  return NumItems;
+}
+
+/*------------------------------- Footnotes -------------------------------*/
+/*------------------------------ End of file ------------------------------*/
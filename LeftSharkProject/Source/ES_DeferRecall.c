@@ -11,7 +11,8 @@
  History
  When           Who     What/Why
  -------------- ---     --------
- 
+ 10/17/26 15:00 afb     added ES_DeferEvent to hold the payload references of
+                        deferred events
  10/11/14 14:58 jec     converted RecallEvent to RecallEvents to pull all
                         deferred events off the deferral queue
  11/02/13 16:38 jec      Began Coding
@@ -23,6 +24,7 @@
 #include "ES_General.h"
 #include "ES_Events.h"
 #include "ES_DeferRecall.h"
+#include "ES_Payload.h"
 
 /*--------------------------- External Variables --------------------------*/
 
@@ -35,6 +37,32 @@
 /*---------------------------- Module Variables ---------------------------*/
 
 /*------------------------------ Module Code ------------------------------*/
+/****************************************************************************
+ Function
+     ES_DeferEvent
+ Parameters
+     ES_Event * pBlock, pointer to the block of memory that implements the
+        Defer/Recall queue
+     ES_Event Event2Add, the event to defer
+ Returns
+     bool true if the event was added, false if the queue was full
+ Description
+     adds the event to the deferral queue
+ Notes
+     the run function's reference to a payload is dropped when it returns,
+     so the deferral queue takes its own, ES_RecallEvents gives it up
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+bool ES_DeferEvent( ES_Event * pBlock, ES_Event Event2Add ){
+  bool Added = ES_EnQueueLIFO( pBlock, Event2Add );
+
+  if ( Added ){
+    ES_PAYLOAD_HOLD(Event2Add);
+  }
+  return Added;
+}
+
 /****************************************************************************
  Function
      ES_RecallEvents
@@ -62,6 +90,8 @@ bool ES_RecallEvents( uint8_t WhichService, ES_Event * pBlock ){
 		ES_DeQueue( pBlock, &RecalledEvent );
 		if (RecalledEvent.EventType != ES_NO_EVENT){
 			ES_PostToServiceLIFO( WhichService, RecalledEvent);
+			// the service queue holds its own reference now
+			ES_PAYLOAD_DROP(RecalledEvent);
 			WereEventsPulled = true;
 		}
   }while(RecalledEvent.EventType != ES_NO_EVENT);
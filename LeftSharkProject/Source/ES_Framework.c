@@ -1,3 +1,4 @@
+//#define TEST
 /****************************************************************************
  Module
      EF_Framework.c
@@ -8,6 +9,49 @@
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/17/26 23:00 afb      the TEST build command lists ES_Log.c & ES_Trace.c
+ 10/17/26 23:00 afb      ES_PostAll, ES_PostToServiceLIFO and PostStamped
+                         take the payload reference before the enqueue,
+                         PendSV could dispatch and free it in between
+ 10/17/26 22:30 afb      with ES_ENABLE_THREADS the posts compile only the
+                         mailbox path, the queue code is in the #else
+ 10/17/26 22:30 afb      added ES_IsAnyServiceReady for the idle hooks
+ 10/17/26 22:00 afb      EDF_STAMP uses the deadline without EDF too, so that
+                         RelDeadline is not reported as unused
+ 10/17/26 21:30 afb      ES_Run sends the deferred log before it idles
+ 10/17/26 21:00 afb      added the ES_Trace hooks to the posts and dispatches
+ 10/17/26 20:30 afb      ES_ENABLE_SIM checks
+ 10/17/26 20:00 afb      moved the variables into FrameworkVars_t, one set per
+                         node with ES_ENABLE_NODES, and split ES_RunToIdle out
+                         of ES_Run
+ 10/17/26 19:30 afb      added ES_ENABLE_THREADS, where the host build runs
+                         each service on a thread of its own
+ 10/17/26 19:00 afb      added ES_ENABLE_PREEMPTION, where a post to a higher
+                         priority service runs it at once, nested above the
+                         one that was running
+ 10/17/26 18:30 afb      added the ES_ENABLE_EDF option, which picks the ready
+                         service with the earliest head event deadline
+ 10/17/26 17:30 afb      added ES_Subscribe & ES_Publish, which only post to
+                         the services that subscribed to the event type
+ 10/17/26 17:00 afb      added ES_ENABLE_STATIC_DISPATCH, calling the run
+                         functions from a switch built from SERVICE_LIST
+ 10/17/26 16:30 afb      moved the service queues to ES_RingQueue_t, so that
+                         they can hold up to 65535 events
+ 10/17/26 16:00 afb      added ES_PostToServiceISR and the ISR queues, and
+                         made the Ready set updates atomic
+ 10/17/26 15:00 afb      count the payload references of events as they are
+                         posted and dispatched
+ 10/17/26 14:00 afb      tell the timers when an ES_TIMEOUT is dispatched, for
+                         the periodic timers
+ 10/17/26 12:00 afb      added the per queue stats and ES_GetQueueDepth
+ 10/17/26 11:30 afb      added the ES_Profile hooks to the post functions and
+                         around the run function calls
+ 10/17/26 11:00 afb      added the optional burst-drain dispatch and batch
+                         run functions
+ 10/17/26 10:30 afb      build ServDescList and the queues from SERVICE_LIST
+                         and keep Ready as a two level bitmap so that we can
+                         go past 16 services
+ 10/17/26 09:20 afb      call _HW_Idle from ES_Run when no events are pending
  11/02/13 17:05 jec      added PostToServiceLIFO function
  10/21/13 17:50 jec      added entries to expand number of possible services to 
                          16
@@ -27,7 +71,14 @@
 #include "ES_Framework.h"
 #include "ES_Queue.h"
 #include "ES_LookupTables.h"
+#include "ES_Profile.h"
+#include "ES_Trace.h"
+#include "ES_Log.h"
+#include "ES_Payload.h"
+#include "ES_Threads.h"
+#include "ES_Context.h"
 #include <stdio.h>
+#include <string.h>
 
 // Include the header files for the Service modules.
 // This gets you the prototypes for the public service functions.
@@ -38,190 +89,278 @@
 /*----------------------------- Module Defines ----------------------------*/
 typedef bool InitFunc_t( uint8_t Priority );
 typedef ES_Event RunFunc_t( ES_Event ThisEvent );
+typedef ES_Event BatchRunFunc_t( ES_Event const * pEvents, uint8_t NumEvents );
 
 typedef InitFunc_t * pInitFunc;
 typedef RunFunc_t * pRunFunc;
 
 #define NULL_INIT_FUNC ((pInitFunc)0)
 
-typedef struct {
-    InitFunc_t *InitFunc;    // Service Initialization function
-    RunFunc_t *RunFunc;      // Service Run function
-}ES_ServDesc_t;
-
-typedef struct {
-    ES_Event *pMem;       // pointer to the memory
-    uint8_t Size;      // how big is it
-}ES_QueueDesc_t;
-
-/*---------------------------- Module Functions ---------------------------*/
-//static bool CheckSystemEvents( void );
-
-/*---------------------------- Module Variables ---------------------------*/
-/****************************************************************************/
-// You fill in this array with the names of the service init & run functions
-// for each service that you use.
-// The order is: InitFunction, RunFunction
-// The first entry, at index 0, is the lowest priority, with increasing
-// priority with higher indices
+// the periodic timers hold back their next ES_TIMEOUT until the last one
+// has been handed to the service
+#define NOTE_DISPATCH( ThisEvent ) \
+  if ( (ThisEvent).EventType == ES_TIMEOUT ){ \
+    ES_Timer_TimeoutDispatched( (ThisEvent).EventParam ); \
+  }
 
-static ES_ServDesc_t const ServDescList[] =
-{ {SERV_0_INIT, SERV_0_RUN } /* lowest priority  always present */
-#if NUM_SERVICES > 1
-  ,{SERV_1_INIT, SERV_1_RUN }
-#endif
-#if NUM_SERVICES > 2
-  ,{SERV_2_INIT, SERV_2_RUN }
-#endif
-#if NUM_SERVICES > 3
-  ,{SERV_3_INIT, SERV_3_RUN }
+#ifdef ES_ENABLE_EDF
+// with EDF every post gives the event a deadline, ES_Run runs the service
+// with the earliest one at the head of its queue and counts the events that
+// are dispatched late
+#define EDF_STAMP( ThisEvent, RelDeadline ) \
+  ((ThisEvent).Deadline = (uint16_t)(ES_Timer_GetTime() + (RelDeadline)))
+#define NOTE_DEADLINE( WhichService, ThisEvent ) \
+  if ( (int16_t)(ES_Timer_GetTime() - (ThisEvent).Deadline) > 0 ){ \
+    pVars->DeadlineMisses[(WhichService)]++; \
+  }
+#define SELECT_SERVICE() GetEarliestDeadline()
+#else
+// the deadline is thrown away, but counts as used in ES_PostToServiceDeadline
+#define EDF_STAMP( ThisEvent, RelDeadline ) ((void)(RelDeadline))
+#define NOTE_DEADLINE( WhichService, ThisEvent )
+#define SELECT_SERVICE() GetHighestReady()
 #endif
-#if NUM_SERVICES > 4
-  ,{SERV_4_INIT, SERV_4_RUN }
+
+#if defined(ES_ENABLE_PREEMPTION) && defined(ES_ENABLE_EDF)
+#error ES_ENABLE_PREEMPTION preempts by priority, it can not be used with ES_ENABLE_EDF
 #endif
-#if NUM_SERVICES > 5
-  ,{SERV_5_INIT, SERV_5_RUN }
+
+#ifdef ES_ENABLE_NODES
+#ifndef ES_PORT_POSIX
+#error ES_ENABLE_NODES is only for the host build (ES_PORT_POSIX)
 #endif
-#if NUM_SERVICES > 6
-  ,{SERV_6_INIT, SERV_6_RUN }
+#if defined(ES_ENABLE_THREADS) || defined(ES_ENABLE_PREEMPTION) || \
+    defined(ES_ENABLE_PROFILING)
+#error the nodes run on the pool threads, ES_ENABLE_NODES can not be used with THREADS, PREEMPTION or PROFILING
 #endif
-#if NUM_SERVICES > 7
-  ,{SERV_7_INIT, SERV_7_RUN }
+#ifdef ES_ENABLE_TICKLESS_IDLE
+#error the nodes are stepped and never idle, ES_ENABLE_NODES can not be used with ES_ENABLE_TICKLESS_IDLE
 #endif
-#if NUM_SERVICES > 8
-  ,{SERV_8_INIT, SERV_8_RUN }
+#ifdef ES_ENABLE_TRACE
+#error there is one trace ring for the process, ES_ENABLE_NODES can not be used with ES_ENABLE_TRACE
 #endif
-#if NUM_SERVICES > 9
-  ,{SERV_9_INIT, SERV_9_RUN }
 #endif
-#if NUM_SERVICES > 10
-  ,{SERV_10_INIT, SERV_10_RUN }
+
+#ifdef ES_ENABLE_SIM
+#ifndef ES_PORT_POSIX
+#error ES_ENABLE_SIM is only for the host build (ES_PORT_POSIX)
 #endif
-#if NUM_SERVICES > 11
-  ,{SERV_11_INIT, SERV_11_RUN }
+#if defined(ES_ENABLE_THREADS) || defined(ES_ENABLE_PREEMPTION) || \
+    defined(ES_ENABLE_TICKLESS_IDLE) || defined(ES_ENABLE_NODES)
+#error a simulation runs on virtual time in one thread, ES_ENABLE_SIM can not be used with THREADS, PREEMPTION, TICKLESS_IDLE or NODES
 #endif
-#if NUM_SERVICES > 12
-  ,{SERV_12_INIT, SERV_12_RUN }
 #endif
-#if NUM_SERVICES > 13
-  ,{SERV_13_INIT, SERV_13_RUN }
+
+#ifdef ES_ENABLE_THREADS
+#ifndef ES_PORT_POSIX
+#error ES_ENABLE_THREADS is only for the host build (ES_PORT_POSIX)
 #endif
-#if NUM_SERVICES > 14
-  ,{SERV_14_INIT, SERV_14_RUN }
+#if defined(ES_ENABLE_BURST_DRAIN) || defined(ES_ENABLE_EDF) || \
+    defined(ES_ENABLE_PREEMPTION) || defined(ES_ENABLE_QUEUE_STATS)
+#error the service threads dispatch on their own, ES_ENABLE_THREADS can not be used with BURST_DRAIN, EDF, PREEMPTION or QUEUE_STATS
 #endif
-#if NUM_SERVICES > 15
-  ,{SERV_15_INIT, SERV_15_RUN }
 #endif
 
-};
-
-
-/****************************************************************************/
-// The queues for the services
-
-static ES_Event Queue0[SERV_0_QUEUE_SIZE+1];
-#if NUM_SERVICES > 1
-static ES_Event Queue1[SERV_1_QUEUE_SIZE+1];
+// how a selected service is handed its events
+#ifdef ES_ENABLE_BURST_DRAIN
+#define DISPATCH( WhichService ) DispatchBurst( (WhichService) )
+#else
+#define DISPATCH( WhichService ) DispatchOne( (WhichService) )
 #endif
-#if NUM_SERVICES > 2
-static ES_Event Queue2[SERV_2_QUEUE_SIZE+1];
-#endif
-#if NUM_SERVICES > 3
-static ES_Event Queue3[SERV_3_QUEUE_SIZE+1];
+
+#ifdef ES_ENABLE_PREEMPTION
+// after every post, run the service at once if it is above the running one
+#define PREEMPT() Preempt()
+#else
+#define PREEMPT()
 #endif
-#if NUM_SERVICES > 4
-static ES_Event Queue4[SERV_4_QUEUE_SIZE+1];
+
+// how ES_Run calls the run function of a service, see RunByNumber
+#ifdef ES_ENABLE_STATIC_DISPATCH
+#define CALL_RUN_FUNC( WhichService, ThisEvent ) \
+  RunByNumber( (WhichService), (ThisEvent) )
+#else
+#define CALL_RUN_FUNC( WhichService, ThisEvent ) \
+  ServDescList[(WhichService)].RunFunc( (ThisEvent) )
 #endif
-#if NUM_SERVICES > 5
-static ES_Event Queue5[SERV_5_QUEUE_SIZE+1];
+
+#ifdef ES_ENABLE_QUEUE_STATS
+#define RECORD_POST( WhichService, ThisEvent, Posted ) \
+            RecordPost( (WhichService), (ThisEvent).EventType, (Posted) )
+#else
+#define RECORD_POST( WhichService, ThisEvent, Posted )
 #endif
-#if NUM_SERVICES > 6
-static ES_Event Queue6[SERV_6_QUEUE_SIZE+1];
+
+typedef struct {
+    InitFunc_t *InitFunc;    // Service Initialization function
+    RunFunc_t *RunFunc;      // Service Run function
+#ifdef ES_ENABLE_BURST_DRAIN
+    uint8_t BurstLimit;      // most events to dispatch per selection
+    BatchRunFunc_t *RunBatchFunc; // Service Batch Run function, may be NULL
 #endif
-#if NUM_SERVICES > 7
-static ES_Event Queue7[SERV_7_QUEUE_SIZE+1];
+}ES_ServDesc_t;
+
+/*---------------------------- Module Functions ---------------------------*/
+//static bool CheckSystemEvents( void );
+static void SetReady( uint8_t WhichService );
+static void ClearReady( uint8_t WhichService );
+static uint8_t GetHighestReady( void );
+#ifdef ES_ENABLE_EDF
+static uint8_t GetEarliestDeadline( void );
+static bool GetHeadDeadline( uint8_t WhichService, uint16_t * pDeadline );
 #endif
-#if NUM_SERVICES > 8
-static ES_Event Queue8[SERV_8_QUEUE_SIZE+1];
+static bool PostStamped( uint8_t WhichService, ES_Event TheEvent );
+static uint8_t TakeEvents( uint8_t WhichService, ES_Event * pDest,
+                           uint8_t MaxEvents, uint8_t * pNumTaken );
+#if defined(ES_ENABLE_STATIC_DISPATCH) || defined(TEST)
+static ES_Event RunByNumber( uint8_t WhichService, ES_Event ThisEvent );
 #endif
-#if NUM_SERVICES > 9
-static ES_Event Queue9[SERV_9_QUEUE_SIZE+1];
+#ifdef ES_ENABLE_BURST_DRAIN
+static bool DispatchBurst( uint8_t WhichService );
+#else
+static bool DispatchOne( uint8_t WhichService );
+static bool RunEvent( uint8_t WhichService, ES_Event ThisEvent );
 #endif
-#if NUM_SERVICES > 10
-static ES_Event Queue10[SERV_10_QUEUE_SIZE+1];
+#ifdef ES_ENABLE_THREADS
+static bool ThreadPost( uint8_t WhichService, ES_Event TheEvent,
+                        bool ToFront );
 #endif
-#if NUM_SERVICES > 11
-static ES_Event Queue11[SERV_11_QUEUE_SIZE+1];
+#ifdef ES_ENABLE_PREEMPTION
+static void Preempt( void );
 #endif
-#if NUM_SERVICES > 12
-static ES_Event Queue12[SERV_12_QUEUE_SIZE+1];
+#ifdef ES_ENABLE_QUEUE_STATS
+static void RecordPost( uint8_t WhichService, ES_EventTyp_t EventType,
+                        bool Posted );
 #endif
-#if NUM_SERVICES > 13
-static ES_Event Queue13[SERV_13_QUEUE_SIZE+1];
+
+/*---------------------------- Module Variables ---------------------------*/
+/****************************************************************************/
+// This array is filled in from SERVICE_LIST in ES_Configure.h with the names
+// of the service init & run functions for each service that you use.
+// The order is: InitFunction, RunFunction (, BurstLimit, BatchRunFunction)
+// The first entry, at index 0, is the lowest priority, with increasing
+// priority with higher indices
+#ifdef ES_ENABLE_BURST_DRAIN
+#define ES_SERV_DESC( Init, Run, QueueSize, BurstLimit, RunBatch ) \
+  { Init, Run, BurstLimit, RunBatch },
+#else
+#define ES_SERV_DESC( Init, Run, QueueSize, BurstLimit, RunBatch ) \
+  { Init, Run },
 #endif
-#if NUM_SERVICES > 14
-static ES_Event Queue14[SERV_14_QUEUE_SIZE+1];
+
+static ES_ServDesc_t const ServDescList[] =
+{
+  SERVICE_LIST(ES_SERV_DESC)
+};
+
+#if defined(ES_ENABLE_STATIC_DISPATCH) || defined(TEST)
+// the service numbers, as constants for the cases in RunByNumber
+#define ES_SERVICE_NUM( Init, Run, QueueSize, BurstLimit, RunBatch ) \
+  Run##ServiceNum,
+
+enum { SERVICE_LIST(ES_SERVICE_NUM) };
 #endif
-#if NUM_SERVICES > 15
-static ES_Event Queue15[SERV_15_QUEUE_SIZE+1];
+
+// make sure that the list fits in the Ready set
+typedef char ES_TooManyServices[(NUM_SERVICES <= MAX_NUM_SERVICES) ? 1 : -1];
+
+#ifdef ES_ENABLE_BURST_DRAIN
+// and that every burst limit fits in the burst buffer
+#define ES_CHECK_BURST( Init, Run, QueueSize, BurstLimit, RunBatch ) \
+  typedef char Run##BurstLimitCheck[((BurstLimit) >= 1) && \
+                                    ((BurstLimit) <= ES_MAX_BURST) ? 1 : -1];
+SERVICE_LIST(ES_CHECK_BURST)
 #endif
 
 /****************************************************************************/
-// array of queue descriptors for posting by priority level
+// The queues for the services, one per SERVICE_LIST entry, laid end to end
+// in QueueSlots in the same order. The ring queues keep their headers
+// apart, so every slot holds an event and a queue can hold up to 65535 of
+// them.
 
-static ES_QueueDesc_t const EventQueues[NUM_SERVICES] = { 
-  { Queue0, ARRAY_SIZE(Queue0) } 
-#if NUM_SERVICES > 1
-, { Queue1, ARRAY_SIZE(Queue1) }
-#endif
-#if NUM_SERVICES > 2
-, { Queue2, ARRAY_SIZE(Queue2) }
-#endif
-#if NUM_SERVICES > 3
-, { Queue3, ARRAY_SIZE(Queue3) }
-#endif
-#if NUM_SERVICES > 4
-, { Queue4, ARRAY_SIZE(Queue4) }
-#endif
-#if NUM_SERVICES > 5
-, { Queue5, ARRAY_SIZE(Queue5) }
-#endif
-#if NUM_SERVICES > 6
-, { Queue6, ARRAY_SIZE(Queue6) }
-#endif
-#if NUM_SERVICES > 7
-, { Queue7, ARRAY_SIZE(Queue7) }
-#endif
-#if NUM_SERVICES > 8
-, { Queue8, ARRAY_SIZE(Queue8) }
-#endif
-#if NUM_SERVICES > 9
-, { Queue9, ARRAY_SIZE(Queue9) }
-#endif
-#if NUM_SERVICES > 10
-, { Queue10, ARRAY_SIZE(Queue10) }
-#endif
-#if NUM_SERVICES > 11
-, { Queue11, ARRAY_SIZE(Queue11) }
-#endif
-#if NUM_SERVICES > 12
-, { Queue12, ARRAY_SIZE(Queue12) }
-#endif
-#if NUM_SERVICES > 13
-, { Queue13, ARRAY_SIZE(Queue13) }
-#endif
-#if NUM_SERVICES > 14
-, { Queue14, ARRAY_SIZE(Queue14) }
+#define ES_QUEUE_SIZE( Init, Run, QueueSize, BurstLimit, RunBatch ) \
+  (QueueSize),
+
+static uint16_t const QueueSizes[NUM_SERVICES] = {
+  SERVICE_LIST(ES_QUEUE_SIZE)
+};
+
+#define ES_QUEUE_SLOTS( Init, Run, QueueSize, BurstLimit, RunBatch ) \
+  + (QueueSize)
+#define NUM_QUEUE_SLOTS (0 SERVICE_LIST(ES_QUEUE_SLOTS))
+
+// make sure that every queue size fits in the ring queue's 16-bit counts
+#define ES_CHECK_QUEUE( Init, Run, QueueSize, BurstLimit, RunBatch ) \
+  typedef char Run##QueueSizeCheck[((QueueSize) >= 1) && \
+                                   ((QueueSize) <= UINT16_MAX) ? 1 : -1];
+SERVICE_LIST(ES_CHECK_QUEUE)
+
+/****************************************************************************/
+// The Ready set is a two level bitmap: bit n of ReadyGroups is set whenever
+// Ready[n] is non-zero and bit m of Ready[n] is set when the queue for
+// service (n * READY_GROUP_SIZE + m) is non-empty. Finding the highest
+// priority ready service then takes two ES_GetMSBitSet calls no matter how
+// many services there are.
+
+// Interrupt responses set bits while ES_Run is clearing others, so every
+// change to the set is an atomic read-modify-write (see ES_Port.h).
+
+#define READY_GROUP_SIZE (sizeof(uint16_t)*BITS_PER_BYTE)
+#define NUM_READY_GROUPS \
+            ((NUM_SERVICES + READY_GROUP_SIZE - 1) / READY_GROUP_SIZE)
+
+/****************************************************************************/
+// the framework's variables, one set per node with ES_ENABLE_NODES (see
+// ES_Context.h)
+typedef struct {
+    // the storage for the queues, and the queues themselves, for posting
+    // by priority level
+    ES_Event QueueSlots[NUM_QUEUE_SLOTS];
+    ES_RingQueue_t EventQueues[NUM_SERVICES];
+
+    // which queues have events in them, see above
+    ES_Atomic16_t ReadyGroups;
+    ES_Atomic16_t Ready[NUM_READY_GROUPS];
+
+    // the single producer queues that interrupt responses post to through
+    // ES_PostToServiceISR, NULL for the services that do not have one
+    ES_SPSCQueue_t * ISRQueues[NUM_SERVICES];
+
+    // the subscribers to each event type, for ES_Publish. These are bitmaps
+    // laid out in the same groups as Ready, bit m of Subscribers[Type][n] is
+    // set when service (n * READY_GROUP_SIZE + m) has subscribed to Type.
+    uint16_t Subscribers[ES_NUM_EVENT_TYPES][NUM_READY_GROUPS];
+
+#ifdef ES_ENABLE_EDF
+    // the number of events dispatched to each service after their deadlines
+    uint32_t DeadlineMisses[NUM_SERVICES];
 #endif
-#if NUM_SERVICES > 15
-, { Queue15, ARRAY_SIZE(Queue15) }
+#ifdef ES_ENABLE_QUEUE_STATS
+    // the high-water marks and post counts for each queue, Capacity and
+    // Depth are only filled in when a snapshot is taken
+    ES_QueueStats_t QueueStats[NUM_SERVICES];
 #endif
-};
+}FrameworkVars_t;
+
+ES_CONTEXT_VARS( FrameworkVars_t, ES_Framework );
+#define pVars ES_CONTEXT( FrameworkVars_t, ES_Framework )
 
+#ifdef ES_ENABLE_PREEMPTION
 /****************************************************************************/
-// Variable used to keep track of which queues have events in them
+// the priority level that is running: 0 for ES_Run (and the event checkers)
+// and WhichService + 1 while a service's run function is running. A post
+// only preempts when it makes a service above this level ready.
+static volatile uint16_t ActiveLevel;
 
-uint16_t Ready;
+// while non-zero, posts mark services ready but nothing preempts, see
+// ES_SchedLock. Held until ES_Initialize is done, so that an init function
+// that posts does not run a service before the rest have been initialized.
+static volatile uint8_t SchedLockCount = 1;
+
+// set when a run function that was run from a post or from PendSV reports
+// an error, for ES_Run to return
+static volatile bool RunFailed;
+#endif
 
 /*------------------------------ Module Code ------------------------------*/
 /****************************************************************************
@@ -240,19 +379,39 @@ uint16_t Ready;
    J. Edward Carryer, 10/23/11,
 ****************************************************************************/
 ES_Return_t ES_Initialize( TimerRate_t NewRate ){
-  uint8_t i;
+  ES_Event * pSlots = pVars->QueueSlots;
+  uint16_t i;
   ES_Timer_Init( NewRate); // start up the timer subsystem
+  ES_PROFILE_INIT();
+  ES_TRACE_INIT();
+#ifdef ES_ENABLE_PREEMPTION
+  _HW_PreemptInit(); // the inits may post
+#endif
+  ES_PayloadInit(); // before the inits, they may allocate payloads
+#ifdef ES_ENABLE_THREADS
+  // the mailboxes, before the inits, which may post
+  if ( ES_ThreadsInit( NUM_SERVICES, ES_NUM_THREADS, QueueSizes,
+                       RunEvent ) != true ){
+    return FailedInit;
+  }
+#endif
+  // the services subscribe from their init functions
+  memset( pVars->Subscribers, 0, sizeof(pVars->Subscribers) );
   // loop through the list testing for NULL pointers and
   for ( i=0; i< ARRAY_SIZE(ServDescList); i++) {
     if ( (ServDescList[i].InitFunc == (pInitFunc)0) ||
          (ServDescList[i].RunFunc == (pRunFunc)0) )
       return FailedPointer; // protect against NULL pointers
     // and initializing the event queues (must happen before running inits)  
-    ES_InitQueue( EventQueues[i].pMem, EventQueues[i].Size );
+    ES_InitRingQueue( &pVars->EventQueues[i], pSlots, QueueSizes[i] );
+    pSlots += QueueSizes[i];
    // executing the init functions
     if ( ServDescList[i].InitFunc(i) != true )
       return FailedInit; // this is a failed initialization
   }
+#ifdef ES_ENABLE_PREEMPTION
+  SchedLockCount = 0; // ES_Run runs whatever the inits posted
+#endif
   return Success;
 }
 
@@ -271,33 +430,97 @@ ES_Return_t ES_Initialize( TimerRate_t NewRate ){
    user generated events.
  Notes
    this function only returns in case of an error
+   with ES_ENABLE_BURST_DRAIN, the selected service is given up to its burst
+   limit of events before pending interrupts are processed and the highest
+   priority service is chosen again.
+   With ES_ENABLE_PREEMPTION most events are dispatched from the posts (or
+   from PendSV), this loop only picks up what is left when they return.
+   With ES_ENABLE_THREADS the services run on their own threads and nothing
+   is ever marked Ready, so this loop only runs the tick and the event
+   checkers, waiting in ES_ThreadsWaitIdle while the mailboxes empty.
  Author
    J. Edward Carryer, 10/23/11,
 ****************************************************************************/
 ES_Return_t ES_Run( void ){
-  // make these static to improve speed
-  uint8_t HighestPrior;
-  static ES_Event ThisEvent;
+
+#ifdef ES_ENABLE_THREADS
+  if ( ES_ThreadsStart() != true ){
+    return FailedRun;
+  }
+#endif
   
   while(1){ // stay here unless we detect an error condition
 
-    // loop through the list executing the run functions for services
-    // with a non-empty queue. Process any pending ints before testing
-    // Ready
-    while( (_HW_Process_Pending_Ints()) && (Ready != 0)){
-      HighestPrior =  ES_GetMSBitSet(Ready);
-      if ( ES_DeQueue( EventQueues[HighestPrior].pMem, &ThisEvent ) == 0 ){
-        Ready &= BitNum2ClrMask[HighestPrior]; // mark queue as now empty
-      }
-      if( ServDescList[HighestPrior].RunFunc(ThisEvent).EventType != 
-                                                              ES_NO_EVENT) {
-              return FailedRun;
+    // run the services with a non-empty queue until they are all empty
+    if ( ES_RunToIdle() != Success ){
+      return FailedRun;
+    }
+#ifdef ES_ENABLE_THREADS
+    if ( ES_ThreadsFailed() ){
+      return FailedRun;
+    }
+    // as with the queues, only look for new events once the services have
+    // caught up
+    if ( ES_ThreadsPending() ){
+      ES_ThreadsWaitIdle();
+      continue;
+    }
+#endif
+
+    // all the queues are empty, so look for new user detected events and,
+    // if there were none, send a logged message (one at a time, so that the
+    // checkers still run between them) or, once the log is empty, give the
+    // port a chance to idle until the next tick or interrupt
+    if ( ES_CheckUserEvents() == false ){
+      if ( ES_LOG_DRAIN() == false ){
+        _HW_Idle();
       }
     }
+  }
+}
+
+/****************************************************************************
+ Function
+   ES_RunToIdle
+ Parameters
+   None
+ Returns
+   ES_Return_t : FailedRun if any of the run functions failed, Success once
+                 all of the queues are empty
+ Description
+   runs the services with a non-empty queue, highest priority first, until
+   there are no events left for any of them
+ Notes
+   the inner loop of ES_Run. With ES_ENABLE_NODES it is also how a node
+   runs its services for a step (see ES_Nodes_POSIX.c), and with
+   ES_ENABLE_SIM how ES_SimRun runs them between steps of time.
+ Author
+   Drew Bell, 10/17/26
+****************************************************************************/
+ES_Return_t ES_RunToIdle( void ){
+#ifndef ES_ENABLE_PREEMPTION
+  uint8_t HighestPrior;
+#endif
 
-    // all the queues are empty, so look for new user detected events
-    ES_CheckUserEvents();
+  // loop through the list executing the run functions for services
+  // with a non-empty queue. Process any pending ints before testing
+  // Ready
+  while( (_HW_Process_Pending_Ints()) && (pVars->ReadyGroups != 0)){
+#ifdef ES_ENABLE_PREEMPTION
+    _HW_DisableInts();
+    ES_Activate();
+    _HW_EnableInts();
+    if ( RunFailed ){
+      return FailedRun;
+    }
+#else
+    HighestPrior =  SELECT_SERVICE();
+    if ( DISPATCH(HighestPrior) != true ){
+      return FailedRun;
+    }
+#endif
   }
+  return Success;
 }
 
 /****************************************************************************
@@ -316,16 +539,34 @@ ES_Return_t ES_Run( void ){
 ****************************************************************************/
 bool ES_PostAll( ES_Event ThisEvent){
 
-  uint8_t i;
+  uint16_t i;
+  ES_PROFILE_STAMP(ThisEvent);
+  EDF_STAMP(ThisEvent, ES_EDF_DEFAULT_DEADLINE);
   // loop through the list executing the post functions
-  for ( i=0; i< ARRAY_SIZE(EventQueues); i++) {
-    if ( ES_EnQueueFIFO( EventQueues[i].pMem, ThisEvent ) != true ){
+  for ( i=0; i< NUM_SERVICES; i++) {
+#ifdef ES_ENABLE_THREADS
+    if ( ThreadPost( i, ThisEvent, false ) != true ){
+      break; // this is a failed post
+    }
+#else
+    // the service may take the event as soon as it is in the queue (from
+    // PendSV with ES_ENABLE_PREEMPTION), so the payload reference has to be
+    // there first
+    ES_PAYLOAD_HOLD(ThisEvent);
+    if ( ES_RingEnQueueFIFO( &pVars->EventQueues[i], ThisEvent ) != true ){
+      ES_PAYLOAD_DROP(ThisEvent);
+      RECORD_POST(i, ThisEvent, false);
+      ES_TRACE_POST(i, ThisEvent, false);
       break; // this is a failed post
     }else{
-      Ready |= BitNum2SetMask[i]; // show queue as non-empty
+      SetReady(i); // show queue as non-empty
+      RECORD_POST(i, ThisEvent, true);
+      ES_TRACE_POST(i, ThisEvent, true);
     }
+#endif
   }
-  if ( i == ARRAY_SIZE(EventQueues) ){ // if no failures
+  PREEMPT();
+  if ( i == NUM_SERVICES ){ // if no failures
     return (true);
   }else{
     return(false);
@@ -348,13 +589,32 @@ bool ES_PostAll( ES_Event ThisEvent){
    J. Edward Carryer, 01/16/12,
 ****************************************************************************/
 bool ES_PostToService( uint8_t WhichService, ES_Event TheEvent){
-  if ((WhichService < ARRAY_SIZE(EventQueues)) &&
-      (ES_EnQueueFIFO( EventQueues[WhichService].pMem, TheEvent) == 
-                                                                true )){
-    Ready |= BitNum2SetMask[WhichService]; // show queue as non-empty
-    return true;
-  } else
-    return false;
+  EDF_STAMP(TheEvent, ES_EDF_DEFAULT_DEADLINE);
+  return PostStamped( WhichService, TheEvent );
+}
+
+/****************************************************************************
+ Function
+   ES_PostToServiceDeadline
+ Parameters
+   uint8_t : Which service to post to (index into ServDescList)
+   ES_Event : The Event to be posted
+   uint16_t : how many ES_Timer ticks from now the event is due, less than
+              32768
+ Returns
+   boolean : False if the post function failed during execution
+ Description
+   posts to one of the services' queues, with a deadline for ES_ENABLE_EDF
+ Notes
+   without ES_ENABLE_EDF the deadline is ignored and this is the same as
+   ES_PostToService, so services can use it either way
+ Author
+   Drew Bell, 10/17/26
+****************************************************************************/
+bool ES_PostToServiceDeadline( uint8_t WhichService, ES_Event TheEvent,
+                               uint16_t RelDeadline ){
+  EDF_STAMP(TheEvent, RelDeadline);
+  return PostStamped( WhichService, TheEvent );
 }
 
 /****************************************************************************
@@ -368,23 +628,1057 @@ bool ES_PostToService( uint8_t WhichService, ES_Event TheEvent){
  Description
    Posts, using LIFO strategy, to one of the services' queues
  Notes
-   used by the Defer/Recall event capability
+   used by the Defer/Recall event capability. With ES_ENABLE_EDF the event
+   keeps the deadline that it was first posted with. With ES_ENABLE_THREADS
+   only the service itself may post to its front, once ES_Run has started.
  Author
    J. Edward Carryer, 11/02/13
 ****************************************************************************/
 bool ES_PostToServiceLIFO( uint8_t WhichService, ES_Event TheEvent){
-  if ((WhichService < ARRAY_SIZE(EventQueues)) &&
-      (ES_EnQueueLIFO( EventQueues[WhichService].pMem, TheEvent) == 
-                                                                true )){
-    Ready |= BitNum2SetMask[WhichService]; // show queue as non-empty
-    return true;
-  } else
+#ifndef ES_ENABLE_THREADS
+  bool Posted;
+#endif
+
+  ES_PROFILE_STAMP(TheEvent);
+  if ( WhichService >= NUM_SERVICES ){
     return false;
+  }
+#ifdef ES_ENABLE_THREADS
+  return ThreadPost( WhichService, TheEvent, true );
+#else
+  // the payload reference goes in ahead of the event, as in PostStamped
+  ES_PAYLOAD_HOLD(TheEvent);
+  Posted = ES_RingEnQueueLIFO( &pVars->EventQueues[WhichService], TheEvent);
+  if ( Posted ){
+    SetReady(WhichService); // show queue as non-empty
+  }else{
+    ES_PAYLOAD_DROP(TheEvent);
+  }
+  RECORD_POST(WhichService, TheEvent, Posted);
+  ES_TRACE_POST(WhichService, TheEvent, Posted);
+  if ( Posted ){
+    PREEMPT();
+  }
+  return Posted;
+#endif
 }
 
-//*********************************
-// private functions
-//*********************************
+/****************************************************************************
+ Function
+   ES_Subscribe / ES_Unsubscribe
+ Parameters
+   uint8_t : Which service is (un)subscribing (index into ServDescList)
+   ES_EventTyp_t : the event type
+ Returns
+   boolean : False if WhichService or EventType is out of range
+ Description
+   adds the service to (or takes it off) the subscribers that ES_Publish
+   posts events of this type to
+ Notes
+   usually called from the service's init function, with its Priority
+ Author
+   Drew Bell, 10/17/26
+****************************************************************************/
+bool ES_Subscribe( uint8_t WhichService, ES_EventTyp_t EventType ){
+  if ( (WhichService >= NUM_SERVICES) ||
+       ((uint16_t)EventType >= ES_NUM_EVENT_TYPES) ){
+    return false;
+  }
+  EnterCritical(); // ES_Publish may be running in an interrupt response
+  pVars->Subscribers[EventType][WhichService / READY_GROUP_SIZE] |=
+      (uint16_t)(1u << (WhichService % READY_GROUP_SIZE));
+  ExitCritical();
+  return true;
+}
+
+bool ES_Unsubscribe( uint8_t WhichService, ES_EventTyp_t EventType ){
+  if ( (WhichService >= NUM_SERVICES) ||
+       ((uint16_t)EventType >= ES_NUM_EVENT_TYPES) ){
+    return false;
+  }
+  EnterCritical();
+  pVars->Subscribers[EventType][WhichService / READY_GROUP_SIZE] &=
+      (uint16_t)~(1u << (WhichService % READY_GROUP_SIZE));
+  ExitCritical();
+  return true;
+}
+
+/****************************************************************************
+ Function
+   ES_Publish
+ Parameters
+   ES_Event : The Event to be published
+ Returns
+   boolean : False if any of the posts failed, or the type is out of range
+ Description
+   posts the event to the services that have subscribed to its type, and
+   only to them, highest priority first
+ Notes
+   unlike ES_PostAll, a full queue does not stop the event from going to
+   the rest of the subscribers. An event type with no subscribers is not
+   an error.
+ Author
+   Drew Bell, 10/17/26
+****************************************************************************/
+bool ES_Publish( ES_Event ThisEvent ){
+  bool AllPosted = true;
+  uint16_t Mask;
+  uint8_t Group;
+  uint8_t Bit;
+
+  if ( (uint16_t)ThisEvent.EventType >= ES_NUM_EVENT_TYPES ){
+    return false;
+  }
+  for ( Group = NUM_READY_GROUPS; Group > 0; Group-- ){
+    Mask = pVars->Subscribers[ThisEvent.EventType][Group - 1];
+    while ( Mask != 0 ){
+      Bit = ES_GetMSBitSet( Mask );
+      Mask &= (uint16_t)~(1u << Bit);
+      if ( ES_PostToService( (uint8_t)((Group - 1) * READY_GROUP_SIZE + Bit),
+                             ThisEvent ) != true ){
+        AllPosted = false;
+      }
+    }
+  }
+  return AllPosted;
+}
+
+/****************************************************************************
+ Function
+   ES_AttachISRQueue
+ Parameters
+   uint8_t : Which service the queue belongs to (index into ServDescList)
+   ES_SPSCQueue_t * : the queue, already set up with ES_InitSPSCQueue
+ Returns
+   boolean : False if WhichService is not a valid service number
+ Description
+   gives the service a single producer queue for ES_PostToServiceISR
+ Notes
+   called from the service's init function, before it enables the
+   interrupt that will post to it
+ Author
+   Drew Bell, 10/17/26
+****************************************************************************/
+bool ES_AttachISRQueue( uint8_t WhichService, ES_SPSCQueue_t * pQueue ){
+  if ( WhichService >= NUM_SERVICES ){
+    return false;
+  }
+  pVars->ISRQueues[WhichService] = pQueue;
+  return true;
+}
+
+/****************************************************************************
+ Function
+   ES_PostToServiceISR
+ Parameters
+   uint8_t : Which service to post to (index into ServDescList)
+   ES_Event : The Event to be posted
+ Returns
+   boolean : False if the queue was full or the service has no ISR queue
+ Description
+   posts to the service's ISR queue without turning interrupts off
+ Notes
+   for the one interrupt response (or host thread) that produces for the
+   queue, nothing else may post through here to the same service. Events
+   from the ISR queue are dispatched after those in the service's normal
+   queue. The queue stats do not count these posts, since updating them
+   would need a critical region. With ES_ENABLE_THREADS the mailboxes take
+   posts from any thread, so this is the same as ES_PostToService and no
+   ISR queue is needed.
+ Author
+   Drew Bell, 10/17/26
+****************************************************************************/
+bool ES_PostToServiceISR( uint8_t WhichService, ES_Event TheEvent){
+#ifndef ES_ENABLE_THREADS
+  ES_SPSCQueue_t * pQueue;
+#endif
+
+  ES_PROFILE_STAMP(TheEvent);
+  if ( WhichService >= NUM_SERVICES ){
+    return false;
+  }
+#ifdef ES_ENABLE_THREADS
+  return ThreadPost( WhichService, TheEvent, false );
+#else
+  pQueue = pVars->ISRQueues[WhichService];
+  if ( pQueue == (ES_SPSCQueue_t *)0 ){
+    return false;
+  }
+  EDF_STAMP(TheEvent, ES_EDF_DEFAULT_DEADLINE);
+  // the service may take the event as soon as it is in the queue, so the
+  // payload reference has to be there first
+  ES_PAYLOAD_HOLD(TheEvent);
+  if ( ES_SPSCEnQueue( pQueue, TheEvent ) != true ){
+    ES_PAYLOAD_DROP(TheEvent);
+    ES_TRACE_POST(WhichService, TheEvent, false);
+    return false;
+  }
+  ES_TRACE_POST(WhichService, TheEvent, true);
+  SetReady(WhichService); // show queue as non-empty
+  PREEMPT();
+  return true;
+#endif
+}
+
+/****************************************************************************
+ Function
+   ES_GetQueueDepth
+ Parameters
+   uint8_t : Which service's queue to look at (index into ServDescList)
+ Returns
+   uint16_t : the number of events waiting in the queue, 0 for a bad index
+ Description
+   lets a service (or a test) see how far behind a queue is
+ Notes
+
+ Author
+   Drew Bell, 10/17/26
+****************************************************************************/
+uint16_t ES_GetQueueDepth( uint8_t WhichService ){
+#ifndef ES_ENABLE_THREADS
+  uint32_t Depth;
+#endif
+
+  if ( WhichService >= NUM_SERVICES ){
+    return 0;
+  }
+#ifdef ES_ENABLE_THREADS
+  return ES_ThreadQueueDepth( WhichService );
+#else
+  Depth = ES_RingQueueDepth( &pVars->EventQueues[WhichService] );
+  if ( pVars->ISRQueues[WhichService] != (ES_SPSCQueue_t *)0 ){
+    Depth += ES_SPSCQueueDepth( pVars->ISRQueues[WhichService] );
+  }
+  return (Depth > UINT16_MAX) ? UINT16_MAX : (uint16_t)Depth;
+#endif
+}
+
+/****************************************************************************
+ Function
+   ES_IsAnyServiceReady
+ Parameters
+   None
+ Returns
+   bool : true if any service has an event waiting, in either queue
+ Description
+   lets the port check, with interrupts off, that nothing was posted since
+   ES_RunToIdle last found the queues empty, before it goes to sleep
+ Notes
+   the ISR queues are checked as well as the Ready set, so that an event
+   that an interrupt response has queued is seen even before the response
+   has marked the service Ready
+ Author
+   Drew Bell, 10/17/26
+****************************************************************************/
+bool ES_IsAnyServiceReady( void ){
+  uint16_t i;
+
+  if ( _HW_AtomicLoad16( &pVars->ReadyGroups ) != 0 ){
+    return true;
+  }
+  for ( i = 0; i < NUM_SERVICES; i++ ){
+    if ( (pVars->ISRQueues[i] != (ES_SPSCQueue_t *)0) &&
+         (ES_SPSCQueueDepth( pVars->ISRQueues[i] ) != 0) ){
+      return true;
+    }
+  }
+  return false;
+}
+
+#ifdef ES_ENABLE_PREEMPTION
+/****************************************************************************
+ Function
+   ES_Activate
+ Parameters
+   None
+ Returns
+   nothing
+ Description
+   runs the ready services that are above the level that was running when
+   it was called, highest priority first, each at its own level, and goes
+   back to that level once there are none left
+ Notes
+   must be called with interrupts off and returns with them off, they are
+   on while the run functions are running. Called by ES_Run, and by the
+   port (PendSV on the target) after a post has asked for it with
+   _HW_PendScheduler. An error from a run function is left in RunFailed
+   for ES_Run, since there is nobody else to return it to.
+ Author
+   Drew Bell, 10/17/26
+****************************************************************************/
+void ES_Activate( void ){
+  uint16_t PrevLevel = ActiveLevel;
+  uint8_t Next;
+
+  while ( (SchedLockCount == 0) &&
+          (_HW_AtomicLoad16( &pVars->ReadyGroups ) != 0) ){
+    Next = GetHighestReady();
+    if ( (uint16_t)(Next + 1) <= PrevLevel ){
+      break; // the rest wait for the level that we preempted
+    }
+    ActiveLevel = (uint16_t)(Next + 1);
+    _HW_EnableInts();
+    if ( DISPATCH(Next) != true ){
+      RunFailed = true;
+    }
+    _HW_DisableInts();
+  }
+  ActiveLevel = PrevLevel;
+}
+
+/****************************************************************************
+ Function
+   ES_SchedLock / ES_SchedUnlock
+ Parameters
+   None
+ Returns
+   nothing
+ Description
+   while locked, posts still make services ready but none of them preempt
+   the running code. Unlocking runs any that became ready in between.
+ Notes
+   the locks nest. Interrupts stay on, so this protects data shared with
+   the other services (like the timer list) but not with interrupt
+   responses. Keep the locked regions short, they hold off every service.
+ Author
+   Drew Bell, 10/17/26
+****************************************************************************/
+void ES_SchedLock( void ){
+  SchedLockCount++;
+}
+
+void ES_SchedUnlock( void ){
+  if ( --SchedLockCount == 0 ){
+    Preempt();
+  }
+}
+
+#endif
+
+#ifdef ES_ENABLE_EDF
+/****************************************************************************
+ Function
+   ES_GetDeadlineMisses
+ Parameters
+   uint8_t : Which service to report on (index into ServDescList)
+ Returns
+   uint32_t : the number of its events that were dispatched after their
+              deadlines, 0 for a bad index
+ Description
+   lets a service (or a test) see how often a service is running late
+ Notes
+
+ Author
+   Drew Bell, 10/17/26
+****************************************************************************/
+uint32_t ES_GetDeadlineMisses( uint8_t WhichService ){
+  if ( WhichService >= NUM_SERVICES ){
+    return 0;
+  }
+  return pVars->DeadlineMisses[WhichService];
+}
+
+/****************************************************************************
+ Function
+   ES_ResetDeadlineMisses
+ Parameters
+   None
+ Returns
+   nothing
+ Description
+   clears the deadline miss counts of all of the services
+ Notes
+
+ Author
+   Drew Bell, 10/17/26
+****************************************************************************/
+void ES_ResetDeadlineMisses( void ){
+  memset( pVars->DeadlineMisses, 0, sizeof(pVars->DeadlineMisses) );
+}
+
+#endif
+#ifdef ES_ENABLE_QUEUE_STATS
+/****************************************************************************
+ Function
+   ES_GetQueueStats
+ Parameters
+   uint8_t : Which service's queue to report on (index into ServDescList)
+   ES_QueueStats_t * : where to copy the stats to
+ Returns
+   bool : false if WhichService is not a valid service number
+ Description
+   takes a snapshot of the stats for one queue, along with its capacity and
+   current depth
+ Notes
+   the copy is made with interrupts off, since the post functions may be
+   called from interrupt responses
+ Author
+   Drew Bell, 10/17/26
+****************************************************************************/
+bool ES_GetQueueStats( uint8_t WhichService, ES_QueueStats_t * pStats ){
+  if ( WhichService >= NUM_SERVICES ){
+    return false;
+  }
+  EnterCritical();
+  *pStats = pVars->QueueStats[WhichService];
+  pStats->Depth = ES_RingQueueDepth( &pVars->EventQueues[WhichService] );
+  ExitCritical();
+  pStats->Capacity = pVars->EventQueues[WhichService].Size;
+  return true;
+}
+
+/****************************************************************************
+ Function
+   ES_ResetQueueStats
+ Parameters
+   None
+ Returns
+   nothing
+ Description
+   clears the counts for all queues and restarts the high-water marks from
+   the current depths
+ Notes
+
+ Author
+   Drew Bell, 10/17/26
+****************************************************************************/
+void ES_ResetQueueStats( void ){
+  uint16_t i;
+
+  EnterCritical();
+  memset( pVars->QueueStats, 0, sizeof(pVars->QueueStats) );
+  for ( i=0; i< NUM_SERVICES; i++) {
+    pVars->QueueStats[i].HighWater =
+        ES_RingQueueDepth( &pVars->EventQueues[i] );
+  }
+  ExitCritical();
+}
+
+/****************************************************************************
+ Function
+   ES_PrintQueueStats
+ Parameters
+   None
+ Returns
+   nothing
+ Description
+   prints a snapshot of the stats for every queue, with the failed posts
+   broken down by event type
+ Notes
+   printf is slow, call this from a service that can afford it
+ Author
+   Drew Bell, 10/17/26
+****************************************************************************/
+void ES_PrintQueueStats( void ){
+  ES_QueueStats_t Stats;
+  uint16_t i;
+  uint16_t Type;
+
+  printf("\n\rqueue  cap depth high posts failed\n\r");
+  for ( i=0; i< NUM_SERVICES; i++) {
+    ES_GetQueueStats( i, &Stats );
+    printf("%5u %4u %5u %4u %5lu %6lu\n\r", i, Stats.Capacity, Stats.Depth,
+           Stats.HighWater, (unsigned long)Stats.NumPosts,
+           (unsigned long)Stats.NumFailed);
+    for ( Type = 0; Type < ES_NUM_EVENT_TYPES; Type++ ){
+      if ( Stats.FailedByType[Type] != 0 ){
+        printf("      event type %u failed %u\n\r", Type,
+               Stats.FailedByType[Type]);
+      }
+    }
+  }
+}
+#endif
+
+//*********************************
+// private functions
+//*********************************
+/****************************************************************************
+ Function
+   SetReady
+ Parameters
+   uint8_t : Which service's queue has become non-empty
+ Returns
+   nothing
+ Description
+   marks the service as ready in both levels of the Ready set
+ Notes
+   safe to call from interrupt responses, the bits are set atomically
+ Author
+   Drew Bell, 10/17/26
+****************************************************************************/
+static void SetReady( uint8_t WhichService ){
+  uint8_t Group = WhichService / READY_GROUP_SIZE;
+
+  _HW_AtomicSetBits16( &pVars->Ready[Group],
+                       BitNum2SetMask[WhichService % READY_GROUP_SIZE] );
+  _HW_AtomicSetBits16( &pVars->ReadyGroups, BitNum2SetMask[Group] );
+}
+
+/****************************************************************************
+ Function
+   ClearReady
+ Parameters
+   uint8_t : Which service's queue has become empty
+ Returns
+   nothing
+ Description
+   marks the service as not ready, and its group as not ready if it was the
+   last ready service in the group
+ Notes
+   an interrupt response may mark another service in the group ready
+   between the test and the clear of the group bit, so the group is tested
+   again afterwards. The caller must likewise test its queues again after
+   this, in case an event arrived just before the service's bit was cleared.
+ Author
+   Drew Bell, 10/17/26
+****************************************************************************/
+static void ClearReady( uint8_t WhichService ){
+  uint8_t Group = WhichService / READY_GROUP_SIZE;
+
+  _HW_AtomicClearBits16( &pVars->Ready[Group],
+                         BitNum2SetMask[WhichService % READY_GROUP_SIZE] );
+  if ( _HW_AtomicLoad16( &pVars->Ready[Group] ) == 0 ){
+    _HW_AtomicClearBits16( &pVars->ReadyGroups, BitNum2SetMask[Group] );
+    if ( _HW_AtomicLoad16( &pVars->Ready[Group] ) != 0 ){
+      _HW_AtomicSetBits16( &pVars->ReadyGroups, BitNum2SetMask[Group] );
+    }
+  }
+}
+
+/****************************************************************************
+ Function
+   TakeEvents
+ Parameters
+   uint8_t : Which service to take events for (index into ServDescList)
+   ES_Event * : array to copy the events into
+   uint8_t : the most events to take (the size of the array)
+   uint8_t * : used to return the number of events taken
+ Returns
+   uint8_t : the number of events left for the service
+ Description
+   takes events from the service's queue and then from its ISR queue, and
+   marks the service as not ready once both are empty
+ Notes
+   the queues are tested again after the ready bit is cleared, so that an
+   event posted from an interrupt response in between is not left behind
+ Author
+   Drew Bell, 10/17/26
+****************************************************************************/
+static uint8_t TakeEvents( uint8_t WhichService, ES_Event * pDest,
+                           uint8_t MaxEvents, uint8_t * pNumTaken ){
+  ES_SPSCQueue_t * pISRQueue = pVars->ISRQueues[WhichService];
+  uint16_t NumTaken;
+  uint32_t NumLeft;
+
+  NumLeft = ES_RingDeQueueBlock( &pVars->EventQueues[WhichService], pDest,
+                                 MaxEvents, &NumTaken );
+  if ( pISRQueue != (ES_SPSCQueue_t *)0 ){
+    while ( (NumTaken < MaxEvents) &&
+            (ES_SPSCQueueDepth( pISRQueue ) != 0) ){
+      ES_SPSCDeQueue( pISRQueue, &pDest[NumTaken++] );
+    }
+    NumLeft += ES_SPSCQueueDepth( pISRQueue );
+  }
+  if ( NumLeft == 0 ){
+    ClearReady(WhichService); // mark queues as now empty
+    if ( (ES_IsRingQueueEmpty( &pVars->EventQueues[WhichService] ) != true) ||
+         ((pISRQueue != (ES_SPSCQueue_t *)0) &&
+          (ES_SPSCQueueDepth( pISRQueue ) != 0)) ){
+      SetReady(WhichService);
+      NumLeft = 1;
+    }
+  }
+  *pNumTaken = (uint8_t)NumTaken;
+  return (NumLeft > UINT8_MAX) ? UINT8_MAX : (uint8_t)NumLeft;
+}
+
+#if defined(ES_ENABLE_STATIC_DISPATCH) || defined(TEST)
+/****************************************************************************
+ Function
+   RunByNumber
+ Parameters
+   uint8_t : Which service to run (index into ServDescList)
+   ES_Event : the event to hand it
+ Returns
+   ES_Event : what the run function returned, ES_ERROR for a bad index
+ Description
+   calls the service's run function by name, from a switch built from
+   SERVICE_LIST, instead of through the pointer in ServDescList
+ Notes
+   the switch compiles to a jump table (TBB on the M4) of direct calls,
+   which leaves the compiler free to inline the run functions when it can
+   see them (armcc --multifile, or gcc -flto on the host)
+ Author
+   Drew Bell, 10/17/26
+****************************************************************************/
+static ES_Event RunByNumber( uint8_t WhichService, ES_Event ThisEvent ){
+  ES_Event ReturnEvent;
+
+#define ES_RUN_CASE( Init, Run, QueueSize, BurstLimit, RunBatch ) \
+  case Run##ServiceNum: return Run( ThisEvent );
+
+  switch ( WhichService ){
+    SERVICE_LIST(ES_RUN_CASE)
+    default:
+      break;
+  }
+  ReturnEvent.EventType = ES_ERROR;
+  ReturnEvent.EventParam = WhichService;
+  return ReturnEvent;
+}
+
+#endif
+
+#ifdef ES_ENABLE_BURST_DRAIN
+/****************************************************************************
+ Function
+   DispatchBurst
+ Parameters
+   uint8_t : Which service to dispatch to (index into ServDescList)
+ Returns
+   bool : false if the run function reported an error
+ Description
+   hands the service up to its burst limit of events, either one at a time
+   through its run function or all at once through its batch run function
+ Notes
+   higher priority services are only looked at again after the burst, so a
+   burst limit of 1 gives the same behavior as the normal dispatch
+ Author
+   Drew Bell, 10/17/26
+****************************************************************************/
+static bool DispatchBurst( uint8_t WhichService ){
+#if defined(ES_ENABLE_PREEMPTION) || defined(ES_ENABLE_NODES)
+  // a preempting burst, or another node's on another thread, needs its own
+  ES_Event Burst[ES_MAX_BURST];
+#else
+  static ES_Event Burst[ES_MAX_BURST];
+#endif
+  ES_ServDesc_t const *pService = &ServDescList[WhichService];
+  ES_Event ReturnEvent;
+  uint8_t NumEvents;
+  uint8_t NumLeft;
+  uint8_t NumTaken;
+
+  if ( pService->RunBatchFunc != NO_BATCH_FUNC ){
+    TakeEvents( WhichService, Burst, pService->BurstLimit, &NumEvents );
+    if ( NumEvents == 0 ){
+      return true;
+    }
+    {
+      uint8_t i;
+      for ( i = 0; i < NumEvents; i++ ){
+        NOTE_DISPATCH(Burst[i]);
+        NOTE_DEADLINE(WhichService, Burst[i]);
+        ES_PROFILE_DEQUEUED(WhichService, Burst[i]);
+        ES_TRACE_DISPATCH(WhichService, Burst[i]);
+      }
+    }
+    ES_PROFILE_RUN_BEGIN(WhichService);
+    ReturnEvent = pService->RunBatchFunc( Burst, NumEvents );
+    ES_PROFILE_RUN_END(WhichService);
+    {
+      uint8_t i;
+      for ( i = 0; i < NumEvents; i++ ){
+        ES_PAYLOAD_DROP(Burst[i]);
+      }
+    }
+    return ( ReturnEvent.EventType == ES_NO_EVENT );
+  }
+  // pull these one at a time so that anything the service posts to the
+  // front of its own queue (ES_RecallEvents) is still seen next
+  for ( NumEvents = 0; NumEvents < pService->BurstLimit; NumEvents++ ){
+    NumLeft = TakeEvents( WhichService, &Burst[0], 1, &NumTaken );
+    if ( NumTaken == 0 ){
+      break;
+    }
+    NOTE_DISPATCH(Burst[0]);
+    NOTE_DEADLINE(WhichService, Burst[0]);
+    ES_PROFILE_DEQUEUED(WhichService, Burst[0]);
+    ES_TRACE_DISPATCH(WhichService, Burst[0]);
+    ES_PROFILE_RUN_BEGIN(WhichService);
+    ReturnEvent = CALL_RUN_FUNC( WhichService, Burst[0] );
+    ES_PROFILE_RUN_END(WhichService);
+    ES_PAYLOAD_DROP(Burst[0]);
+    if ( ReturnEvent.EventType != ES_NO_EVENT ){
+      return false;
+    }
+    if ( NumLeft == 0 ){
+      break;
+    }
+  }
+  return true;
+}
+
+#else
+/****************************************************************************
+ Function
+   DispatchOne
+ Parameters
+   uint8_t : Which service to dispatch to (index into ServDescList)
+ Returns
+   bool : false if the run function reported an error
+ Description
+   takes the next event for the service and hands it to its run function
+ Notes
+   the event is kept on the stack, so that a preempting service's dispatch
+   does not overwrite it
+ Author
+   Drew Bell, 10/17/26
+****************************************************************************/
+static bool DispatchOne( uint8_t WhichService ){
+  ES_Event ThisEvent;
+  uint8_t NumTaken;
+
+  TakeEvents( WhichService, &ThisEvent, 1, &NumTaken );
+  if ( NumTaken == 0 ){
+    return true; // an ISR's ready bit for an event that we already took
+  }
+  return RunEvent( WhichService, ThisEvent );
+}
+
+/****************************************************************************
+ Function
+   RunEvent
+ Parameters
+   uint8_t : Which service to run (index into ServDescList)
+   ES_Event : the event that was taken for it
+ Returns
+   bool : false if the run function reported an error
+ Description
+   hands the event to the service's run function, with the timer, profiler
+   and payload bookkeeping around it
+ Notes
+   with ES_ENABLE_THREADS this is what the service's thread calls for each
+   event that it takes from the mailbox
+ Author
+   Drew Bell, 10/17/26
+****************************************************************************/
+static bool RunEvent( uint8_t WhichService, ES_Event ThisEvent ){
+  ES_Event ReturnEvent;
+
+  NOTE_DISPATCH(ThisEvent);
+  NOTE_DEADLINE(WhichService, ThisEvent);
+  ES_PROFILE_DEQUEUED(WhichService, ThisEvent);
+  ES_TRACE_DISPATCH(WhichService, ThisEvent);
+  ES_PROFILE_RUN_BEGIN(WhichService);
+  ReturnEvent = CALL_RUN_FUNC(WhichService, ThisEvent);
+  ES_PROFILE_RUN_END(WhichService);
+  ES_PAYLOAD_DROP(ThisEvent);
+  return ( ReturnEvent.EventType == ES_NO_EVENT );
+}
+
+#endif
+#ifdef ES_ENABLE_PREEMPTION
+/****************************************************************************
+ Function
+   Preempt
+ Parameters
+   None
+ Returns
+   nothing
+ Description
+   called after a post, asks the port to run ES_Activate if the highest
+   ready service is above the running level
+ Notes
+   the port pends PendSV, which is taken at once from a service with
+   interrupts on, or as the last interrupt unwinds when posting from an
+   interrupt response or with interrupts off
+ Author
+   Drew Bell, 10/17/26
+****************************************************************************/
+static void Preempt( void ){
+  if ( (SchedLockCount == 0) &&
+       (_HW_AtomicLoad16( &pVars->ReadyGroups ) != 0) &&
+       ((uint16_t)(GetHighestReady() + 1) > ActiveLevel) ){
+    _HW_PendScheduler();
+  }
+}
+
+#endif
+#ifdef ES_ENABLE_QUEUE_STATS
+/****************************************************************************
+ Function
+   RecordPost
+ Parameters
+   uint8_t : Which service's queue was posted to
+   ES_EventTyp_t : the type of the event that was posted
+   bool : true if the post succeeded, false if the queue was full
+ Returns
+   nothing
+ Description
+   counts the post and updates the high-water mark, or counts the failure
+   against the event type
+ Notes
+   interrupts are off while the counts are updated, since posts come from
+   interrupt responses as well as from the services
+ Author
+   Drew Bell, 10/17/26
+****************************************************************************/
+static void RecordPost( uint8_t WhichService, ES_EventTyp_t EventType,
+                        bool Posted ){
+  ES_QueueStats_t *pStats = &pVars->QueueStats[WhichService];
+  uint16_t Depth;
+
+  EnterCritical();
+  if ( Posted ){
+    pStats->NumPosts++;
+    Depth = ES_RingQueueDepth( &pVars->EventQueues[WhichService] );
+    if ( Depth > pStats->HighWater ){
+      pStats->HighWater = Depth;
+    }
+  }else{
+    pStats->NumFailed++;
+    if ( (uint16_t)EventType < ES_NUM_EVENT_TYPES ){
+      pStats->FailedByType[EventType]++;
+    }
+  }
+  ExitCritical();
+}
+
+#endif
+#ifdef ES_ENABLE_THREADS
+/****************************************************************************
+ Function
+   ThreadPost
+ Parameters
+   uint8_t : Which service to post to (index into ServDescList)
+   ES_Event : The Event to be posted
+   bool : true to post to the front, for ES_PostToServiceLIFO
+ Returns
+   boolean : False if the mailbox was full (or, for the front, the caller
+             is not the service's thread)
+ Description
+   posts to the service's mailbox, counting the payload reference
+ Notes
+   the service's thread may take the event as soon as it is in the
+   mailbox, so the payload reference has to be there first
+ Author
+   Drew Bell, 10/17/26
+****************************************************************************/
+static bool ThreadPost( uint8_t WhichService, ES_Event TheEvent,
+                        bool ToFront ){
+  bool Posted;
+
+  ES_PAYLOAD_HOLD(TheEvent);
+  if ( ToFront ){
+    Posted = ES_ThreadPostFront( WhichService, TheEvent );
+  }else{
+    Posted = ES_ThreadPost( WhichService, TheEvent );
+  }
+  if ( Posted != true ){
+    ES_PAYLOAD_DROP(TheEvent);
+  }
+  ES_TRACE_POST(WhichService, TheEvent, Posted);
+  return Posted;
+}
+
+#endif
+/****************************************************************************
+ Function
+   PostStamped
+ Parameters
+   uint8_t : Which service to post to (index into ServDescList)
+   ES_Event : The Event to be posted, with its deadline already set
+ Returns
+   boolean : False if the queue was full or WhichService is out of range
+ Description
+   the FIFO post behind ES_PostToService and ES_PostToServiceDeadline
+ Notes
+
+ Author
+   Drew Bell, 10/17/26
+****************************************************************************/
+static bool PostStamped( uint8_t WhichService, ES_Event TheEvent ){
+#ifndef ES_ENABLE_THREADS
+  bool Posted;
+#endif
+
+  ES_PROFILE_STAMP(TheEvent);
+  if ( WhichService >= NUM_SERVICES ){
+    return false;
+  }
+#ifdef ES_ENABLE_THREADS
+  return ThreadPost( WhichService, TheEvent, false );
+#else
+  // the service may take the event as soon as it is in the queue (from
+  // PendSV with ES_ENABLE_PREEMPTION), so the payload reference has to be
+  // there first
+  ES_PAYLOAD_HOLD(TheEvent);
+  Posted = ES_RingEnQueueFIFO( &pVars->EventQueues[WhichService], TheEvent);
+  if ( Posted ){
+    SetReady(WhichService); // show queue as non-empty
+  }else{
+    ES_PAYLOAD_DROP(TheEvent);
+  }
+  RECORD_POST(WhichService, TheEvent, Posted);
+  ES_TRACE_POST(WhichService, TheEvent, Posted);
+  if ( Posted ){
+    PREEMPT();
+  }
+  return Posted;
+#endif
+}
+
+/****************************************************************************
+ Function
+   GetHighestReady
+ Parameters
+   None
+ Returns
+   uint8_t : the index of the highest priority service with a non-empty queue
+ Description
+   finds the highest ready group, then the highest ready service in it
+ Notes
+   only meaningful when ReadyGroups != 0
+ Author
+   Drew Bell, 10/17/26
+****************************************************************************/
+static uint8_t GetHighestReady( void ){
+  uint8_t Group = ES_GetMSBitSet( _HW_AtomicLoad16( &pVars->ReadyGroups ) );
+
+  return (uint8_t)(Group * READY_GROUP_SIZE +
+                   ES_GetMSBitSet( _HW_AtomicLoad16( &pVars->Ready[Group] ) ));
+}
+
+#ifdef ES_ENABLE_EDF
+/****************************************************************************
+ Function
+   GetEarliestDeadline
+ Parameters
+   None
+ Returns
+   uint8_t : the index of the ready service whose next event is due first
+ Description
+   looks at the head event of every ready service, highest priority first,
+   so that a tie goes to the higher priority service
+ Notes
+   only meaningful when ReadyGroups != 0. A service can be marked ready
+   with nothing left to take (see TakeEvents), if none of them have an event
+   we fall back on the highest priority one so that its bit is cleared.
+ Author
+   Drew Bell, 10/17/26
+****************************************************************************/
+static uint8_t GetEarliestDeadline( void ){
+  uint16_t Mask;
+  uint16_t Deadline;
+  uint16_t Earliest = 0;
+  uint8_t Group;
+  uint8_t Bit;
+  uint8_t WhichService;
+  uint8_t Chosen = 0;
+  bool Found = false;
+
+  for ( Group = NUM_READY_GROUPS; Group > 0; Group-- ){
+    Mask = _HW_AtomicLoad16( &pVars->Ready[Group - 1] );
+    while ( Mask != 0 ){
+      Bit = ES_GetMSBitSet( Mask );
+      Mask &= (uint16_t)~(1u << Bit);
+      WhichService = (uint8_t)((Group - 1) * READY_GROUP_SIZE + Bit);
+      if ( GetHeadDeadline( WhichService, &Deadline ) &&
+           ((Found != true) || ((int16_t)(Deadline - Earliest) < 0)) ){
+        Earliest = Deadline;
+        Chosen = WhichService;
+        Found = true;
+      }
+    }
+  }
+  return Found ? Chosen : GetHighestReady();
+}
+
+/****************************************************************************
+ Function
+   GetHeadDeadline
+ Parameters
+   uint8_t : Which service to look at (index into ServDescList)
+   uint16_t * : used to return the deadline
+ Returns
+   bool : false if the service has no events waiting
+ Description
+   finds the earlier of the deadlines of the events at the heads of the
+   service's queue and its ISR queue
+ Notes
+
+ Author
+   Drew Bell, 10/17/26
+****************************************************************************/
+static bool GetHeadDeadline( uint8_t WhichService, uint16_t * pDeadline ){
+  ES_Event Head;
+  bool Found = false;
+
+  if ( ES_RingQueuePeek( &pVars->EventQueues[WhichService], &Head ) ){
+    *pDeadline = Head.Deadline;
+    Found = true;
+  }
+  if ( (pVars->ISRQueues[WhichService] != (ES_SPSCQueue_t *)0) &&
+       ES_SPSCQueuePeek( pVars->ISRQueues[WhichService], &Head ) &&
+       ((Found != true) || ((int16_t)(Head.Deadline - *pDeadline) < 0)) ){
+    *pDeadline = Head.Deadline;
+    Found = true;
+  }
+  return Found;
+}
+#endif
+
+#ifdef TEST
+/* dispatch benchmark. With TEST defined at the top of this file, on the
+   host:
+   gcc -std=gnu99 -O2 -DES_PORT_POSIX -IHeaders Source/ES_Framework.c
+       Source/ES_Port_POSIX.c Source/ES_Queue.c Source/ES_Timers.c
+       Source/ES_LookupTables.c Source/ES_PostList.c Source/ES_CheckEvents.c
+       Source/ES_DeferRecall.c Source/ES_Profile.c Source/ES_Payload.c
+       Source/ES_Pool.c Source/ES_Coalesce.c Source/ES_Trace.c
+       Source/ES_Log.c Source/ES_Threads_POSIX.c Source/EventCheckers.c
+       Source/MapKeys.c Source/RxSM.c -lpthread -o dispatch_test
+   It hands ES_NO_EVENT, which the services ignore, to each service in
+   turn, first through the ServDescList pointers and then through
+   RunByNumber, and prints the time per dispatch in ES_CYCLE_COUNT_UNITS.
+   On the target the same code times in core clocks off the DWT counter.
+*/
+#define TEST_DISPATCHES 10000000UL
+
+// the index is read back each time so that neither loop can be folded
+static volatile uint8_t TestService;
+
+int main(void)
+{
+   ES_Event ThisEvent;
+   uint32_t Start;
+   uint32_t PointerTime;
+   uint32_t SwitchTime;
+   uint32_t i;
+   uint8_t WhichService;
+
+   ThisEvent.EventType = ES_NO_EVENT;
+   ThisEvent.EventParam = 0;
+   _HW_CycleCounterInit();
+
+   Start = _HW_GetCycleCount();
+   for (i = 0; i < TEST_DISPATCHES; i++)
+   {
+      WhichService = TestService;
+      ServDescList[WhichService].RunFunc(ThisEvent);
+      TestService = (WhichService + 1) % NUM_SERVICES;
+   }
+   PointerTime = _HW_GetCycleCount() - Start;
+
+   Start = _HW_GetCycleCount();
+   for (i = 0; i < TEST_DISPATCHES; i++)
+   {
+      WhichService = TestService;
+      RunByNumber(WhichService, ThisEvent);
+      TestService = (WhichService + 1) % NUM_SERVICES;
+   }
+   SwitchTime = _HW_GetCycleCount() - Start;
+
+   printf("%u services, %s per dispatch: pointer %.2f, switch %.2f\n\r",
+          (unsigned)NUM_SERVICES, ES_CYCLE_COUNT_UNITS,
+          (double)PointerTime / TEST_DISPATCHES,
+          (double)SwitchTime / TEST_DISPATCHES);
+   return 0;
+}
+#endif
+
 #if 0
 /****************************************************************************
  Function
@@ -0,0 +1,171 @@
+/****************************************************************************
+ Module
+     ES_Log.c
+
+ Description
+     This module keeps the deferred log: the log statements put messages in
+     a ring and ES_Run sends them over the console when it has nothing else
+     to do.
+
+ Notes
+     A message is a word with its number (bits 0-7) and number of arguments
+     (bits 8-15), followed by a word per argument. The ring is shared with
+     the interrupt responses, so it is only touched in a critical region,
+     for just as long as it takes to copy a message in or out. Sending it
+     is done outside, so a log statement never waits for the UART.
+
+     When the ring is full the message is lost, and the count of lost
+     messages is put in ahead of the next one that fits (or sent once the
+     ring is empty), as an ES_LOG_LOST_MESSAGES message.
+
+     The whole module compiles to nothing with ES_LOG_LEVEL_NONE
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/17/26 21:30 afb      Began Coding
+****************************************************************************/
+
+/*----------------------------- Include Files -----------------------------*/
+#include "ES_Configure.h"
+#include "ES_Log.h"
+
+#if ES_LOG_LEVEL > ES_LOG_LEVEL_NONE
+
+#include <stdio.h>
+#include "ES_Port.h"
+
+/*--------------------------- External Variables --------------------------*/
+
+/*----------------------------- Module Defines ----------------------------*/
+#if ( ES_LOG_SIZE & ( ES_LOG_SIZE - 1 ) ) != 0
+#error ES_LOG_SIZE must be a power of 2
+#endif
+
+#define MESSAGE_WORD( Message, NumArgs ) \
+            ( (uint32_t)(uint8_t)(Message) | ( (uint32_t)(NumArgs) << 8 ) )
+#define MESSAGE_OF( Word )   ( (uint8_t)(Word) )
+#define NUM_ARGS_OF( Word )  ( (uint8_t)( (Word) >> 8 ) )
+
+/*------------------------------ Module Types -----------------------------*/
+
+/*---------------------------- Module Functions ---------------------------*/
+static void Put( uint32_t Word );
+static void SendFrame( uint32_t const * pWords );
+
+/*---------------------------- Module Variables ---------------------------*/
+static uint32_t Ring[ES_LOG_SIZE];
+static uint32_t Head;     // words put in since the start
+static uint32_t Tail;     // words taken out since the start
+static uint32_t NumLost;  // messages lost since the last lost count went in
+
+/*------------------------------ Module Code ------------------------------*/
+/****************************************************************************
+ Function
+     ES_LogWrite
+ Parameters
+     uint32_t const * pWords, the message number and then its arguments
+     uint8_t NumWords, how many of them
+ Returns
+     nothing
+ Description
+     puts a message in the ring to be sent later, or counts it as lost if
+     there is no room for it
+ Notes
+     use the ES_LOG_ macros (ES_Log.h) rather than calling this directly.
+     Arguments past ES_LOG_MAX_ARGS are left out.
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+void ES_LogWrite( uint32_t const * pWords, uint8_t NumWords ){
+  uint32_t Needed;
+  uint8_t i;
+
+  if ( NumWords > 1 + ES_LOG_MAX_ARGS ){
+    NumWords = 1 + ES_LOG_MAX_ARGS;
+  }
+  EnterCritical();
+  Needed = NumWords + ( ( NumLost != 0 ) ? 2 : 0 );
+  if ( ES_LOG_SIZE - ( Head - Tail ) < Needed ){
+    NumLost++;
+  }else{
+    if ( NumLost != 0 ){
+      Put( MESSAGE_WORD( ES_LOG_LOST_MESSAGES, 1 ) );
+      Put( NumLost );
+      NumLost = 0;
+    }
+    Put( MESSAGE_WORD( pWords[0], NumWords - 1 ) );
+    for ( i = 1; i < NumWords; i++ ){
+      Put( pWords[i] );
+    }
+  }
+  ExitCritical();
+}
+
+/****************************************************************************
+ Function
+     ES_LogDrain
+ Parameters
+     none
+ Returns
+     bool, true if a message was sent, false if there was nothing to send
+ Description
+     sends the oldest message in the ring over the console
+ Notes
+     called from ES_Run when the queues are empty and no event checker found
+     anything, one message at a time so that the checkers still run between
+     them. Blocks for as long as the console takes the frame.
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+bool ES_LogDrain( void ){
+  uint32_t Words[1 + ES_LOG_MAX_ARGS];
+  uint8_t i;
+
+  EnterCritical();
+  if ( Tail != Head ){
+    Words[0] = Ring[Tail++ & ( ES_LOG_SIZE - 1 )];
+    for ( i = 0; i < NUM_ARGS_OF( Words[0] ); i++ ){
+      Words[1 + i] = Ring[Tail++ & ( ES_LOG_SIZE - 1 )];
+    }
+  }else if ( NumLost != 0 ){
+    Words[0] = MESSAGE_WORD( ES_LOG_LOST_MESSAGES, 1 );
+    Words[1] = NumLost;
+    NumLost = 0;
+  }else{
+    ExitCritical();
+    return false;
+  }
+  ExitCritical();
+  SendFrame( Words );
+  return true;
+}
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+
+// adds a word at the head of the ring, in a critical region, with room
+static void Put( uint32_t Word ){
+  Ring[Head++ & ( ES_LOG_SIZE - 1 )] = Word;
+}
+
+// the frame laid out in ES_Log.h
+static void SendFrame( uint32_t const * pWords ){
+  uint8_t i;
+  uint32_t Arg;
+
+  putchar( ES_LOG_FRAME_START );
+  putchar( MESSAGE_OF( pWords[0] ) );
+  putchar( NUM_ARGS_OF( pWords[0] ) );
+  for ( i = 0; i < NUM_ARGS_OF( pWords[0] ); i++ ){
+    Arg = pWords[1 + i];
+    while ( Arg >= 0x80 ){
+      putchar( (int)( ( Arg & 0x7F ) | 0x80 ) );
+      Arg >>= 7;
+    }
+    putchar( (int)Arg );
+  }
+}
+
+#endif /* ES_LOG_LEVEL > ES_LOG_LEVEL_NONE */
@@ -18,6 +18,12 @@
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/17/26 21:45 afb      the timing loops feed each result into the next
+                         input rather than adding it to a volatile, whose
+                         read-modify-write hid the difference
+ 10/17/26 10:05 afb      renamed the table walk to ES_GetMSBitSetByTable, the
+                         CLZ version of ES_GetMSBitSet is inline in the header.
+                         added a cycles/call comparison of the two to the test
  10/20/13 17:03 jec      converted Byte2MSBitNum array to a Nybble sized array
                          (15 entries) and made function GetMSBitSet() to figure 
                          out the MSB set. This was done to facilitate moving to
@@ -33,7 +39,8 @@
 #include "ES_Types.h"
 #include "ES_General.h"
 #include "ES_Timers.h"
-#include "bitdefs.h"
+#include "ES_LookupTables.h"
+#include "BITDEFS.H"
 
 /*----------------------------- Module Defines ----------------------------*/
 #define ISOLATE_LS_NYBBLE 0x0F
@@ -76,7 +83,7 @@ uint8_t const Nybble2MSBitNum[15] = {
 };
 
 /*------------------------------ Module Code ------------------------------*/
-uint8_t ES_GetMSBitSet( uint16_t Val2Check) {
+uint8_t ES_GetMSBitSetByTable( uint16_t Val2Check) {
 
   int8_t LoopCntr;
   uint8_t Nybble2Test; 
@@ -105,10 +112,42 @@ uint8_t ES_GetMSBitSet( uint16_t Val2Check) {
 #ifdef TEST
 #include <stdio.h>
 
+#define BENCH_PASSES 16
+
+#ifdef ES_PORT_POSIX
+#include <time.h>
+#define TIME_UNITS "ns"
+// on the host there is no cycle counter we can rely on, so use nanoseconds
+static uint32_t ReadTimeStamp(void) {
+  struct timespec Now;
+  clock_gettime(CLOCK_MONOTONIC, &Now);
+  return (uint32_t)(Now.tv_sec * 1000000000UL + Now.tv_nsec);
+}
+#else
+#include "inc/hw_types.h"
+#define TIME_UNITS "cycles"
+#define DEMCR             0xE000EDFC
+#define DEMCR_TRCENA      0x01000000
+#define DWT_CTRL          0xE0001000
+#define DWT_CTRL_CYCCNTENA 0x00000001
+#define DWT_CYCCNT        0xE0001004
+// the DWT cycle counter counts core clocks
+static uint32_t ReadTimeStamp(void) {
+  return HWREG(DWT_CYCCNT);
+}
+#endif
+
+// where the last result of each timing loop is kept, once the loop is done
+static volatile uint8_t Sink;
+
 void main(void) {
 
   uint16_t Counter=0;
   uint8_t MSBit;
+  uint32_t Start, TableTime, ClzTime;
+  uint8_t Pass;
+  uint8_t Chain; // each result goes into the next input, so the calls
+                 // can not be overlapped or dropped
 
   puts("Testing the MSB Look-up function\n\r");
   puts(__TIME__ " " __DATE__);
@@ -118,8 +157,51 @@ void main(void) {
 
   for (Counter = 1; Counter !=0; Counter++){
     MSBit = ES_GetMSBitSet( Counter);
-    printf("the MSB set in %u is bit %d\n\r",Counter,MSBit);
+    if ( MSBit != ES_GetMSBitSetByTable( Counter)){
+      printf("mismatch at %u: %d vs %d\n\r", Counter, MSBit,
+              ES_GetMSBitSetByTable( Counter));
+    }
   }
+
+#ifndef ES_PORT_POSIX
+  HWREG(DEMCR) |= DEMCR_TRCENA;
+  HWREG(DWT_CTRL) |= DWT_CTRL_CYCCNTENA;
+#endif
+  // time both versions over every non-zero 16 bit value (or'ed with the
+  // last result, which leaves it non-zero)
+  Chain = 0;
+  Start = ReadTimeStamp();
+  for (Pass = 0; Pass < BENCH_PASSES; Pass++){
+    for (Counter = 1; Counter !=0; Counter++){
+      Chain = ES_GetMSBitSetByTable( Counter | Chain);
+    }
+  }
+  TableTime = ReadTimeStamp() - Start;
+  Sink = Chain;
+
+  Chain = 0;
+  Start = ReadTimeStamp();
+  for (Pass = 0; Pass < BENCH_PASSES; Pass++){
+    for (Counter = 1; Counter !=0; Counter++){
+      Chain = ES_GetMSBitSet( Counter | Chain);
+    }
+  }
+  ClzTime = ReadTimeStamp() - Start;
+  Sink = Chain;
+
+#ifdef ES_HAVE_CLZ
+  puts("ES_GetMSBitSet is using count leading zeros\n\r");
+#else
+  puts("ES_GetMSBitSet is using the table walk\n\r");
+#endif
+  printf("table walk : %lu.%02lu " TIME_UNITS "/call\n\r",
+         (unsigned long)TableTime / (BENCH_PASSES * 0xFFFFUL),
+         ((unsigned long)TableTime % (BENCH_PASSES * 0xFFFFUL)) * 100 /
+                                                  (BENCH_PASSES * 0xFFFFUL));
+  printf("MSB set    : %lu.%02lu " TIME_UNITS "/call\n\r",
+         (unsigned long)ClzTime / (BENCH_PASSES * 0xFFFFUL),
+         ((unsigned long)ClzTime % (BENCH_PASSES * 0xFFFFUL)) * 100 /
+                                                  (BENCH_PASSES * 0xFFFFUL));
 }
 #endif
 /*------------------------------ End of File ------------------------------*/
@@ -0,0 +1,597 @@
+//#define TEST
+/****************************************************************************
+ Module
+   ES_Nodes_POSIX.c
+
+ Description
+   Runs many copies (nodes) of the Events & Services framework, with all of
+   their services, in one host process. Each node is a block of memory that
+   holds every module's variables (see ES_Context.h), and a thread runs a
+   node by pointing ES_pContext at its block.
+
+ Notes
+   ES_NodesInit lays the block out from the sizes that the modules export
+   through ES_CONTEXT_VARS, each slice on a CONTEXT_ALIGN boundary.
+
+   ES_NodesRun steps every node once per round on a pool of threads. At the
+   start of a round each thread pushes its share of the nodes onto its own
+   deque and then runs them from the bottom, newest first, while a thread
+   that has run out takes the oldest from the top of someone else's. This
+   is the Chase-Lev deque: only a steal, or a pop that races a steal for
+   the last node, needs a compare-and-swap, so a thread that keeps busy
+   with its own share costs the others nothing. Nodes that get more to do
+   than others (more packets, more timeouts) then even out across the
+   threads without any central queue. The round ends when every node has
+   been stepped, and the barriers between rounds are what hand a node's
+   memory from the thread that ran it last to the next one.
+
+   This file is only part of a host build with ES_ENABLE_NODES.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/17/26 20:00 afb     started coding
+****************************************************************************/
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+
+#include "ES_Configure.h"
+#include "ES_Framework.h"
+#include "ES_Context.h"
+#include "ES_Nodes.h"
+
+#ifdef ES_ENABLE_NODES
+
+/*----------------------------- Module Defines ----------------------------*/
+// every module's slice of a context starts on a cache line of its own
+#define CONTEXT_ALIGN 64
+
+// what Pop and Steal hand back when they have no node for the caller
+#define NO_NODE    0xFFFFFFFFu
+#define STEAL_LOST 0xFFFFFFFEu
+
+// the rate that a node's timers are set up at, ES_NodeStep's ticks are 1mS
+#define NODE_TIMER_RATE ES_Timer_RATE_1mS
+
+/*------------------------------ Module Types -----------------------------*/
+typedef struct {
+    _Atomic int64_t Top;      // the oldest node, where thieves take from
+    _Atomic int64_t Bottom;   // one past the newest, the owner's end
+    _Atomic uint32_t * pNodeNums;
+    uint32_t Mask;            // number of entries - 1, a power of two
+}Deque_t;
+
+typedef struct {
+    pthread_t Thread;
+    Deque_t Deque;
+    uint16_t Number;
+    uint32_t Seed;            // for picking whom to steal from
+}PoolWorker_t;
+
+/*---------------------------- Module Functions ---------------------------*/
+static void * PoolLoop( void * pArg );
+static void RunNode( uint32_t NodeNum, uint32_t Round );
+static void Push( Deque_t * pDeque, uint32_t NodeNum );
+static uint32_t Pop( Deque_t * pDeque );
+static uint32_t Steal( Deque_t * pDeque );
+static uint32_t StealAny( PoolWorker_t * pWorker );
+static uint32_t RoundUpPow2( uint32_t Size );
+
+/*---------------------------- Module Variables ---------------------------*/
+// the node that this thread is running, and where each module's variables
+// start in a node's context
+__thread uint8_t * ES_pContext;
+size_t ES_ContextOffsets[ES_NUM_CONTEXT_VARS];
+
+#define ES_CONTEXT_SIZE_DECL( Name ) extern size_t const Name##ContextSize;
+CONTEXT_LIST(ES_CONTEXT_SIZE_DECL)
+
+#define ES_CONTEXT_SIZE_ADDR( Name ) &Name##ContextSize,
+static size_t const * const ContextSizes[ES_NUM_CONTEXT_VARS] = {
+  CONTEXT_LIST(ES_CONTEXT_SIZE_ADDR)
+};
+
+// the size of a whole context, 0 until ES_NodesInit
+static size_t ContextSize;
+
+// the run in progress in ES_NodesRun, set before the pool starts
+static PoolWorker_t * PoolWorkers;
+static uint16_t NumPoolWorkers;
+static ES_Node_t * pRunNodes;
+static uint32_t NumRunNodes;
+static uint32_t NumRunRounds;
+static uint32_t RunTicks;
+static ES_NodeHook_t * pRunHook;
+static pthread_barrier_t RoundBarrier;
+// the nodes still to be stepped this round
+static atomic_uint Remaining;
+
+/*------------------------------ Module Code ------------------------------*/
+/****************************************************************************
+ Function
+     ES_NodesInit
+ Parameters
+     None
+ Returns
+     bool, true
+ Description
+     lays out a node's context, one slice per module in CONTEXT_LIST
+ Notes
+     call once, before any ES_NodeCreate
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+bool ES_NodesInit( void ){
+  uint16_t i;
+  size_t Offset = 0;
+
+  for ( i = 0; i < ES_NUM_CONTEXT_VARS; i++ ){
+    ES_ContextOffsets[i] = Offset;
+    Offset += (*ContextSizes[i] + CONTEXT_ALIGN - 1) &
+              ~(size_t)(CONTEXT_ALIGN - 1);
+  }
+  ContextSize = Offset;
+  return true;
+}
+
+/****************************************************************************
+ Function
+     ES_NodeCreate
+ Parameters
+     ES_Node_t * pNode, the node to set up
+ Returns
+     bool, false if there was no memory for it or ES_Initialize failed
+ Description
+     gets a zeroed context for the node and runs ES_Initialize inside it,
+     which runs the service inits
+ Notes
+     call from one thread at a time. The events posted by the inits (like
+     ES_INIT) are handled by the node's first step.
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+bool ES_NodeCreate( ES_Node_t * pNode ){
+  void * pContext;
+
+  pNode->pContext = NULL;
+  pNode->Status = FailedInit;
+  pNode->NumSteps = 0;
+  if ( (ContextSize == 0) ||
+       (posix_memalign( &pContext, CONTEXT_ALIGN, ContextSize ) != 0) ){
+    return false;
+  }
+  memset( pContext, 0, ContextSize );
+  pNode->pContext = pContext;
+
+  ES_NodeEnter( pNode );
+  pNode->Status = ES_Initialize( NODE_TIMER_RATE );
+  ES_NodeLeave();
+  if ( pNode->Status != Success ){
+    ES_NodeDestroy( pNode );
+    return false;
+  }
+  return true;
+}
+
+/****************************************************************************
+ Function
+     ES_NodeDestroy
+ Parameters
+     ES_Node_t * pNode, the node to be done with
+ Returns
+     None
+ Description
+     frees the node's context
+ Notes
+     the node must not be running
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+void ES_NodeDestroy( ES_Node_t * pNode ){
+  free( pNode->pContext );
+  pNode->pContext = NULL;
+}
+
+/****************************************************************************
+ Function
+     ES_NodeEnter / ES_NodeLeave
+ Parameters
+     ES_Node_t * pNode, the node that the calling thread is to run
+ Returns
+     None
+ Description
+     points the calling thread at the node's context, so that the framework
+     functions (posts, timers, payloads ...) act on that node, and back off
+     it again
+ Notes
+     no node may be run by two threads at once
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+void ES_NodeEnter( ES_Node_t * pNode ){
+  ES_pContext = pNode->pContext;
+}
+
+void ES_NodeLeave( void ){
+  ES_pContext = NULL;
+}
+
+/****************************************************************************
+ Function
+     ES_NodeStep
+ Parameters
+     ES_Node_t * pNode, the node to step
+     uint32_t NumTicks, how many ticks have passed for it since its last step
+ Returns
+     ES_Return_t, the node's status: FailedRun once a run function has
+     failed, after which it is not stepped again
+ Description
+     credits the node with the ticks, which its timers see as they are
+     handed on, and runs its services until all of its queues are empty
+ Notes
+
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+ES_Return_t ES_NodeStep( ES_Node_t * pNode, uint32_t NumTicks ){
+  if ( pNode->Status == Success ){
+    ES_NodeEnter( pNode );
+    _HW_AddTicks( NumTicks );
+    pNode->Status = ES_RunToIdle();
+    pNode->NumSteps++;
+    ES_NodeLeave();
+  }
+  return pNode->Status;
+}
+
+/****************************************************************************
+ Function
+     ES_NodesRun
+ Parameters
+     ES_Node_t * pNodes, the nodes, made by ES_NodeCreate
+     uint32_t NumNodes, how many there are
+     uint16_t NumThreads, the size of the pool, at least 1
+     uint32_t NumRounds, how many times to step every node
+     uint32_t TicksPerRound, the ticks that each step credits
+     ES_NodeHook_t * pHook, called inside each node before its step, or NULL
+ Returns
+     bool, false if the pool could not be started or a node failed
+ Description
+     steps every node NumRounds times on NumThreads threads, every node
+     finishing a round before any node starts the next
+ Notes
+     returns once every round is done. A node that fails is left alone
+     from then on, see its Status.
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+bool ES_NodesRun( ES_Node_t * pNodes, uint32_t NumNodes, uint16_t NumThreads,
+                  uint32_t NumRounds, uint32_t TicksPerRound,
+                  ES_NodeHook_t * pHook ){
+  uint16_t i;
+  uint16_t NumStarted;
+  uint32_t Size;
+  bool ReturnVal = true;
+
+  if ( NumThreads == 0 ){
+    NumThreads = 1;
+  }
+  PoolWorkers = calloc( NumThreads, sizeof(PoolWorker_t) );
+  if ( PoolWorkers == NULL ){
+    return false;
+  }
+  // a worker's deque only ever holds its own share of a round
+  Size = RoundUpPow2( (NumNodes + NumThreads - 1) / NumThreads );
+  for ( i = 0; i < NumThreads; i++ ){
+    PoolWorkers[i].Deque.pNodeNums = calloc( Size, sizeof(_Atomic uint32_t) );
+    if ( PoolWorkers[i].Deque.pNodeNums == NULL ){
+      ReturnVal = false;
+    }
+    PoolWorkers[i].Deque.Mask = Size - 1;
+    atomic_init( &PoolWorkers[i].Deque.Top, 0 );
+    atomic_init( &PoolWorkers[i].Deque.Bottom, 0 );
+    PoolWorkers[i].Number = i;
+    PoolWorkers[i].Seed = i * 2654435761u + 1;
+  }
+  NumPoolWorkers = NumThreads;
+  pRunNodes = pNodes;
+  NumRunNodes = NumNodes;
+  NumRunRounds = NumRounds;
+  RunTicks = TicksPerRound;
+  pRunHook = pHook;
+
+  NumStarted = 0;
+  if ( ReturnVal == true ){
+    pthread_barrier_init( &RoundBarrier, NULL, NumThreads );
+    for ( NumStarted = 0; NumStarted < NumThreads; NumStarted++ ){
+      if ( pthread_create( &PoolWorkers[NumStarted].Thread, NULL, PoolLoop,
+                           &PoolWorkers[NumStarted] ) != 0 ){
+        break;
+      }
+    }
+    if ( NumStarted != NumThreads ){
+      // the ones that did start wait at the first barrier for ever
+      fprintf( stderr, "ES_NodesRun: could not start the pool\n" );
+      exit( EXIT_FAILURE );
+    }
+    for ( i = 0; i < NumStarted; i++ ){
+      pthread_join( PoolWorkers[i].Thread, NULL );
+    }
+    pthread_barrier_destroy( &RoundBarrier );
+  }
+
+  for ( i = 0; i < NumThreads; i++ ){
+    free( PoolWorkers[i].Deque.pNodeNums );
+  }
+  free( PoolWorkers );
+  PoolWorkers = NULL;
+  if ( ReturnVal == true ){
+    for ( Size = 0; Size < NumNodes; Size++ ){
+      if ( pNodes[Size].Status != Success ){
+        ReturnVal = false;
+      }
+    }
+  }
+  return ReturnVal;
+}
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+
+// the pool threads: share out, run and steal, round after round
+static void * PoolLoop( void * pArg ){
+  PoolWorker_t * pWorker = pArg;
+  uint32_t Round;
+  uint32_t NodeNum;
+
+  for ( Round = 0; Round < NumRunRounds; Round++ ){
+    // everyone is done with the last round
+    pthread_barrier_wait( &RoundBarrier );
+    if ( pWorker->Number == 0 ){
+      atomic_store( &Remaining, NumRunNodes );
+    }
+    for ( NodeNum = pWorker->Number; NodeNum < NumRunNodes;
+          NodeNum += NumPoolWorkers ){
+      Push( &pWorker->Deque, NodeNum );
+    }
+    // every share is out and Remaining is set
+    pthread_barrier_wait( &RoundBarrier );
+
+    while ( atomic_load( &Remaining ) != 0 ){
+      NodeNum = Pop( &pWorker->Deque );
+      if ( NodeNum == NO_NODE ){
+        NodeNum = StealAny( pWorker );
+      }
+      if ( NodeNum < NumRunNodes ){
+        RunNode( NodeNum, Round );
+        atomic_fetch_sub( &Remaining, 1 );
+      }else{
+        // the last few nodes are running elsewhere
+        sched_yield();
+      }
+    }
+  }
+  return NULL;
+}
+
+// one step of one node, with its hook
+static void RunNode( uint32_t NodeNum, uint32_t Round ){
+  ES_Node_t * pNode = &pRunNodes[NodeNum];
+
+  if ( pNode->Status != Success ){
+    return;
+  }
+  if ( pRunHook != NULL ){
+    ES_NodeEnter( pNode );
+    pRunHook( pNode, NodeNum, Round );
+    ES_NodeLeave();
+  }
+  ES_NodeStep( pNode, RunTicks );
+}
+
+// the owner's end of a deque: push and pop at the bottom
+static void Push( Deque_t * pDeque, uint32_t NodeNum ){
+  int64_t Bottom = atomic_load_explicit( &pDeque->Bottom,
+                                         memory_order_relaxed );
+
+  atomic_store_explicit( &pDeque->pNodeNums[Bottom & pDeque->Mask], NodeNum,
+                         memory_order_relaxed );
+  // a thief that sees the new Bottom sees the entry
+  atomic_store_explicit( &pDeque->Bottom, Bottom + 1, memory_order_release );
+}
+
+static uint32_t Pop( Deque_t * pDeque ){
+  int64_t Bottom = atomic_load_explicit( &pDeque->Bottom,
+                                         memory_order_relaxed ) - 1;
+  int64_t Top;
+  uint32_t NodeNum;
+
+  // claim the bottom entry before looking at Top, so that a thief that
+  // looks at Bottom after this sees the claim
+  atomic_store_explicit( &pDeque->Bottom, Bottom, memory_order_relaxed );
+  atomic_thread_fence( memory_order_seq_cst );
+  Top = atomic_load_explicit( &pDeque->Top, memory_order_relaxed );
+
+  if ( Top > Bottom ){
+    // it was empty
+    atomic_store_explicit( &pDeque->Bottom, Bottom + 1,
+                           memory_order_relaxed );
+    return NO_NODE;
+  }
+  NodeNum = atomic_load_explicit( &pDeque->pNodeNums[Bottom & pDeque->Mask],
+                                  memory_order_relaxed );
+  if ( Top == Bottom ){
+    // the last one, which a thief may be after too
+    if ( !atomic_compare_exchange_strong_explicit( &pDeque->Top, &Top,
+                                                   Top + 1,
+                                                   memory_order_seq_cst,
+                                                   memory_order_relaxed ) ){
+      NodeNum = NO_NODE;
+    }
+    atomic_store_explicit( &pDeque->Bottom, Bottom + 1,
+                           memory_order_relaxed );
+  }
+  return NodeNum;
+}
+
+// a thief's end: take from the top, STEAL_LOST if another thread got it
+static uint32_t Steal( Deque_t * pDeque ){
+  int64_t Top = atomic_load_explicit( &pDeque->Top, memory_order_acquire );
+  int64_t Bottom;
+  uint32_t NodeNum;
+
+  atomic_thread_fence( memory_order_seq_cst );
+  Bottom = atomic_load_explicit( &pDeque->Bottom, memory_order_acquire );
+  if ( Top >= Bottom ){
+    return NO_NODE;
+  }
+  NodeNum = atomic_load_explicit( &pDeque->pNodeNums[Top & pDeque->Mask],
+                                  memory_order_relaxed );
+  if ( !atomic_compare_exchange_strong_explicit( &pDeque->Top, &Top, Top + 1,
+                                                 memory_order_seq_cst,
+                                                 memory_order_relaxed ) ){
+    return STEAL_LOST;
+  }
+  return NodeNum;
+}
+
+// tries every other worker once, starting from a random one
+static uint32_t StealAny( PoolWorker_t * pWorker ){
+  uint16_t Victim;
+  uint16_t i;
+  uint32_t NodeNum;
+
+  if ( NumPoolWorkers < 2 ){
+    return NO_NODE;
+  }
+  pWorker->Seed = pWorker->Seed * 1103515245u + 12345u;
+  Victim = (uint16_t)((pWorker->Seed >> 16) % NumPoolWorkers);
+  for ( i = 0; i < NumPoolWorkers; i++ ){
+    if ( Victim != pWorker->Number ){
+      NodeNum = Steal( &PoolWorkers[Victim].Deque );
+      if ( NodeNum < NumRunNodes ){
+        return NodeNum;
+      }
+    }
+    Victim = (uint16_t)((Victim + 1) % NumPoolWorkers);
+  }
+  return NO_NODE;
+}
+
+static uint32_t RoundUpPow2( uint32_t Size ){
+  uint32_t Pow2 = 1;
+
+  while ( Pow2 < Size ){
+    Pow2 <<= 1;
+  }
+  return Pow2;
+}
+
+#ifdef TEST
+/* node throughput benchmark. Define ES_ENABLE_NODES (in ES_Configure.h or
+   on the command line) and TEST at the top of this file only, since the
+   other modules have TEST mains of their own, then from the project
+   directory build the host sources as ES_Port_POSIX.c describes, with this
+   file in place of main_POSIX.c, and run it (the nodes do not log, see
+   ES_Log.h):
+       ./nodes_test
+   TEST_NODES nodes run TEST_ROUNDS rounds of TEST_TICKS ticks each. Every
+   round, node n is sent a whole XBee frame as key strokes to MapKeys if
+   n % TEST_BUSY_EVERY is 0, and a single key otherwise, so the steps vary
+   in length and the pool has to steal to keep the threads even. It runs
+   on 1, 2, 4 .. TEST_MAX_THREADS threads and prints the node steps per
+   second to stderr, which should scale with the threads up to the number
+   of cores.
+*/
+#include <time.h>
+#include <unistd.h>
+#include "MapKeys.h"
+
+#define TEST_NODES        4096
+#define TEST_ROUNDS       20
+#define TEST_TICKS        10
+#define TEST_BUSY_EVERY   4
+#define TEST_MAX_THREADS  8
+
+// 0x7E, a length of 5, 5 bytes of data and the check sum, see RunMapKeys
+static char const TestFrame[] = "123444444";
+
+static void TestHook( ES_Node_t * pNode, uint32_t NodeNum, uint32_t Round ){
+  ES_Event ThisEvent;
+  char const * pKey;
+
+  (void)pNode;
+  (void)Round;
+  ThisEvent.EventType = ES_NEW_KEY;
+  if ( (NodeNum % TEST_BUSY_EVERY) != 0 ){
+    ThisEvent.EventParam = '4';
+    PostMapKeys( ThisEvent );
+    return;
+  }
+  for ( pKey = TestFrame; *pKey != '\0'; pKey++ ){
+    ThisEvent.EventParam = *pKey;
+    PostMapKeys( ThisEvent );
+    // MapKeys' queue only holds a few, so let each key through
+    ES_RunToIdle();
+  }
+}
+
+int main(void)
+{
+   static ES_Node_t Nodes[TEST_NODES];
+   struct timespec Start, End;
+   double Seconds;
+   double Rate;
+   double OneThreadRate = 0;
+   uint16_t NumThreads;
+   uint32_t i;
+   bool RunOK;
+
+   ES_NodesInit();
+   fprintf(stderr, "%u nodes of %lu bytes, %u rounds, %ld cores\n",
+           TEST_NODES, (unsigned long)ContextSize, TEST_ROUNDS,
+           sysconf(_SC_NPROCESSORS_ONLN));
+   for (NumThreads = 1; NumThreads <= TEST_MAX_THREADS; NumThreads *= 2)
+   {
+      for (i = 0; i < TEST_NODES; i++)
+      {
+         if (ES_NodeCreate(&Nodes[i]) != true)
+         {
+            fprintf(stderr, "node %u failed to start\n", i);
+            return 1;
+         }
+      }
+      clock_gettime(CLOCK_MONOTONIC, &Start);
+      RunOK = ES_NodesRun(Nodes, TEST_NODES, NumThreads, TEST_ROUNDS,
+                          TEST_TICKS, TestHook);
+      clock_gettime(CLOCK_MONOTONIC, &End);
+      for (i = 0; i < TEST_NODES; i++)
+      {
+         ES_NodeDestroy(&Nodes[i]);
+      }
+      Seconds = (End.tv_sec - Start.tv_sec) +
+                (End.tv_nsec - Start.tv_nsec) / 1e9;
+      Rate = (double)TEST_NODES * TEST_ROUNDS / Seconds;
+      if (NumThreads == 1)
+      {
+         OneThreadRate = Rate;
+      }
+      fprintf(stderr, "%2u threads: %10.0f node steps/s  x%.2f%s\n",
+              NumThreads, Rate, Rate / OneThreadRate,
+              (RunOK == true) ? "" : "  (a node failed)");
+   }
+   return 0;
+}
+#endif
+
+#endif /* ES_ENABLE_NODES */
+/*------------------------------- Footnotes -------------------------------*/
+/*------------------------------ End of file ------------------------------*/
@@ -0,0 +1,306 @@
+/****************************************************************************
+ Module
+     ES_Payload.c
+ Description
+     reference counted payload buffers for events that carry more than a
+     16-bit parameter
+ Notes
+     There are ES_NUM_PAYLOADS buffers of ES_PAYLOAD_SIZE bytes, set in
+     ES_Configure.h, in an ES_Pool. A handle is the buffer's block number in
+     the pool. The counts are changed with interrupts off, since payload
+     events may be posted from interrupt responses.
+
+     See ES_Payload.h for who holds the references.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/17/26 22:00 afb      RefCount is 16 bits, 8 did not hold a reference
+                         from each of MAX_NUM_SERVICES queues
+ 10/17/26 20:00 afb      moved the pool into PayloadVars_t, one per node with
+                         ES_ENABLE_NODES
+ 10/17/26 15:30 afb      moved the buffers into an ES_Pool
+ 10/17/26 15:00 afb      Began Coding
+****************************************************************************/
+
+/*----------------------------- Include Files -----------------------------*/
+#include "ES_Configure.h"
+#include "ES_Port.h"
+#include "ES_Payload.h"
+#include "ES_Pool.h"
+#include "ES_Context.h"
+
+/*--------------------------- External Variables --------------------------*/
+
+/*----------------------------- Module Defines ----------------------------*/
+
+/*------------------------------ Module Types -----------------------------*/
+// Data comes first, the pool keeps its free list link there while the
+// buffer is free and RefCount stays at 0
+typedef struct {
+    uint8_t Data[ES_PAYLOAD_SIZE];
+    uint16_t Length;      // how many bytes of Data are in use
+    uint16_t RefCount;    // 0 while the buffer is free
+}Payload_t;
+
+// make sure that the link fits in Data and the handles fit in EventParam
+typedef char ES_PayloadTooSmall[(ES_PAYLOAD_SIZE >= sizeof(void *)) ? 1 : -1];
+typedef char ES_TooManyPayloads[(ES_NUM_PAYLOADS < ES_NO_PAYLOAD) ? 1 : -1];
+
+// and that RefCount holds a reference from every service's queue, with room
+// to spare for the producer's own and the deferral queues
+typedef char ES_RefCountTooNarrow[
+    ((1UL << (8 * sizeof(((Payload_t *)0)->RefCount))) > 2UL * MAX_NUM_SERVICES)
+    ? 1 : -1];
+
+/*---------------------------- Module Functions ---------------------------*/
+static Payload_t * HandleToPayload( uint16_t Handle );
+
+/*---------------------------- Module Variables ---------------------------*/
+// one pool per node with ES_ENABLE_NODES (see ES_Context.h)
+typedef struct {
+    ES_POOL_MEM( PayloadMem, sizeof(Payload_t), ES_NUM_PAYLOADS );
+    ES_Pool_t PayloadPool;
+}PayloadVars_t;
+
+ES_CONTEXT_VARS( PayloadVars_t, ES_Payload );
+#define pVars ES_CONTEXT( PayloadVars_t, ES_Payload )
+
+/*------------------------------ Module Code ------------------------------*/
+/****************************************************************************
+ Function
+     ES_PayloadInit
+ Parameters
+     none
+ Returns
+     none
+ Description
+     puts all of the buffers in the pool
+ Notes
+     called from ES_Initialize, before the service init functions
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+void ES_PayloadInit( void ){
+  uint16_t i;
+
+  ES_PoolInit( &pVars->PayloadPool, pVars->PayloadMem, sizeof(Payload_t),
+               ES_NUM_PAYLOADS );
+  for ( i = 0; i < ES_NUM_PAYLOADS; i++ ){
+    HandleToPayload(i)->RefCount = 0;
+  }
+}
+
+/****************************************************************************
+ Function
+     ES_PayloadAlloc
+ Parameters
+     none
+ Returns
+     uint16_t, the handle of the buffer, ES_NO_PAYLOAD if none are free
+ Description
+     takes a buffer from the pool, with a reference count of 1 (the
+     caller's) and a length of 0
+ Notes
+     may be called from an interrupt response
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+uint16_t ES_PayloadAlloc( void ){
+  Payload_t * pPayload = ES_PoolAlloc( &pVars->PayloadPool );
+
+  if ( pPayload == (Payload_t *)0 ){
+    return ES_NO_PAYLOAD;
+  }
+  // nobody else can see it yet, so no need for interrupts off
+  pPayload->RefCount = 1;
+  pPayload->Length = 0;
+  return ES_PoolBlockNum( &pVars->PayloadPool, pPayload );
+}
+
+/****************************************************************************
+ Function
+     ES_PayloadAddRef
+ Parameters
+     uint16_t Handle, the buffer to take a reference to
+ Returns
+     none
+ Description
+     adds a reference, so that the buffer stays allocated until a matching
+     ES_PayloadRelease
+ Notes
+     bad handles and free buffers are ignored
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+void ES_PayloadAddRef( uint16_t Handle ){
+  Payload_t * pPayload = HandleToPayload( Handle );
+
+  if ( pPayload == (Payload_t *)0 ){
+    return;
+  }
+  EnterCritical();
+  if ( pPayload->RefCount != 0 ){
+    pPayload->RefCount++;
+  }
+  ExitCritical();
+}
+
+/****************************************************************************
+ Function
+     ES_PayloadRelease
+ Parameters
+     uint16_t Handle, the buffer to drop a reference to
+ Returns
+     none
+ Description
+     drops a reference, and gives the buffer back to the pool if it was the
+     last one
+ Notes
+     bad handles and free buffers are ignored, so a double release can not
+     free a buffer twice
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+void ES_PayloadRelease( uint16_t Handle ){
+  Payload_t * pPayload = HandleToPayload( Handle );
+  bool WasLast = false;
+
+  if ( pPayload == (Payload_t *)0 ){
+    return;
+  }
+  EnterCritical();
+  if ( pPayload->RefCount != 0 ){
+    pPayload->RefCount--;
+    WasLast = ( pPayload->RefCount == 0 );
+  }
+  ExitCritical();
+  // the pool has its own critical region, which must not be nested in ours
+  if ( WasLast ){
+    ES_PoolFree( &pVars->PayloadPool, pPayload );
+  }
+}
+
+/****************************************************************************
+ Function
+     ES_PayloadData
+ Parameters
+     uint16_t Handle, the buffer
+ Returns
+     uint8_t *, the ES_PAYLOAD_SIZE bytes of the buffer, NULL for a bad handle
+ Description
+     gives access to the contents of the buffer
+ Notes
+     only valid while the caller holds (or its current event holds) a
+     reference
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+uint8_t * ES_PayloadData( uint16_t Handle ){
+  Payload_t * pPayload = HandleToPayload( Handle );
+
+  if ( pPayload == (Payload_t *)0 ){
+    return (uint8_t *)0;
+  }
+  return pPayload->Data;
+}
+
+/****************************************************************************
+ Function
+     ES_PayloadGetLength / ES_PayloadSetLength
+ Parameters
+     uint16_t Handle, the buffer
+     uint16_t Length, the number of bytes in use, limited to ES_PAYLOAD_SIZE
+ Returns
+     uint16_t, the number of bytes in use, 0 for a bad handle
+ Description
+     the producer records how much of the buffer it filled in
+ Notes
+
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+uint16_t ES_PayloadGetLength( uint16_t Handle ){
+  Payload_t * pPayload = HandleToPayload( Handle );
+
+  if ( pPayload == (Payload_t *)0 ){
+    return 0;
+  }
+  return pPayload->Length;
+}
+
+void ES_PayloadSetLength( uint16_t Handle, uint16_t Length ){
+  Payload_t * pPayload = HandleToPayload( Handle );
+
+  if ( pPayload == (Payload_t *)0 ){
+    return;
+  }
+  if ( Length > ES_PAYLOAD_SIZE ){
+    Length = ES_PAYLOAD_SIZE;
+  }
+  pPayload->Length = Length;
+}
+
+/****************************************************************************
+ Function
+     ES_PayloadNumFree
+ Parameters
+     none
+ Returns
+     uint16_t, the number of buffers not in use
+ Description
+     lets a service (or a test) check for leaked buffers
+ Notes
+     ES_PayloadGetPoolStats gives the high-water mark as well
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+uint16_t ES_PayloadNumFree( void ){
+  ES_PoolStats_t Stats;
+
+  ES_PoolGetStats( &pVars->PayloadPool, &Stats );
+  return Stats.NumBlocks - Stats.NumUsed;
+}
+
+/****************************************************************************
+ Function
+     ES_PayloadGetPoolStats
+ Parameters
+     ES_PoolStats_t * pStats, where to copy the stats to
+ Returns
+     none
+ Description
+     the usage and high-water stats of the payload pool, for sizing
+     ES_NUM_PAYLOADS from data
+ Notes
+
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+void ES_PayloadGetPoolStats( ES_PoolStats_t * pStats ){
+  ES_PoolGetStats( &pVars->PayloadPool, pStats );
+}
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+/****************************************************************************
+ Function
+     HandleToPayload
+ Parameters
+     uint16_t Handle, a payload handle
+ Returns
+     Payload_t *, the buffer, NULL for a bad handle
+ Description
+     looks the handle up in the pool
+ Notes
+
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+static Payload_t * HandleToPayload( uint16_t Handle ){
+  return (Payload_t *)ES_PoolBlock( &pVars->PayloadPool, Handle );
+}
+
+/*------------------------------- Footnotes -------------------------------*/
+/*------------------------------ End of file ------------------------------*/
@@ -0,0 +1,307 @@
+//#define TEST
+/****************************************************************************
+ Module
+     ES_Pool.c
+ Description
+     fixed-block memory pools, so that buffers can be shared out from one
+     place instead of each module reserving its own worst case
+ Notes
+     The free blocks of a pool are kept on a linked list threaded through
+     the blocks themselves, so a pool costs no RAM beyond its ES_Pool_t and
+     alloc and free only ever touch the head of the list.
+
+     The list and the stats are changed with interrupts off, since blocks
+     may be allocated and freed from interrupt responses. The regions are
+     not nested, so do not call these from inside EnterCritical/ExitCritical.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/17/26 15:30 afb      Began Coding
+****************************************************************************/
+
+/*----------------------------- Include Files -----------------------------*/
+#include "ES_Configure.h"
+#include "ES_Port.h"
+#include "ES_Pool.h"
+
+/*--------------------------- External Variables --------------------------*/
+
+/*----------------------------- Module Defines ----------------------------*/
+
+/*------------------------------ Module Types -----------------------------*/
+
+/*---------------------------- Module Functions ---------------------------*/
+
+/*---------------------------- Module Variables ---------------------------*/
+
+/*------------------------------ Module Code ------------------------------*/
+/****************************************************************************
+ Function
+     ES_PoolInit
+ Parameters
+     ES_Pool_t * pPool, the pool to set up
+     void * pMem, the memory for the blocks, declared with ES_POOL_MEM
+     uint16_t BlockSize, the size of a block in bytes
+     uint16_t NumBlocks, how many blocks there are room for in pMem
+ Returns
+     none
+ Description
+     puts all of the blocks on the free list and clears the stats
+ Notes
+     pMem must be at least ES_POOL_BLOCK_WORDS(BlockSize) * NumBlocks
+     pointers long, which ES_POOL_MEM makes sure of
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+void ES_PoolInit( ES_Pool_t * pPool, void * pMem, uint16_t BlockSize,
+                  uint16_t NumBlocks ){
+  uint16_t i;
+  uint8_t * pBlock;
+
+  pPool->BlockSize = (uint16_t)(ES_POOL_BLOCK_WORDS(BlockSize) *
+                                sizeof(void *));
+  pPool->NumBlocks = NumBlocks;
+  pPool->pStart = (uint8_t *)pMem;
+  // link them in address order, the lowest block first
+  pPool->pFree = (void *)0;
+  for ( i = NumBlocks; i > 0; i-- ){
+    pBlock = pPool->pStart + (uint32_t)(i-1) * pPool->BlockSize;
+    *(void **)pBlock = pPool->pFree;
+    pPool->pFree = pBlock;
+  }
+  pPool->NumFree = NumBlocks;
+  pPool->HighWater = 0;
+  pPool->NumFailed = 0;
+}
+
+/****************************************************************************
+ Function
+     ES_PoolAlloc
+ Parameters
+     ES_Pool_t * pPool, the pool to take a block from
+ Returns
+     void *, the block, NULL if the pool is empty
+ Description
+     takes the first block off the free list
+ Notes
+     the contents of the block are left as they were
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+void * ES_PoolAlloc( ES_Pool_t * pPool ){
+  void * pBlock;
+  uint16_t NumUsed;
+
+  EnterCritical();
+  pBlock = pPool->pFree;
+  if ( pBlock != (void *)0 ){
+    pPool->pFree = *(void **)pBlock;
+    pPool->NumFree--;
+    NumUsed = pPool->NumBlocks - pPool->NumFree;
+    if ( NumUsed > pPool->HighWater ){
+      pPool->HighWater = NumUsed;
+    }
+  }else{
+    pPool->NumFailed++;
+  }
+  ExitCritical();
+  return pBlock;
+}
+
+/****************************************************************************
+ Function
+     ES_PoolFree
+ Parameters
+     ES_Pool_t * pPool, the pool that the block came from
+     void * pBlock, the block to give back
+ Returns
+     bool, false if pBlock is not a block of this pool
+ Description
+     puts the block back on the front of the free list
+ Notes
+     freeing a block twice is not caught
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+bool ES_PoolFree( ES_Pool_t * pPool, void * pBlock ){
+  if ( ES_PoolBlockNum( pPool, pBlock ) == ES_POOL_NO_BLOCK ){
+    return false;
+  }
+  EnterCritical();
+  *(void **)pBlock = pPool->pFree;
+  pPool->pFree = pBlock;
+  pPool->NumFree++;
+  ExitCritical();
+  return true;
+}
+
+/****************************************************************************
+ Function
+     ES_PoolBlockNum
+ Parameters
+     ES_Pool_t const * pPool, the pool
+     void const * pBlock, a block of the pool
+ Returns
+     uint16_t, the number of the block, from 0, or ES_POOL_NO_BLOCK if
+     pBlock is not the start of one of the pool's blocks
+ Description
+     turns a block into a number small enough to travel in an EventParam
+ Notes
+
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+uint16_t ES_PoolBlockNum( ES_Pool_t const * pPool, void const * pBlock ){
+  uint8_t const * pByte = (uint8_t const *)pBlock;
+  uint32_t Offset;
+
+  if ( pByte < pPool->pStart ){
+    return ES_POOL_NO_BLOCK;
+  }
+  Offset = (uint32_t)(pByte - pPool->pStart);
+  if ( ((Offset % pPool->BlockSize) != 0) ||
+       ((Offset / pPool->BlockSize) >= pPool->NumBlocks) ){
+    return ES_POOL_NO_BLOCK;
+  }
+  return (uint16_t)(Offset / pPool->BlockSize);
+}
+
+/****************************************************************************
+ Function
+     ES_PoolBlock
+ Parameters
+     ES_Pool_t const * pPool, the pool
+     uint16_t BlockNum, the number from ES_PoolBlockNum
+ Returns
+     void *, the block, NULL if there is no such block
+ Description
+     turns a block number back into the block
+ Notes
+
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+void * ES_PoolBlock( ES_Pool_t const * pPool, uint16_t BlockNum ){
+  if ( BlockNum >= pPool->NumBlocks ){
+    return (void *)0;
+  }
+  return pPool->pStart + (uint32_t)BlockNum * pPool->BlockSize;
+}
+
+/****************************************************************************
+ Function
+     ES_PoolGetStats
+ Parameters
+     ES_Pool_t * pPool, the pool to report on
+     ES_PoolStats_t * pStats, where to copy the stats to
+ Returns
+     none
+ Description
+     takes a snapshot of how much of the pool is in use, the most that has
+     been in use since the last reset and the number of failed allocs
+ Notes
+
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+void ES_PoolGetStats( ES_Pool_t * pPool, ES_PoolStats_t * pStats ){
+  EnterCritical();
+  pStats->BlockSize = pPool->BlockSize;
+  pStats->NumBlocks = pPool->NumBlocks;
+  pStats->NumUsed = pPool->NumBlocks - pPool->NumFree;
+  pStats->HighWater = pPool->HighWater;
+  pStats->NumFailed = pPool->NumFailed;
+  ExitCritical();
+}
+
+/****************************************************************************
+ Function
+     ES_PoolResetStats
+ Parameters
+     ES_Pool_t * pPool, the pool
+ Returns
+     none
+ Description
+     restarts the high-water mark from the number in use now and clears the
+     failed alloc count
+ Notes
+
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+void ES_PoolResetStats( ES_Pool_t * pPool ){
+  EnterCritical();
+  pPool->HighWater = pPool->NumBlocks - pPool->NumFree;
+  pPool->NumFailed = 0;
+  ExitCritical();
+}
+
+#ifdef TEST
+/* test harness for the pools, runs on the host. With TEST defined at the
+   top of this file:
+   gcc -std=gnu99 -O2 -DES_PORT_POSIX -IHeaders Source/ES_Pool.c -o pool_test
+   Checks the block sizes, that every block comes out once before the pool
+   runs dry, that the numbers round trip and that the stats add up.
+*/
+#include <stdio.h>
+
+#define TEST_BLOCK_SIZE 13
+#define TEST_NUM_BLOCKS 5
+
+static ES_POOL_MEM( TestMem, TEST_BLOCK_SIZE, TEST_NUM_BLOCKS );
+static ES_Pool_t TestPool;
+static int NumWrong;
+
+// the test has no interrupts to hold off
+void _HW_EnterCritical(void) {}
+void _HW_ExitCritical(void) {}
+
+static void Check( bool Good, char const * pWhat )
+{
+   if (!Good)
+   {
+      printf("failed: %s\n", pWhat);
+      NumWrong++;
+   }
+}
+
+int main(void)
+{
+   void * pBlocks[TEST_NUM_BLOCKS];
+   ES_PoolStats_t Stats;
+   uint16_t i;
+
+   ES_PoolInit(&TestPool, TestMem, TEST_BLOCK_SIZE, TEST_NUM_BLOCKS);
+   Check(TestPool.BlockSize % sizeof(void *) == 0, "block size rounded up");
+   for (i = 0; i < TEST_NUM_BLOCKS; i++)
+   {
+      pBlocks[i] = ES_PoolAlloc(&TestPool);
+      Check(pBlocks[i] != NULL, "alloc while not empty");
+      Check(ES_PoolBlockNum(&TestPool, pBlocks[i]) == i, "lowest block first");
+      Check(ES_PoolBlock(&TestPool, i) == pBlocks[i], "number round trip");
+   }
+   Check(ES_PoolAlloc(&TestPool) == NULL, "alloc when empty");
+   Check(ES_PoolFree(&TestPool, (uint8_t *)pBlocks[1] + 1) == false,
+         "free of a pointer into a block");
+   Check(ES_PoolFree(&TestPool, &Stats) == false, "free of a foreign pointer");
+
+   Check(ES_PoolFree(&TestPool, pBlocks[3]), "free");
+   Check(ES_PoolFree(&TestPool, pBlocks[1]), "free");
+   Check(ES_PoolAlloc(&TestPool) == pBlocks[1], "last freed comes out first");
+
+   ES_PoolGetStats(&TestPool, &Stats);
+   Check(Stats.NumUsed == TEST_NUM_BLOCKS - 1, "in use count");
+   Check(Stats.HighWater == TEST_NUM_BLOCKS, "high water");
+   Check(Stats.NumFailed == 1, "failed count");
+   ES_PoolResetStats(&TestPool);
+   ES_PoolGetStats(&TestPool, &Stats);
+   Check(Stats.HighWater == TEST_NUM_BLOCKS - 1, "high water after reset");
+   Check(Stats.NumFailed == 0, "failed count after reset");
+
+   printf("%s\n", NumWrong ? "FAILED" : "passed");
+   return NumWrong != 0;
+}
+#endif
+/*------------------------------- Footnotes -------------------------------*/
+/*------------------------------ End of file ------------------------------*/
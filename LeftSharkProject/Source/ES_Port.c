@@ -15,6 +15,14 @@
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/17/26 22:30 afb     the tickless _HW_Idle checks for posts with PRIMASK
+                        set, not just for ticks, before it sleeps
+ 10/17/26 19:00 afb     added the PendSV & SVCall handlers that run ES_Activate
+                        for ES_ENABLE_PREEMPTION
+ 10/17/26 13:30 afb     SysTickCounter is 64 bits, added _HW_GetTimeUs
+ 10/17/26 12:30 afb     added the tickless _HW_Idle, TickCount is now 16 bits
+                        so that it can hold the ticks credited after a sleep
+ 10/17/26 11:30 afb     added _HW_CycleCounterInit for the profiler
  08/13/13 12:42 jec     moved the hardware specific aspects of the timer here
  08/06/13 13:17 jec     Began moving the stuff from the V2 framework files
  03/05/14 13:20	joa		Began port for TM4C123G
@@ -24,6 +32,10 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "inc/hw_memmap.h"
+#include "inc/hw_types.h"
+#include "inc/hw_nvic.h"
+#include "inc/hw_ints.h"
+#include "driverlib/cpu.h"
 #include "driverlib/sysctl.h"
 #include "driverlib/interrupt.h"
 #include "driverlib/uart.h"
@@ -31,15 +43,32 @@
 #include "driverlib/systick.h"
 #include "driverlib/gpio.h"
 #include "utils/uartstdio.h"
+#include "ES_Configure.h"
 #include "ES_Port.h"
 #include "ES_Types.h"
 #include "ES_Timers.h"
+#include "ES_Framework.h"
 
 #define UART_PORT 		0
 #define UART_BAUD		115200UL
 #define SRC_CLK_FREQ	16000000UL
 #define CLK_FREQ		40000000UL
 
+// the debug registers that turn on the DWT cycle counter, see the ARMv7-M
+// Architecture Reference Manual (C1.6.5 & C1.8.7)
+#define DEMCR               (*(volatile uint32_t *)0xE000EDFCUL)
+#define DEMCR_TRCENA        0x01000000UL
+#define DWT_CTRL            (*(volatile uint32_t *)0xE0001000UL)
+#define DWT_CTRL_CYCCNTENA  0x00000001UL
+
+// SysTick is a 24 bit down counter
+#define SYSTICK_MAX_LOAD    0x00FFFFFFUL
+
+#define CYCLES_PER_US       (CLK_FREQ / 1000000UL)
+
+// the lowest interrupt priority, the TM4C implements the top 3 bits
+#define LOWEST_INT_PRIORITY 0xE0
+
 // TickCount is used to track the number of timer ints that have occurred
 // since the last check. It should really never be more than 1, but just to
 // be sure, we increment it in the interrupt response rather than simply 
@@ -47,12 +76,15 @@
 // need to post events from the interrupt response routine. This is necessary
 // for compilers like HTC for the midrange PICs which do not produce re-entrant
 // code so cannot post directly to the queues from within the interrupt resp.
-static volatile uint8_t TickCount;
+static volatile uint16_t TickCount;
 
 // Global tick count to monitor number of SysTick Interrupts
-// make uint16_t to maintain backwards compatibility and not overly burden
-// 8 and 16 bit processors
-static volatile uint16_t SysTickCounter = 0;
+// 64 bits so that _HW_GetTimeUs never wraps, _HW_GetTickCount still hands
+// out the low 16 bits for backwards compatibility
+static volatile uint64_t SysTickCounter = 0;
+
+// the number of core clocks in one tick, the SysTick reload value + 1
+static uint32_t TickPeriod;
 
 /****************************************************************************
  Function
@@ -74,6 +106,7 @@ static volatile uint16_t SysTickCounter = 0;
 void _HW_Timer_Init(TimerRate_t Rate)
 {
 	SysTickPeriodSet(Rate);			/* Set the SysTick Interrupt Rate */
+  TickPeriod = HWREG(NVIC_ST_RELOAD) + 1; // remember the period as programmed
 	SysTickIntEnable();				/* Enable the SysTick Interrupt */
 	SysTickEnable();				/* Enable SysTick */
 	IntMasterEnable();				/* Make sure interrupts are enabled */
@@ -124,9 +157,206 @@ void SysTickIntHandler(void)
 ****************************************************************************/
 uint16_t _HW_GetTickCount(void)
 {
-   return (SysTickCounter);
+   return ((uint16_t)SysTickCounter);
+}
+
+/****************************************************************************
+ Function
+    _HW_GetTimeUs()
+ Parameters
+    none
+ Returns
+    uint64_t   microseconds since the tick was started
+ Description
+    combines the tick count with how far SysTick has counted down through
+    the current tick
+ Notes
+    if SysTick ran out after interrupts went off, its interrupt is still
+    pending and the tick that it marks has not been counted yet, so count
+    it here and take the counter again from the new tick
+ Author
+    Drew Bell, 10/17/26 13:30
+****************************************************************************/
+uint64_t _HW_GetTimeUs(void)
+{
+  uint32_t SavedPRIMASK;
+  uint64_t Ticks;
+  uint32_t Current;
+  uint32_t IntoTick;
+
+  SavedPRIMASK = CPUgetPRIMASK_cpsid();
+  Ticks = SysTickCounter;
+  Current = HWREG(NVIC_ST_CURRENT);
+  if ((HWREG(NVIC_INT_CTRL) & NVIC_INT_CTRL_PENDSTSET) != 0)
+  {
+    Ticks++;
+    Current = HWREG(NVIC_ST_CURRENT);
+  }
+  CPUsetPRIMASK(SavedPRIMASK);
+
+  // the first tick after a tickless sleep can be a cycle longer than normal
+  IntoTick = (Current < TickPeriod) ? (TickPeriod - 1 - Current) : 0;
+  return ((Ticks * TickPeriod) + IntoTick) / CYCLES_PER_US;
+}
+
+/****************************************************************************
+ Function
+    _HW_CycleCounterInit()
+ Parameters
+    none
+ Returns
+    none
+ Description
+    enables the DWT cycle counter that _HW_GetCycleCount() reads
+ Notes
+    the debugger may already have done this, doing it twice is harmless
+ Author
+    Drew Bell, 10/17/26 11:30
+****************************************************************************/
+void _HW_CycleCounterInit(void)
+{
+  DEMCR |= DEMCR_TRCENA;
+  DWT_CTRL |= DWT_CTRL_CYCCNTENA;
 }
 
+#ifdef ES_ENABLE_PREEMPTION
+/****************************************************************************
+ Function
+    _HW_PreemptInit()
+ Parameters
+    none
+ Returns
+    none
+ Description
+    puts PendSV below every other interrupt, so that the services that an
+    interrupt response posts to only run once all of the interrupts have
+    returned
+ Notes
+    called from ES_Initialize. The interrupt responses that post must be
+    at a higher priority (lower number) than LOWEST_INT_PRIORITY.
+ Author
+    Drew Bell, 10/17/26 19:00
+****************************************************************************/
+void _HW_PreemptInit(void)
+{
+  IntPrioritySet(FAULT_PENDSV, LOWEST_INT_PRIORITY);
+}
+
+#if defined(rvmdk) || defined(__ARMCC_VERSION)
+/****************************************************************************
+ Function
+    PendSVIntHandler
+ Parameters
+    none
+ Returns
+    None.
+ Description
+    runs ES_Activate in thread mode, on top of whatever PendSV interrupted,
+    by returning from the exception into it through a made up stack frame.
+    ES_Activate returns to ActivateReturn, which raises an SVCall to get
+    back into handler mode and return from PendSV for real.
+ Notes
+    all on the main stack. PRIMASK is set on the way in, since ES_Activate
+    must be entered with interrupts off, and cleared at ActivateReturn.
+    If the interrupted code had the FPU in use, a VMOV forces the lazy
+    stacking of its FP registers before the services can change them.
+    Only one SVC is ever raised, so SVCall does not look at its number.
+ Author
+    Drew Bell, 10/17/26 19:00
+****************************************************************************/
+__asm void PendSVIntHandler(void)
+{
+    IMPORT  ES_Activate
+    PRESERVE8
+
+    CPSID   i
+#ifdef __TARGET_FPU_VFP
+    TST     lr, #0x10               ; EXC_RETURN bit 4 clear, FP frame
+    IT      EQ
+    VMOVEQ.F32 s0, s0               ; make the lazy FP stacking happen now
+#endif
+    PUSH    {r0, lr}                ; r0 keeps the stack 8 byte aligned
+    SUB     sp, sp, #(8*4)          ; frame: r0-r3, r12, lr, pc, xPSR
+    LDR     r0, =ActivateReturn
+    ORR     r0, r0, #1              ; return address, in Thumb state
+    STR     r0, [sp, #(5*4)]        ; lr
+    LDR     r0, =ES_Activate
+    BIC     r0, r0, #1              ; a stacked pc has bit 0 clear
+    STR     r0, [sp, #(6*4)]        ; pc
+    MOV     r0, #0x01000000         ; Thumb bit
+    STR     r0, [sp, #(7*4)]        ; xPSR
+    LDR     r0, =0xFFFFFFF9         ; to thread mode, main stack, no FP frame
+    BX      r0
+
+ActivateReturn
+    CPSIE   i
+    SVC     #0                      ; SVCallIntHandler finishes PendSV
+    B       .                       ; never gets here
+    ALIGN
+}
+
+/****************************************************************************
+ Function
+    SVCallIntHandler
+ Parameters
+    none
+ Returns
+    None.
+ Description
+    throws away its own stack frame, and returns from the PendSV exception
+    with the EXC_RETURN that PendSVIntHandler saved, back to whatever was
+    interrupted
+ Notes
+    the FP part of the frame is there if a service used the FPU, a VMOV
+    finishes its lazy stacking before the frame is dropped
+ Author
+    Drew Bell, 10/17/26 19:00
+****************************************************************************/
+__asm void SVCallIntHandler(void)
+{
+#ifdef __TARGET_FPU_VFP
+    TST     lr, #0x10               ; EXC_RETURN bit 4 clear, FP frame
+    ITT     EQ
+    VMOVEQ.F32 s0, s0
+    ADDEQ   sp, sp, #(18*4)         ; s0-s15, FPSCR and the reserved word
+#endif
+    ADD     sp, sp, #(8*4)          ; r0-r3, r12, lr, pc, xPSR
+    POP     {r0, lr}                ; what PendSVIntHandler pushed
+    BX      lr
+}
+#else
+#error the PendSV & SVCall handlers are written for the Keil (armcc) assembler
+#endif
+
+#else
+/****************************************************************************
+ Function
+    PendSVIntHandler, SVCallIntHandler
+ Parameters
+    none
+ Returns
+    None.
+ Description
+    without ES_ENABLE_PREEMPTION nothing uses these, so they do what
+    IntDefaultHandler does and stop here for the debugger
+ Author
+    Drew Bell, 10/17/26 19:00
+****************************************************************************/
+void PendSVIntHandler(void)
+{
+  while (1)
+  {
+  }
+}
+
+void SVCallIntHandler(void)
+{
+  while (1)
+  {
+  }
+}
+#endif
+
 /****************************************************************************
  Function
      _HW_Process_Pending_Ints
@@ -159,6 +389,122 @@ bool _HW_Process_Pending_Ints( void )
    return true; // always return true to allow loop test in ES_Run to proceed
 }
 
+#ifdef ES_ENABLE_TICKLESS_IDLE
+/****************************************************************************
+ Function
+     _HW_Idle
+ Parameters
+     none
+ Returns
+     none.
+ Description
+     called from ES_Run when all of the queues are empty and no event checker
+     found anything. Stretches the current SysTick period out to the next
+     timer expiry (or ES_TICKLESS_MAX_IDLE_TICKS), sleeps with WFI, then
+     credits the ticks that passed to TickCount & SysTickCounter and puts
+     SysTick back on the normal tick boundaries.
+ Notes
+     interrupts stay masked from the time that the sleep is set up until the
+     ticks have been credited. The queues are checked again after they are
+     masked, so that a post from an interrupt response that came in after
+     ES_Run found them empty is not left waiting out the sleep. WFI still wakes up on a masked interrupt, its
+     response runs once the PRIMASK is restored at the end.
+     SysTick is stopped for a few cycles while it is reprogrammed, so the
+     tick falls that far behind real time on each long sleep.
+ Author
+     Drew Bell, 10/17/26 12:30
+****************************************************************************/
+void _HW_Idle(void)
+{
+  uint32_t IdleTicks;
+  uint32_t Remaining;
+  uint32_t SleepLoad;
+  uint32_t SinceLastTick;
+  uint32_t Elapsed;
+  uint32_t NextLoad;
+  uint32_t SavedPRIMASK;
+
+  IdleTicks = ES_Timer_GetTicksToNextExpiry();
+  if (IdleTicks > ES_TICKLESS_MAX_IDLE_TICKS)
+  {
+    IdleTicks = ES_TICKLESS_MAX_IDLE_TICKS;
+  }
+  if (IdleTicks > (SYSTICK_MAX_LOAD / TickPeriod))
+  {
+    IdleTicks = SYSTICK_MAX_LOAD / TickPeriod;
+  }
+
+  SavedPRIMASK = CPUgetPRIMASK_cpsid();
+  if ((TickCount != 0) || ES_IsAnyServiceReady())
+  {
+    // a tick or a post came in since ES_Run looked, go back and process it
+    CPUsetPRIMASK(SavedPRIMASK);
+    return;
+  }
+  if (IdleTicks < 2)
+  {
+    CPUwfi();   // the next tick is due anyway, just sleep until it comes
+    CPUsetPRIMASK(SavedPRIMASK);
+    return;
+  }
+
+  // stop the tick and see how far into the current tick we are
+  HWREG(NVIC_ST_CTRL) &= ~NVIC_ST_CTRL_ENABLE;
+  Remaining = HWREG(NVIC_ST_CURRENT);
+  if ((Remaining == 0) ||
+      ((HWREG(NVIC_INT_CTRL) & NVIC_INT_CTRL_PENDSTSET) != 0))
+  {
+    // it just ran out, let the tick interrupt happen as normal
+    HWREG(NVIC_ST_CTRL) |= NVIC_ST_CTRL_ENABLE;
+    CPUsetPRIMASK(SavedPRIMASK);
+    return;
+  }
+
+  // run the counter out to the end of the last tick that we will skip
+  SleepLoad = Remaining + (IdleTicks - 1) * TickPeriod;
+  HWREG(NVIC_ST_RELOAD) = SleepLoad - 1;
+  HWREG(NVIC_ST_CURRENT) = 0;
+  HWREG(NVIC_ST_CTRL) |= NVIC_ST_CTRL_ENABLE;
+
+  CPUwfi();
+
+  HWREG(NVIC_ST_CTRL) &= ~NVIC_ST_CTRL_ENABLE;
+  if ((HWREG(NVIC_INT_CTRL) & NVIC_INT_CTRL_PENDSTSET) != 0)
+  {
+    // slept the whole way, the counter reloaded with SleepLoad - 1 when it
+    // ran out. The tick interrupt will count the last tick.
+    SinceLastTick = (SleepLoad - 1) - HWREG(NVIC_ST_CURRENT);
+    Elapsed = IdleTicks - 1;
+  }
+  else
+  {
+    // woken early by some other interrupt
+    SinceLastTick = (TickPeriod - Remaining) +
+                    ((SleepLoad - 1) - HWREG(NVIC_ST_CURRENT));
+    Elapsed = 0;
+  }
+  Elapsed += SinceLastTick / TickPeriod;
+  NextLoad = TickPeriod - (SinceLastTick % TickPeriod);
+  if (NextLoad < 2)
+  {
+    // too close to the boundary to program, count it now instead
+    NextLoad += TickPeriod;
+    Elapsed++;
+  }
+
+  // restart from the time left in this tick, then go back to the normal
+  // period, which SysTick picks up the next time that it runs out
+  HWREG(NVIC_ST_RELOAD) = NextLoad - 1;
+  HWREG(NVIC_ST_CURRENT) = 0;
+  HWREG(NVIC_ST_CTRL) |= NVIC_ST_CTRL_ENABLE;
+  HWREG(NVIC_ST_RELOAD) = TickPeriod - 1;
+
+  TickCount += Elapsed;
+  SysTickCounter += Elapsed;
+  CPUsetPRIMASK(SavedPRIMASK);
+}
+#endif /* ES_ENABLE_TICKLESS_IDLE */
+
 /****************************************************************************
  Function
      ConsoleInit
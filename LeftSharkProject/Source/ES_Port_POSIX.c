@@ -0,0 +1,930 @@
+/****************************************************************************
+ Module
+   ES_Port_POSIX.c
+
+ Revision
+   1.0.1
+
+ Description
+   This is the port of the hardware specific functions of the Events &
+   Services Framework to a Linux (POSIX) host. It lets the framework, the
+   queues, the timers and the services that do not touch the Tiva hardware
+   run natively, so that they can be benchmarked and load-tested without a
+   LaunchPad.
+
+ Notes
+   The SysTick interrupt is replaced by a timerfd that expires once per tick.
+   The expirations are collected (and the framework timers ticked) in
+   _HW_Process_Pending_Ints, just as the target collects the TickCount set by
+   SysTickIntHandler. When ES_Run has nothing to do, _HW_Idle blocks in
+   epoll_wait on the timerfd and stdin rather than spinning through the
+   event checkers.
+
+   With ES_ENABLE_TICKLESS_IDLE, _HW_Idle re-arms the timerfd as a one-shot
+   for the next ES_Timer expiry instead, and credits the ticks that passed
+   when it wakes up. Stopping the process with SIGINT or SIGTERM prints the
+   CPU time used and the number of idle wakeups, so the two modes can be
+   compared by running the same load with and without the define.
+
+   The critical region wrappers take a recursive mutex, so anything that
+   plays the part of an interrupt on the host (a second thread, a signal
+   handler) must go through EnterCritical/ExitCritical as well.
+
+   _HW_SimInterruptStart drives a periodic SIGUSR1 at the framework's
+   thread, whose handler stands in for an interrupt response. Once it is
+   running the critical regions block it as well. With ES_ENABLE_PREEMPTION
+   SIGUSR2 stands in for PendSV: a post sends it to the framework's thread
+   and its handler runs ES_Activate, on top of the service (or simulated
+   interrupt) that it lands in, just as PendSV does on the target. Both are
+   blocked while "interrupts are off", so the same code paths get exercised
+   as on the target and the time from a post in the simulated interrupt to
+   the start of the service shows up in the profiler's QueueWait stats.
+
+   This file replaces ES_Port.c in a host build. It is not part of the
+   Keil project. To build the host image from the project directory:
+
+   gcc -std=gnu99 -O2 -DES_PORT_POSIX -IHeaders -o es_host
+       Source/ES_Port_POSIX.c Source/main_POSIX.c Source/ES_Framework.c
+       Source/ES_Queue.c Source/ES_Timers.c Source/ES_LookupTables.c
+       Source/ES_PostList.c Source/ES_CheckEvents.c Source/ES_DeferRecall.c
+       Source/ES_Profile.c Source/ES_Payload.c Source/ES_Pool.c
+       Source/ES_Coalesce.c Source/ES_Trace.c Source/ES_Log.c
+       Source/ES_Threads_POSIX.c Source/ES_Nodes_POSIX.c
+       Source/ES_Sim_POSIX.c Source/EventCheckers.c Source/MapKeys.c
+       Source/RxSM.c -lpthread -lrt
+
+   The log (ES_Log.h) goes to stdout in binary frames between the console
+   text, run it as ./es_host | ./es_log_decode - to read it (see
+   Tools/ES_LogDecode.c).
+
+   With ES_ENABLE_NODES or ES_ENABLE_SIM (ES_VIRTUAL_TIME) there is no tick
+   or idle here, ES_Nodes_POSIX.c or ES_Sim_POSIX.c credits the ticks, and
+   _HW_GetTimeUs counts them rather than reading the clock. The process
+   needs a main that drives them (like the TEST ones there) in place of
+   main_POSIX.c.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/17/26 22:30 afb     _HW_Idle checks for posts with the interrupt signals
+                        blocked and lets them in only for the wait
+ 10/17/26 22:00 afb     FrameworkThread only with ES_ENABLE_PREEMPTION
+ 10/17/26 20:30 afb     ES_VIRTUAL_TIME (nodes or ES_ENABLE_SIM) also keeps
+                        _HW_GetTimeUs on the credited ticks, and the ticks
+                        go to the timers in bulk
+ 10/17/26 20:00 afb     tick counts kept in PortVars_t, one set per node
+                        with ES_ENABLE_NODES, where there is no tick, and
+                        _HW_AddTicks for the nodes
+ 10/17/26 19:00 afb     simulated interrupt, and the PendSV signal for
+                        ES_ENABLE_PREEMPTION
+ 10/17/26 13:30 afb     added _HW_GetTimeUs
+ 10/17/26 12:30 afb     tick kept on absolute time, tickless idle, and a
+                        CPU time report on SIGINT/SIGTERM
+ 10/17/26 11:30 afb     added the profiler time stamp
+ 10/17/26 09:30 afb     first pass, timerfd tick and epoll idle
+****************************************************************************/
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/syscall.h>
+#include <time.h>
+
+#include "ES_Configure.h"
+#include "ES_Port.h"
+#include "ES_Types.h"
+#include "ES_Timers.h"
+#include "ES_Framework.h"
+#include "ES_Context.h"
+
+/*----------------------------- Module Defines ----------------------------*/
+#define US_PER_SEC    1000000UL
+#define NS_PER_US     1000UL
+#define NS_PER_SEC    1000000000UL
+#define NO_KEY        (-1)
+
+// the signals that stand in for interrupts
+#define SIM_INT_SIGNAL  SIGUSR1
+#define PENDSV_SIGNAL   SIGUSR2
+
+/*---------------------------- Module Functions ---------------------------*/
+static void HarvestTicks( void );
+static uint64_t NowNs( void );
+#ifndef ES_VIRTUAL_TIME
+static void ArmTick( uint64_t FirstNs, uint64_t PeriodNs );
+static void StopHandler( int Signal );
+#endif
+static void WaitForWakeup( sigset_t const * pWaitMask );
+static void ReportAndExit( void );
+static void InitIntSignals( void );
+static void SimIntHandler( int Signal );
+#ifdef ES_ENABLE_PREEMPTION
+static void PendSVHandler( int Signal );
+#endif
+#ifdef ES_ENABLE_TICKLESS_IDLE
+static void CreditSleep( void );
+#endif
+
+/*---------------------------- Module Variables ---------------------------*/
+// the tick counts, one set per node with ES_ENABLE_NODES (see ES_Context.h)
+typedef struct {
+  // TickCount plays the same part as it does in ES_Port.c: the number of
+  // ticks that have elapsed but have not yet been passed on to
+  // ES_Timer_Tick_Resp
+  uint32_t TickCount;
+
+  // Global tick count, kept as a uint16_t to match the target port
+  uint16_t SysTickCounter;
+
+#ifdef ES_VIRTUAL_TIME
+  // every tick credited since ES_Initialize, for _HW_GetTimeUs
+  uint64_t VirtualTicks;
+#endif
+} PortVars_t;
+
+ES_CONTEXT_VARS( PortVars_t, ES_Port );
+#define pVars ES_CONTEXT( PortVars_t, ES_Port )
+
+// the tick period, and the time at which the last counted tick was due. The
+// timerfd is always armed on absolute times from TickBaseNs, so the tick
+// keeps its phase across tickless sleeps.
+static uint64_t TickPeriodNs;
+static uint64_t TickBaseNs;
+
+// for the report when we are stopped
+static uint64_t StartNs;
+static uint32_t TotalTicks;
+static uint32_t IdleWakeups;
+static volatile sig_atomic_t StopRequested = 0;
+
+// the file descriptors for the tick timer and the idle wait
+static int TickFd = -1;
+static int EpollFd = -1;
+
+// stdin is dropped from the idle wait once it reaches end of file so that a
+// closed pipe does not keep waking us up
+static bool StdinOpen = true;
+// one character of look-ahead for kbhit/_HW_GetNewKey
+static int PendingKey = NO_KEY;
+
+// stands in for PRIMASK, recursive so that nested critical regions are safe
+static pthread_mutex_t CriticalLock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+
+// the signals that play interrupts, and whether there are any yet. Once
+// there are, the critical regions block them, since the mutex does not keep
+// a signal handler in the same thread out.
+static sigset_t IntSignals;
+static volatile bool MaskInCritical = false;
+// the nesting of the critical regions, and the signal mask to go back to
+// when the outermost one is left
+static __thread uint32_t CriticalDepth;
+static __thread sigset_t CriticalSavedMask;
+
+// the simulated interrupt response
+static void (*pSimISR)(void);
+#ifdef ES_ENABLE_PREEMPTION
+// the thread that the PendSV signal preempts
+static pthread_t FrameworkThread;
+#endif
+
+/*------------------------------ Module Code ------------------------------*/
+/****************************************************************************
+ Function
+     _HW_Timer_Init
+ Parameters
+     TimerRate_t Rate set to one of the ES_Timer_RATE_XX values to set the
+     tick rate
+ Returns
+     None.
+ Description
+     Creates the timerfd that generates the tick and the epoll set used to
+     idle on it
+ Notes
+     the host rates are in microseconds, see ES_Port.h
+ Author
+     Drew Bell, 10/17/26 09:30
+****************************************************************************/
+void _HW_Timer_Init(TimerRate_t Rate)
+{
+#ifdef ES_VIRTUAL_TIME
+  // the ticks come from ES_NodeStep or ES_Sim, through _HW_AddTicks, so
+  // there is no tick to set up here. A node's counts start at 0 anyway, a
+  // simulation that is run again starts from 0 too.
+  TickPeriodNs = (uint64_t)Rate * NS_PER_US;
+  pVars->TickCount = 0;
+  pVars->SysTickCounter = 0;
+  pVars->VirtualTicks = 0;
+  if (StartNs == 0)
+  {
+    StartNs = NowNs();
+  }
+#else
+  struct epoll_event WaitFor;
+  struct sigaction OnStop;
+
+  TickFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  EpollFd = epoll_create1(EPOLL_CLOEXEC);
+  if ((TickFd < 0) || (EpollFd < 0))
+  {
+    perror("ES_Port_POSIX: timer init");
+    exit(EXIT_FAILURE);
+  }
+
+  TickPeriodNs = (uint64_t)Rate * NS_PER_US;
+  StartNs = TickBaseNs = NowNs();
+  ArmTick(TickBaseNs + TickPeriodNs, TickPeriodNs);
+
+  WaitFor.events = EPOLLIN;
+  WaitFor.data.fd = TickFd;
+  epoll_ctl(EpollFd, EPOLL_CTL_ADD, TickFd, &WaitFor);
+  WaitFor.data.fd = STDIN_FILENO;
+  if (epoll_ctl(EpollFd, EPOLL_CTL_ADD, STDIN_FILENO, &WaitFor) != 0)
+  {
+    // regular files can't be waited on, so treat them as always ready
+    StdinOpen = (errno == EPERM);
+  }
+
+  // no SA_RESTART, so that a signal ends the idle wait
+  OnStop.sa_handler = StopHandler;
+  sigemptyset(&OnStop.sa_mask);
+  OnStop.sa_flags = 0;
+  sigaction(SIGINT, &OnStop, NULL);
+  sigaction(SIGTERM, &OnStop, NULL);
+#endif
+}
+
+#ifdef ES_VIRTUAL_TIME
+/****************************************************************************
+ Function
+     _HW_AddTicks
+ Parameters
+     uint32_t NumTicks, the number of ticks that have passed
+ Returns
+     None.
+ Description
+     credits ticks (to the node that this thread is running, with
+     ES_ENABLE_NODES) for the next _HW_Process_Pending_Ints to hand to the
+     timers
+ Notes
+     the time only moves here, see ES_NodeStep and ES_SimRun
+ Author
+     Drew Bell, 10/17/26 20:00
+****************************************************************************/
+void _HW_AddTicks(uint32_t NumTicks)
+{
+  pVars->TickCount += NumTicks;
+  pVars->SysTickCounter += (uint16_t)NumTicks;
+  pVars->VirtualTicks += NumTicks;
+}
+#endif
+
+/****************************************************************************
+ Function
+    _HW_GetTickCount()
+ Parameters
+    none
+ Returns
+    uint16_t   count of number of system ticks that have occurred.
+ Description
+    wrapper for access to SysTickCounter
+ Notes
+    collects any expirations first, so the count keeps up during blocking
+    code just as it does on the target
+ Author
+    Drew Bell, 10/17/26 09:30
+****************************************************************************/
+uint16_t _HW_GetTickCount(void)
+{
+  HarvestTicks();
+  return (pVars->SysTickCounter);
+}
+
+/****************************************************************************
+ Function
+    _HW_GetTimeUs()
+ Parameters
+    none
+ Returns
+    uint64_t   microseconds since the tick was started
+ Description
+    host version of the microsecond time base, straight from the clock
+ Author
+    Drew Bell, 10/17/26 13:30
+****************************************************************************/
+uint64_t _HW_GetTimeUs(void)
+{
+#ifdef ES_VIRTUAL_TIME
+  // the time of the last tick credited, so a run gives the same times again
+  return pVars->VirtualTicks * TickPeriodNs / NS_PER_US;
+#else
+  return (NowNs() - StartNs) / NS_PER_US;
+#endif
+}
+
+/****************************************************************************
+ Function
+    _HW_CycleCounterInit / _HW_GetCycleCount
+ Parameters
+    none
+ Returns
+    uint32_t, _HW_GetCycleCount returns the time stamp in nanoseconds
+ Description
+    host versions of the DWT cycle counter used by the profiler
+ Notes
+    the count wraps every 4.29 seconds, so only differences are meaningful
+ Author
+    Drew Bell, 10/17/26 11:30
+****************************************************************************/
+void _HW_CycleCounterInit(void)
+{
+}
+
+uint32_t _HW_GetCycleCount(void)
+{
+  struct timespec Now;
+
+  clock_gettime(CLOCK_MONOTONIC, &Now);
+  return (uint32_t)((uint64_t)Now.tv_sec * NS_PER_SEC + Now.tv_nsec);
+}
+
+/****************************************************************************
+ Function
+     _HW_Process_Pending_Ints
+ Parameters
+     none
+ Returns
+     always true.
+ Description
+     collects the tick expirations from the timerfd and hands them to the
+     timers with the framework's bulk tick response, which takes as long as
+     the number of timers that expire in them
+ Notes
+     see the notes in ES_Port.c for why this always returns true.
+     This is also where a stop request from SIGINT/SIGTERM is acted on.
+ Author
+     Drew Bell, 10/17/26 09:30
+****************************************************************************/
+bool _HW_Process_Pending_Ints( void )
+{
+  if (StopRequested)
+  {
+    ReportAndExit();
+  }
+  HarvestTicks();
+  if (pVars->TickCount > 0)
+  {
+    /* call the framework tick response to actually run the timers */
+    ES_Timer_Ticks_Resp(pVars->TickCount);
+    pVars->TickCount = 0;
+  }
+  return true; // always return true to allow loop test in ES_Run to proceed
+}
+
+/****************************************************************************
+ Function
+     _HW_Idle
+ Parameters
+     none
+ Returns
+     none.
+ Description
+     called from ES_Run when all of the queues are empty and no event checker
+     found anything. Blocks until the next tick or until a key arrives.
+     With ES_ENABLE_TICKLESS_IDLE, blocks until the next timer expiry (or
+     ES_TICKLESS_MAX_IDLE_TICKS) instead of the next tick.
+ Notes
+     EINTR is not an error, a signal simply ends the wait early.
+     The interrupt signals are blocked from the check of the queues until
+     the wait, which lets them in again, as PRIMASK and WFI do on the
+     target. So a post from a simulated interrupt that lands after ES_Run
+     found the queues empty either is seen by the check or ends the wait.
+ Author
+     Drew Bell, 10/17/26 09:30
+****************************************************************************/
+void _HW_Idle(void)
+{
+  sigset_t SavedMask;
+#ifdef ES_ENABLE_TICKLESS_IDLE
+  uint32_t IdleTicks;
+#endif
+
+  if (PendingKey != NO_KEY)
+  {
+    return; // a key is already waiting for the event checkers
+  }
+  pthread_sigmask(SIG_BLOCK, &IntSignals, &SavedMask);
+  if (ES_IsAnyServiceReady())
+  {
+    // a post came in since ES_Run looked, go back and process it
+    pthread_sigmask(SIG_SETMASK, &SavedMask, NULL);
+    return;
+  }
+#ifdef ES_ENABLE_TICKLESS_IDLE
+  IdleTicks = ES_Timer_GetTicksToNextExpiry();
+  if (IdleTicks > ES_TICKLESS_MAX_IDLE_TICKS)
+  {
+    IdleTicks = ES_TICKLESS_MAX_IDLE_TICKS;
+  }
+  if (IdleTicks >= 2)
+  {
+    HarvestTicks();
+    if (pVars->TickCount != 0)
+    {
+      pthread_sigmask(SIG_SETMASK, &SavedMask, NULL);
+      return; // a tick came in, go back and process it
+    }
+    ArmTick(TickBaseNs + IdleTicks * TickPeriodNs, 0);
+    WaitForWakeup(&SavedMask);
+    CreditSleep();
+    pthread_sigmask(SIG_SETMASK, &SavedMask, NULL);
+    return;
+  }
+#endif
+  WaitForWakeup(&SavedMask);
+  pthread_sigmask(SIG_SETMASK, &SavedMask, NULL);
+}
+
+/****************************************************************************
+ Function
+     kbhit
+ Parameters
+     none
+ Returns
+     int, non-zero if a character is waiting on stdin
+ Description
+     non-blocking test for a keystroke, stands in for the UART test in termio.c
+ Notes
+     the character is read here and held until _HW_GetNewKey collects it
+ Author
+     Drew Bell, 10/17/26 09:30
+****************************************************************************/
+int kbhit(void)
+{
+  struct pollfd Stdin = { STDIN_FILENO, POLLIN, 0 };
+  unsigned char NewKey;
+
+  if ((PendingKey == NO_KEY) && StdinOpen && (poll(&Stdin, 1, 0) > 0))
+  {
+    // readable (or hung up), so this read will not block
+    ssize_t NumRead = read(STDIN_FILENO, &NewKey, 1);
+    if (NumRead == 1)
+    {
+      PendingKey = NewKey;
+    }
+    else if (NumRead <= 0)
+    {
+      StdinOpen = false;
+      epoll_ctl(EpollFd, EPOLL_CTL_DEL, STDIN_FILENO, NULL);
+    }
+  }
+  return (PendingKey != NO_KEY);
+}
+
+/****************************************************************************
+ Function
+     _HW_GetNewKey
+ Parameters
+     none
+ Returns
+     int, the character collected by kbhit
+ Description
+     stands in for getchar() in the GetNewKey() macro
+ Notes
+     only call after kbhit() has returned non-zero
+ Author
+     Drew Bell, 10/17/26 09:30
+****************************************************************************/
+int _HW_GetNewKey(void)
+{
+  int NewKey = PendingKey;
+  PendingKey = NO_KEY;
+  return NewKey;
+}
+
+/****************************************************************************
+ Function
+     ConsoleInit
+ Parameters
+     none
+ Returns
+     none.
+ Description
+     nothing to do, stdin/stdout are already the console on the host
+ Author
+     Drew Bell, 10/17/26 09:30
+ ****************************************************************************/
+void ConsoleInit(void)
+{
+}
+
+/****************************************************************************
+ Function
+     _HW_EnterCritical / _HW_ExitCritical
+ Parameters
+     none
+ Returns
+     none.
+ Description
+     host versions of the PRIMASK save/restore behind EnterCritical() and
+     ExitCritical()
+ Author
+     Drew Bell, 10/17/26 09:30
+ ****************************************************************************/
+void _HW_EnterCritical(void)
+{
+  sigset_t SavedMask;
+
+  if (MaskInCritical)
+  {
+    pthread_sigmask(SIG_BLOCK, &IntSignals, &SavedMask);
+    if (CriticalDepth++ == 0)
+    {
+      CriticalSavedMask = SavedMask;
+    }
+  }
+  pthread_mutex_lock(&CriticalLock);
+}
+
+void _HW_ExitCritical(void)
+{
+  pthread_mutex_unlock(&CriticalLock);
+  if ((CriticalDepth != 0) && (--CriticalDepth == 0))
+  {
+    pthread_sigmask(SIG_SETMASK, &CriticalSavedMask, NULL);
+  }
+}
+
+/****************************************************************************
+ Function
+     _HW_SimInterruptStart
+ Parameters
+     uint32_t PeriodUs, the time between simulated interrupts
+     void (*pISR)(void), the interrupt response to call
+ Returns
+     none.
+ Description
+     starts a POSIX timer that sends SIGUSR1 to the calling thread every
+     PeriodUs, and calls pISR from its handler
+ Notes
+     call it from the thread that runs ES_Run, after ES_Initialize. pISR may
+     post with any of the post functions, like a real interrupt response
+     it must not call printf.
+ Author
+     Drew Bell, 10/17/26 19:00
+****************************************************************************/
+void _HW_SimInterruptStart(uint32_t PeriodUs, void (*pISR)(void))
+{
+  struct sigaction OnInt;
+  struct sigevent Event;
+  struct itimerspec Period;
+  timer_t SimTimer;
+
+  InitIntSignals();
+  pSimISR = pISR;
+  OnInt.sa_handler = SimIntHandler;
+  OnInt.sa_mask = IntSignals; // PendSV waits until the interrupt returns
+  OnInt.sa_flags = SA_RESTART;
+  sigaction(SIM_INT_SIGNAL, &OnInt, NULL);
+  MaskInCritical = true;
+
+  Event.sigev_notify = SIGEV_THREAD_ID;
+  Event.sigev_signo = SIM_INT_SIGNAL;
+  Event._sigev_un._tid = (pid_t)syscall(SYS_gettid);
+  if (timer_create(CLOCK_MONOTONIC, &Event, &SimTimer) != 0)
+  {
+    perror("ES_Port_POSIX: simulated interrupt");
+    exit(EXIT_FAILURE);
+  }
+  Period.it_value.tv_sec = PeriodUs / US_PER_SEC;
+  Period.it_value.tv_nsec = (PeriodUs % US_PER_SEC) * NS_PER_US;
+  Period.it_interval = Period.it_value;
+  timer_settime(SimTimer, 0, &Period, NULL);
+}
+
+#ifdef ES_ENABLE_PREEMPTION
+/****************************************************************************
+ Function
+     _HW_PreemptInit
+ Parameters
+     none
+ Returns
+     none.
+ Description
+     installs the PendSV signal handler and notes the thread that it is to
+     interrupt
+ Notes
+     called from ES_Initialize, so ES_Run must be called from the same
+     thread
+ Author
+     Drew Bell, 10/17/26 19:00
+****************************************************************************/
+void _HW_PreemptInit(void)
+{
+  struct sigaction OnPendSV;
+
+  InitIntSignals();
+  FrameworkThread = pthread_self();
+  OnPendSV.sa_handler = PendSVHandler;
+  OnPendSV.sa_mask = IntSignals; // ES_Activate is entered with ints off
+  OnPendSV.sa_flags = SA_RESTART;
+  sigaction(PENDSV_SIGNAL, &OnPendSV, NULL);
+  MaskInCritical = true;
+}
+
+/****************************************************************************
+ Function
+     _HW_DisableInts / _HW_EnableInts / _HW_PendScheduler
+ Parameters
+     none
+ Returns
+     none.
+ Description
+     host versions of __disable_irq, __enable_irq and setting PENDSVSET
+ Notes
+     signals do not queue, so like PendSV any number of pends before the
+     handler runs make one call to ES_Activate. A pend from another thread
+     arrives asynchronously, like one from an interrupt.
+ Author
+     Drew Bell, 10/17/26 19:00
+****************************************************************************/
+void _HW_DisableInts(void)
+{
+  pthread_sigmask(SIG_BLOCK, &IntSignals, NULL);
+}
+
+void _HW_EnableInts(void)
+{
+  pthread_sigmask(SIG_UNBLOCK, &IntSignals, NULL);
+}
+
+void _HW_PendScheduler(void)
+{
+  pthread_kill(FrameworkThread, PENDSV_SIGNAL);
+}
+#endif
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+/****************************************************************************
+ Function
+     InitIntSignals
+ Parameters
+     none
+ Returns
+     none.
+ Description
+     fills in the set of signals that stand in for interrupts
+ Author
+     Drew Bell, 10/17/26 19:00
+****************************************************************************/
+static void InitIntSignals( void )
+{
+  sigemptyset(&IntSignals);
+  sigaddset(&IntSignals, SIM_INT_SIGNAL);
+#ifdef ES_ENABLE_PREEMPTION
+  sigaddset(&IntSignals, PENDSV_SIGNAL);
+#endif
+}
+
+/****************************************************************************
+ Function
+     SimIntHandler
+ Parameters
+     int Signal, the signal that was caught
+ Returns
+     none.
+ Description
+     the simulated interrupt, calls the response set by
+     _HW_SimInterruptStart
+ Notes
+     errno is saved, since the response may make system calls through the
+     critical regions
+ Author
+     Drew Bell, 10/17/26 19:00
+****************************************************************************/
+static void SimIntHandler( int Signal )
+{
+  int SavedErrno = errno;
+
+  (void)Signal;
+  pSimISR();
+  errno = SavedErrno;
+}
+
+#ifdef ES_ENABLE_PREEMPTION
+/****************************************************************************
+ Function
+     PendSVHandler
+ Parameters
+     int Signal, the signal that was caught
+ Returns
+     none.
+ Description
+     runs ES_Activate on top of whatever the signal interrupted, the host
+     version of PendSVIntHandler
+ Notes
+     the handler is entered with the interrupt signals blocked, and the
+     mask is put back as it was when it returns
+ Author
+     Drew Bell, 10/17/26 19:00
+****************************************************************************/
+static void PendSVHandler( int Signal )
+{
+  int SavedErrno = errno;
+
+  (void)Signal;
+  ES_Activate();
+  errno = SavedErrno;
+}
+#endif
+
+/****************************************************************************
+ Function
+     HarvestTicks
+ Parameters
+     none
+ Returns
+     none.
+ Description
+     reads the number of expirations since the last read from the timerfd
+     and credits them to TickCount and SysTickCounter. This is the host
+     equivalent of SysTickIntHandler.
+ Notes
+     the timerfd is non-blocking, so this returns at once if no tick is due
+ Author
+     Drew Bell, 10/17/26 09:30
+****************************************************************************/
+static void HarvestTicks( void )
+{
+  uint64_t Expirations;
+
+  if ((TickFd >= 0) &&
+      (read(TickFd, &Expirations, sizeof(Expirations)) == sizeof(Expirations)))
+  {
+    pVars->TickCount += (uint32_t)Expirations;
+    pVars->SysTickCounter += (uint16_t)Expirations;
+    TotalTicks += (uint32_t)Expirations;
+    TickBaseNs += Expirations * TickPeriodNs;
+  }
+}
+
+#ifdef ES_ENABLE_TICKLESS_IDLE
+/****************************************************************************
+ Function
+     CreditSleep
+ Parameters
+     none
+ Returns
+     none.
+ Description
+     works out from the clock how many ticks passed during a tickless sleep,
+     credits them as HarvestTicks would have, and puts the timerfd back to
+     the periodic tick on the original phase
+ Notes
+     re-arming the timerfd throws away the one-shot expiration, and a tick
+     boundary that has already passed expires at once
+ Author
+     Drew Bell, 10/17/26 12:30
+****************************************************************************/
+static void CreditSleep( void )
+{
+  uint32_t Elapsed = (uint32_t)((NowNs() - TickBaseNs) / TickPeriodNs);
+
+  pVars->TickCount += Elapsed;
+  pVars->SysTickCounter += (uint16_t)Elapsed;
+  TotalTicks += Elapsed;
+  TickBaseNs += Elapsed * TickPeriodNs;
+  ArmTick(TickBaseNs + TickPeriodNs, TickPeriodNs);
+}
+#endif
+
+/****************************************************************************
+ Function
+     NowNs
+ Parameters
+     none
+ Returns
+     uint64_t, CLOCK_MONOTONIC in nanoseconds
+ Description
+     the time base for the tick
+ Author
+     Drew Bell, 10/17/26 12:30
+****************************************************************************/
+static uint64_t NowNs( void )
+{
+  struct timespec Now;
+
+  clock_gettime(CLOCK_MONOTONIC, &Now);
+  return (uint64_t)Now.tv_sec * NS_PER_SEC + Now.tv_nsec;
+}
+
+#ifndef ES_VIRTUAL_TIME
+/****************************************************************************
+ Function
+     ArmTick
+ Parameters
+     uint64_t FirstNs, the absolute time of the first expiration
+     uint64_t PeriodNs, the time between expirations after that, 0 for a
+        one-shot
+ Returns
+     none.
+ Description
+     (re)programs the timerfd
+ Author
+     Drew Bell, 10/17/26 12:30
+****************************************************************************/
+static void ArmTick( uint64_t FirstNs, uint64_t PeriodNs )
+{
+  struct itimerspec TickSpec;
+
+  TickSpec.it_value.tv_sec = FirstNs / NS_PER_SEC;
+  TickSpec.it_value.tv_nsec = FirstNs % NS_PER_SEC;
+  TickSpec.it_interval.tv_sec = PeriodNs / NS_PER_SEC;
+  TickSpec.it_interval.tv_nsec = PeriodNs % NS_PER_SEC;
+  timerfd_settime(TickFd, TFD_TIMER_ABSTIME, &TickSpec, NULL);
+}
+#endif
+
+/****************************************************************************
+ Function
+     WaitForWakeup
+ Parameters
+     sigset_t const * pWaitMask, the signal mask to wait with
+ Returns
+     none.
+ Description
+     blocks until the timerfd expires, a key arrives or a signal comes in
+ Notes
+     the mask is only in place for the wait, so signals that were blocked
+     before it are let in, and end it, without a gap ahead of it
+ Author
+     Drew Bell, 10/17/26 12:30
+****************************************************************************/
+static void WaitForWakeup( sigset_t const * pWaitMask )
+{
+  struct epoll_event Fired;
+
+  epoll_pwait(EpollFd, &Fired, 1, -1, pWaitMask);
+  IdleWakeups++;
+}
+
+#ifndef ES_VIRTUAL_TIME
+/****************************************************************************
+ Function
+     StopHandler
+ Parameters
+     int Signal, the signal that was caught
+ Returns
+     none.
+ Description
+     notes that SIGINT or SIGTERM arrived, the report is printed from
+     _HW_Process_Pending_Ints where it is safe to call printf
+ Author
+     Drew Bell, 10/17/26 12:30
+****************************************************************************/
+static void StopHandler( int Signal )
+{
+  (void)Signal;
+  StopRequested = 1;
+}
+#endif
+
+/****************************************************************************
+ Function
+     ReportAndExit
+ Parameters
+     none
+ Returns
+     does not return
+ Description
+     prints how much CPU time the process used against how long it ran and
+     how often it woke up from idle, then exits
+ Author
+     Drew Bell, 10/17/26 12:30
+****************************************************************************/
+static void ReportAndExit( void )
+{
+  struct rusage Usage;
+  double RunTime = (NowNs() - StartNs) / (double)NS_PER_SEC;
+
+  getrusage(RUSAGE_SELF, &Usage);
+  printf("\nES_Port_POSIX: ran %.3f s, CPU user %.3f s sys %.3f s\n",
+         RunTime,
+         Usage.ru_utime.tv_sec + Usage.ru_utime.tv_usec / (double)US_PER_SEC,
+         Usage.ru_stime.tv_sec + Usage.ru_stime.tv_usec / (double)US_PER_SEC);
+  printf("ES_Port_POSIX: %lu ticks, %lu idle wakeups\n",
+         (unsigned long)TotalTicks, (unsigned long)IdleWakeups);
+  exit(EXIT_SUCCESS);
+}
+/*------------------------------- Footnotes -------------------------------*/
+/*------------------------------ End of file ------------------------------*/
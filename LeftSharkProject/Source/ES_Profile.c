@@ -0,0 +1,315 @@
+/****************************************************************************
+ Module
+     ES_Profile.c
+
+ Description
+     This module collects, for every service, how long its run function takes
+     and how long events wait in its queue before they are dispatched.
+
+ Notes
+     The post functions in ES_Framework.c stamp each event with the time that
+     it was posted. When ES_Run takes the event off the queue the difference
+     is added to the QueueWait stats and the call to the run function is
+     timed into the RunTime stats. Each set of stats keeps the count, min,
+     max, total (for the mean) and a log2 histogram of the samples.
+
+     The stats are only written from ES_Run, so they should be read from the
+     services or the event checkers, not from an interrupt response.
+
+     The whole module compiles to nothing unless ES_ENABLE_PROFILING is
+     defined in ES_Configure.h
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/17/26 19:00 afb      keep a start time per service for ES_ENABLE_PREEMPTION
+ 10/17/26 11:30 afb      Began Coding
+****************************************************************************/
+
+/*----------------------------- Include Files -----------------------------*/
+#include "ES_Configure.h"
+#include "ES_Profile.h"
+
+#ifdef ES_ENABLE_PROFILING
+
+#include <stdio.h>
+#include <string.h>
+#include "ES_General.h"
+#include "ES_LookupTables.h"
+
+/*--------------------------- External Variables --------------------------*/
+
+/*----------------------------- Module Defines ----------------------------*/
+#define NO_SAMPLES_YET 0xFFFFFFFFUL
+
+/*------------------------------ Module Types -----------------------------*/
+
+/*---------------------------- Module Functions ---------------------------*/
+static void AddSample( ES_ProfileStats_t * pStats, uint32_t Sample );
+static uint8_t Log2Bin( uint32_t Sample );
+static void PrintStats( char const * pName, ES_ProfileStats_t const * pStats );
+
+/*---------------------------- Module Variables ---------------------------*/
+static ES_ServiceProfile_t Profiles[NUM_SERVICES];
+
+// time stamps taken just before each service's run function was called,
+// one each since a run may be preempted by another service's
+static uint32_t RunStart[NUM_SERVICES];
+
+// the run function names, for the report
+#define ES_SERV_NAME( Init, Run, QueueSize, BurstLimit, RunBatch ) #Run,
+
+static char const * const ServiceNames[NUM_SERVICES] = {
+  SERVICE_LIST(ES_SERV_NAME)
+};
+
+/*------------------------------ Module Code ------------------------------*/
+/****************************************************************************
+ Function
+     ES_Profile_Init
+ Parameters
+     none
+ Returns
+     none
+ Description
+     starts the cycle counter and clears the stats
+ Notes
+     called from ES_Initialize
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+void ES_Profile_Init( void ){
+  _HW_CycleCounterInit();
+  ES_Profile_Reset();
+}
+
+/****************************************************************************
+ Function
+     ES_Profile_Reset
+ Parameters
+     none
+ Returns
+     none
+ Description
+     clears the stats for all services, to start a new measurement
+ Notes
+
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+void ES_Profile_Reset( void ){
+  uint16_t i;
+
+  memset(Profiles, 0, sizeof(Profiles));
+  for ( i = 0; i < ARRAY_SIZE(Profiles); i++ ){
+    Profiles[i].RunTime.Min = NO_SAMPLES_YET;
+    Profiles[i].QueueWait.Min = NO_SAMPLES_YET;
+  }
+}
+
+/****************************************************************************
+ Function
+     ES_Profile_GetService
+ Parameters
+     uint8_t WhichService, the service to report on (index into SERVICE_LIST)
+     ES_ServiceProfile_t * pProfile, where to copy the stats to
+ Returns
+     bool, false if WhichService is not a valid service number
+ Description
+     copies out the run time and queue wait stats for one service
+ Notes
+
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+bool ES_Profile_GetService( uint8_t WhichService,
+                            ES_ServiceProfile_t * pProfile ){
+  if ( WhichService >= ARRAY_SIZE(Profiles) ){
+    return false;
+  }
+  *pProfile = Profiles[WhichService];
+  return true;
+}
+
+/****************************************************************************
+ Function
+     ES_Profile_Mean
+ Parameters
+     ES_ProfileStats_t const * pStats, the stats to average
+ Returns
+     uint32_t, the mean of the samples, 0 if there were none
+ Description
+     works out the mean from the total and count
+ Notes
+
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+uint32_t ES_Profile_Mean( ES_ProfileStats_t const * pStats ){
+  if ( pStats->Count == 0 ){
+    return 0;
+  }
+  return (uint32_t)(pStats->Total / pStats->Count);
+}
+
+/****************************************************************************
+ Function
+     ES_Profile_Print
+ Parameters
+     none
+ Returns
+     none
+ Description
+     prints the stats for every service that has run since the last reset
+ Notes
+     printf is slow, call this from a service that can afford it (for
+     example in response to a keystroke)
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+void ES_Profile_Print( void ){
+  uint16_t i;
+
+  printf("\n\rservice profile, times in %s\n\r", ES_CYCLE_COUNT_UNITS);
+  for ( i = 0; i < ARRAY_SIZE(Profiles); i++ ){
+    if ( Profiles[i].RunTime.Count != 0 ){
+      printf("%u %s\n\r", i, ServiceNames[i]);
+      PrintStats("run time", &Profiles[i].RunTime);
+      PrintStats("queue wait", &Profiles[i].QueueWait);
+    }
+  }
+}
+
+/****************************************************************************
+ Function
+     ES_Profile_Dequeued
+ Parameters
+     uint8_t WhichService, the service that the event was taken off the
+        queue for
+     ES_Event const * pEvent, the event, with its post time stamp
+ Returns
+     none
+ Description
+     records how long the event waited in the queue
+ Notes
+     called by ES_Run through ES_PROFILE_DEQUEUED
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+void ES_Profile_Dequeued( uint8_t WhichService, ES_Event const * pEvent ){
+  AddSample( &Profiles[WhichService].QueueWait,
+             _HW_GetCycleCount() - pEvent->PostStamp );
+}
+
+/****************************************************************************
+ Function
+     ES_Profile_RunBegin / ES_Profile_RunEnd
+ Parameters
+     uint8_t WhichService, the service whose run function is being timed
+ Returns
+     none
+ Description
+     time the call to a run function
+ Notes
+     called by ES_Run through ES_PROFILE_RUN_BEGIN & ES_PROFILE_RUN_END.
+     With ES_ENABLE_PREEMPTION the time includes any higher priority
+     services that ran in the middle.
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+void ES_Profile_RunBegin( uint8_t WhichService ){
+  RunStart[WhichService] = _HW_GetCycleCount();
+}
+
+void ES_Profile_RunEnd( uint8_t WhichService ){
+  AddSample( &Profiles[WhichService].RunTime,
+             _HW_GetCycleCount() - RunStart[WhichService] );
+}
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+/****************************************************************************
+ Function
+     AddSample
+ Parameters
+     ES_ProfileStats_t * pStats, the stats to add to
+     uint32_t Sample, the new time
+ Returns
+     none
+ Description
+     folds one sample into the count, min, max, total and histogram
+ Notes
+
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+static void AddSample( ES_ProfileStats_t * pStats, uint32_t Sample ){
+  pStats->Count++;
+  pStats->Total += Sample;
+  if ( Sample < pStats->Min ){
+    pStats->Min = Sample;
+  }
+  if ( Sample > pStats->Max ){
+    pStats->Max = Sample;
+  }
+  pStats->Histogram[Log2Bin(Sample)]++;
+}
+
+/****************************************************************************
+ Function
+     Log2Bin
+ Parameters
+     uint32_t Sample, the time to bin
+ Returns
+     uint8_t, the number of the most significant bit set in Sample, 0 for 0
+ Description
+     picks the histogram bin, using ES_GetMSBitSet on each half
+ Notes
+
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+static uint8_t Log2Bin( uint32_t Sample ){
+  if ( (Sample >> 16) != 0 ){
+    return (uint8_t)(16 + ES_GetMSBitSet( (uint16_t)(Sample >> 16) ));
+  }
+  if ( Sample == 0 ){
+    return 0;
+  }
+  return ES_GetMSBitSet( (uint16_t)Sample );
+}
+
+/****************************************************************************
+ Function
+     PrintStats
+ Parameters
+     char const * pName, label for the line
+     ES_ProfileStats_t const * pStats, the stats to print
+ Returns
+     none
+ Description
+     prints the summary line and the non-empty histogram bins
+ Notes
+
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+static void PrintStats( char const * pName, ES_ProfileStats_t const * pStats ){
+  uint8_t Bin;
+
+  printf("  %-10s n=%lu min=%lu mean=%lu max=%lu\n\r", pName,
+         (unsigned long)pStats->Count, (unsigned long)pStats->Min,
+         (unsigned long)ES_Profile_Mean(pStats),
+         (unsigned long)pStats->Max);
+  for ( Bin = 0; Bin < ES_PROFILE_NUM_BINS; Bin++ ){
+    if ( pStats->Histogram[Bin] != 0 ){
+      printf("    < 2^%-2u : %lu\n\r", Bin + 1,
+             (unsigned long)pStats->Histogram[Bin]);
+    }
+  }
+}
+
+#endif /* ES_ENABLE_PROFILING */
+/*------------------------------- Footnotes -------------------------------*/
+/*------------------------------ End of file ------------------------------*/
@@ -9,6 +9,13 @@
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/17/26 18:30 afb      added ES_RingQueuePeek & ES_SPSCQueuePeek for EDF
+ 10/17/26 16:30 afb      added the ring queues and a host benchmark of them
+                         against the in-block queues
+ 10/17/26 16:00 afb      added the single producer/single consumer queues and
+                         a host stress test for them
+ 10/17/26 12:00 afb      added ES_QueueDepth for the queue stats
+ 10/17/26 11:00 afb      added ES_DeQueueBlock for burst dispatch
  01/15/12 09:34 jec      converted to use the new C99 types from types.h
  08/09/11 18:16 jec      started coding
 *****************************************************************************/
@@ -31,6 +38,15 @@ typedef struct {  uint8_t QueueSize;
 
 typedef ES_Queue_t * pQueue_t;
 
+// the slot Offset places on from the slot Index of a ring queue. Index and
+// Offset are both below Size, so one subtract is enough without the mask.
+#define RING_SLOT( pQueue, Index, Offset ) \
+  ( ((pQueue)->Mask != 0) ? \
+      (uint16_t)(((uint32_t)(Index) + (Offset)) & (pQueue)->Mask) : \
+      (uint16_t)((((uint32_t)(Index) + (Offset)) >= (pQueue)->Size) ? \
+        ((uint32_t)(Index) + (Offset)) - (pQueue)->Size : \
+        ((uint32_t)(Index) + (Offset))) )
+
 /*---------------------------- Module Functions ---------------------------*/
 
 /*---------------------------- Module Variables ---------------------------*/
@@ -185,6 +201,48 @@ uint8_t ES_DeQueue( ES_Event * pBlock, ES_Event * pReturnEvent )
    return NumLeft;
 }
 
+/****************************************************************************
+ Function
+   ES_DeQueueBlock
+ Parameters
+   ES_Event * pBlock : pointer to the block of memory in use as the Queue
+   ES_Event * pDest : array to copy the events pulled from the queue into
+   uint8_t MaxEvents : the most events to pull (the size of pDest)
+   uint8_t * pNumTaken : used to return the number of events copied to pDest
+ Returns
+   The number of entries remaining in the Queue
+ Description
+   pulls up to MaxEvents entries from the Queue, in order, into the
+   contiguous array pDest
+ Notes
+   interrupts are only disabled once for the whole block, which is the point
+   of the burst dispatch in ES_Run
+ Author
+   Drew Bell, 10/17/26, 11:00
+****************************************************************************/
+uint8_t ES_DeQueueBlock( ES_Event * pBlock, ES_Event * pDest, 
+                         uint8_t MaxEvents, uint8_t * pNumTaken )
+{
+   pQueue_t pThisQueue;
+   uint8_t NumTaken = 0;
+   uint8_t NumLeft;
+
+   pThisQueue = (pQueue_t)pBlock;
+   EnterCritical();   // save interrupt state, turn ints off
+   while ( (NumTaken < MaxEvents) && (pThisQueue->NumEntries > 0) )
+   {
+      pDest[NumTaken++] = pBlock[ 1 + pThisQueue->CurrentIndex ];
+      pThisQueue->CurrentIndex++;
+      if (pThisQueue->CurrentIndex >= pThisQueue->QueueSize)
+         pThisQueue->CurrentIndex = 0;
+      pThisQueue->NumEntries--;
+   }
+   NumLeft = pThisQueue->NumEntries;
+   ExitCritical();  // restore saved interrupt state
+   *pNumTaken = NumTaken;
+   return NumLeft;
+}
+
 /****************************************************************************
  Function
    ES_IsQueueEmpty
@@ -207,6 +265,393 @@ bool ES_IsQueueEmpty( ES_Event * pBlock )
    return(pThisQueue->NumEntries == 0);
 }
 
+/****************************************************************************
+ Function
+   ES_QueueDepth
+ Parameters
+   ES_Event * pBlock : pointer to the block of memory in use as the Queue
+ Returns
+   uint8_t : the number of entries in the Queue
+ Description
+   see above
+ Notes
+
+ Author
+   Drew Bell, 10/17/26, 12:00
+****************************************************************************/
+uint8_t ES_QueueDepth( ES_Event * pBlock )
+{
+   pQueue_t pThisQueue;
+
+   pThisQueue = (pQueue_t)pBlock;
+   return(pThisQueue->NumEntries);
+}
+
+/****************************************************************************
+ Function
+   ES_InitRingQueue
+ Parameters
+   ES_RingQueue_t * pQueue : the queue to set up
+   ES_Event * pSlots : the array of events to hold the entries
+   uint16_t NumSlots : the number of events in pSlots, 1 to 65535
+ Returns
+   nothing
+ Description
+   sets up an empty ring queue, using the mask to wrap if NumSlots is a
+   power of two
+ Notes
+
+ Author
+   Drew Bell, 10/17/26, 16:30
+****************************************************************************/
+void ES_InitRingQueue( ES_RingQueue_t * pQueue, ES_Event * pSlots,
+                       uint16_t NumSlots )
+{
+   pQueue->pSlots = pSlots;
+   pQueue->Size = NumSlots;
+   if ( (NumSlots > 1) && ((NumSlots & (NumSlots - 1)) == 0) )
+      pQueue->Mask = NumSlots - 1;
+   else
+      pQueue->Mask = 0;
+   pQueue->Head = 0;
+   pQueue->NumEntries = 0;
+}
+
+/****************************************************************************
+ Function
+   ES_RingEnQueueFIFO
+ Parameters
+   ES_RingQueue_t * pQueue : the queue to add to
+   ES_Event Event2Add : event to be added to the Queue
+ Returns
+   bool : true if the add was successful, false if not
+ Description
+   if it will fit, adds Event2Add to the end of the Queue
+ Notes
+   the test for space is made with interrupts off as well, so two posters
+   can not both take the last slot
+ Author
+   Drew Bell, 10/17/26, 16:30
+****************************************************************************/
+bool ES_RingEnQueueFIFO( ES_RingQueue_t * pQueue, ES_Event Event2Add )
+{
+   bool Added = false;
+
+   EnterCritical();   // save interrupt state, turn ints off
+   if ( pQueue->NumEntries < pQueue->Size )
+   {
+      pQueue->pSlots[ RING_SLOT( pQueue, pQueue->Head,
+                                 pQueue->NumEntries ) ] = Event2Add;
+      pQueue->NumEntries++;
+      Added = true;
+   }
+   ExitCritical();  // restore saved interrupt state
+   return(Added);
+}
+
+/****************************************************************************
+ Function
+   ES_RingEnQueueLIFO
+ Parameters
+   ES_RingQueue_t * pQueue : the queue to add to
+   ES_Event Event2Add : event to be added to the Queue
+ Returns
+   bool : true if the add was successful, false if not
+ Description
+   if it will fit, adds Event2Add at the extraction point, making it the
+   next event to be removed
+ Notes
+
+ Author
+   Drew Bell, 10/17/26, 16:30
+****************************************************************************/
+bool ES_RingEnQueueLIFO( ES_RingQueue_t * pQueue, ES_Event Event2Add )
+{
+   bool Added = false;
+
+   EnterCritical();   // save interrupt state, turn ints off
+   if ( pQueue->NumEntries < pQueue->Size )
+   {
+      // back up Head by one, which is on by Size-1
+      pQueue->Head = RING_SLOT( pQueue, pQueue->Head, pQueue->Size - 1 );
+      pQueue->pSlots[ pQueue->Head ] = Event2Add;
+      pQueue->NumEntries++;
+      Added = true;
+   }
+   ExitCritical();  // restore saved interrupt state
+   return(Added);
+}
+
+/****************************************************************************
+ Function
+   ES_RingDeQueue
+ Parameters
+   ES_RingQueue_t * pQueue : the queue to take from
+   ES_Event * pReturnEvent : used to return the event pulled from the queue
+ Returns
+   The number of entries remaining in the Queue
+ Description
+   pulls the next entry from the Queue into *pReturnEvent, ES_NO_EVENT if
+   the Queue was empty
+ Notes
+
+ Author
+   Drew Bell, 10/17/26, 16:30
+****************************************************************************/
+uint16_t ES_RingDeQueue( ES_RingQueue_t * pQueue, ES_Event * pReturnEvent )
+{
+   uint16_t NumLeft = 0;
+
+   EnterCritical();   // save interrupt state, turn ints off
+   if ( pQueue->NumEntries > 0 )
+   {
+      *pReturnEvent = pQueue->pSlots[ pQueue->Head ];
+      pQueue->Head = RING_SLOT( pQueue, pQueue->Head, 1 );
+      NumLeft = --pQueue->NumEntries;
+   }else
+   {
+      (*pReturnEvent).EventType = ES_NO_EVENT;
+      (*pReturnEvent).EventParam = 0;
+   }
+   ExitCritical();  // restore saved interrupt state
+   return NumLeft;
+}
+
+/****************************************************************************
+ Function
+   ES_RingDeQueueBlock
+ Parameters
+   ES_RingQueue_t * pQueue : the queue to take from
+   ES_Event * pDest : array to copy the events pulled from the queue into
+   uint16_t MaxEvents : the most events to pull (the size of pDest)
+   uint16_t * pNumTaken : used to return the number of events copied
+ Returns
+   The number of entries remaining in the Queue
+ Description
+   pulls up to MaxEvents entries from the Queue, in order, into pDest. If
+   the queue was empty, pDest[0] is set to ES_NO_EVENT.
+ Notes
+   interrupts are only disabled once for the whole block
+ Author
+   Drew Bell, 10/17/26, 16:30
+****************************************************************************/
+uint16_t ES_RingDeQueueBlock( ES_RingQueue_t * pQueue, ES_Event * pDest,
+                              uint16_t MaxEvents, uint16_t * pNumTaken )
+{
+   uint16_t NumTaken = 0;
+   uint16_t NumLeft;
+
+   EnterCritical();   // save interrupt state, turn ints off
+   while ( (NumTaken < MaxEvents) && (pQueue->NumEntries > 0) )
+   {
+      pDest[NumTaken++] = pQueue->pSlots[ pQueue->Head ];
+      pQueue->Head = RING_SLOT( pQueue, pQueue->Head, 1 );
+      pQueue->NumEntries--;
+   }
+   NumLeft = pQueue->NumEntries;
+   ExitCritical();  // restore saved interrupt state
+   if ( (NumTaken == 0) && (MaxEvents > 0) )
+   {
+      pDest[0].EventType = ES_NO_EVENT;
+      pDest[0].EventParam = 0;
+   }
+   *pNumTaken = NumTaken;
+   return NumLeft;
+}
+
+/****************************************************************************
+ Function
+   ES_IsRingQueueEmpty / ES_RingQueueDepth
+ Parameters
+   ES_RingQueue_t const * pQueue : the queue
+ Returns
+   bool : true if Queue is empty
+   uint16_t : the number of entries in the Queue
+ Description
+   see above
+ Notes
+
+ Author
+   Drew Bell, 10/17/26, 16:30
+****************************************************************************/
+bool ES_IsRingQueueEmpty( ES_RingQueue_t const * pQueue )
+{
+   return(pQueue->NumEntries == 0);
+}
+
+uint16_t ES_RingQueueDepth( ES_RingQueue_t const * pQueue )
+{
+   return(pQueue->NumEntries);
+}
+
+/****************************************************************************
+ Function
+   ES_RingQueuePeek
+ Parameters
+   ES_RingQueue_t * pQueue : the queue to look at
+   ES_Event * pReturnEvent : used to return a copy of the next event
+ Returns
+   bool : false if the Queue was empty
+ Description
+   copies the event that the next ES_RingDeQueue would take, and leaves it
+   in the Queue
+ Notes
+   interrupts are off for the copy, since the LIFO posts move Head
+ Author
+   Drew Bell, 10/17/26, 18:30
+****************************************************************************/
+bool ES_RingQueuePeek( ES_RingQueue_t * pQueue, ES_Event * pReturnEvent )
+{
+   bool NotEmpty;
+
+   EnterCritical();
+   NotEmpty = (pQueue->NumEntries != 0);
+   if ( NotEmpty ){
+      *pReturnEvent = pQueue->pSlots[ pQueue->Head ];
+   }
+   ExitCritical();
+   return(NotEmpty);
+}
+
+/****************************************************************************
+ Function
+   ES_InitSPSCQueue
+ Parameters
+   ES_SPSCQueue_t * pQueue : the queue to set up
+   ES_Event * pSlots : the array of events to hold the entries
+   uint16_t NumSlots : the number of events in pSlots, a power of two
+ Returns
+   bool : false if NumSlots is not a power of two
+ Description
+   sets up an empty single producer/single consumer queue
+ Notes
+   unlike ES_InitQueue there is no header in the block, all of the slots
+   are used
+ Author
+   Drew Bell, 10/17/26, 16:00
+****************************************************************************/
+bool ES_InitSPSCQueue( ES_SPSCQueue_t * pQueue, ES_Event * pSlots,
+                       uint16_t NumSlots )
+{
+   if ( (NumSlots == 0) || ((NumSlots & (NumSlots - 1)) != 0) )
+      return(false);
+   pQueue->pSlots = pSlots;
+   pQueue->Mask = NumSlots - 1;
+   _HW_AtomicStore16( &pQueue->Head, 0 );
+   _HW_AtomicStore16( &pQueue->Tail, 0 );
+   return(true);
+}
+
+/****************************************************************************
+ Function
+   ES_SPSCEnQueue
+ Parameters
+   ES_SPSCQueue_t * pQueue : the queue to add to
+   ES_Event Event2Add : event to be added to the Queue
+ Returns
+   bool : true if the add was successful, false if the queue was full
+ Description
+   if it will fit, adds Event2Add to the end of the Queue
+ Notes
+   only the producer may call this. It never turns interrupts off: the slot
+   is written before Tail is moved on past it, so the consumer can not see
+   the event until it is complete.
+ Author
+   Drew Bell, 10/17/26, 16:00
+****************************************************************************/
+bool ES_SPSCEnQueue( ES_SPSCQueue_t * pQueue, ES_Event Event2Add )
+{
+   uint16_t Tail = _HW_AtomicLoad16( &pQueue->Tail );
+
+   if ( (uint16_t)(Tail - _HW_AtomicLoad16( &pQueue->Head )) > pQueue->Mask )
+      return(false);
+   pQueue->pSlots[ Tail & pQueue->Mask ] = Event2Add;
+   _HW_AtomicStore16( &pQueue->Tail, (uint16_t)(Tail + 1) );
+   return(true);
+}
+
+/****************************************************************************
+ Function
+   ES_SPSCDeQueue
+ Parameters
+   ES_SPSCQueue_t * pQueue : the queue to take from
+   ES_Event * pReturnEvent : used to return the event pulled from the queue
+ Returns
+   The number of entries remaining in the Queue
+ Description
+   pulls the next entry from the Queue into *pReturnEvent, ES_NO_EVENT if
+   the Queue was empty
+ Notes
+   only the consumer may call this. The slot is copied out before Head is
+   moved on, so the producer can not overwrite it while it is being read.
+ Author
+   Drew Bell, 10/17/26, 16:00
+****************************************************************************/
+uint16_t ES_SPSCDeQueue( ES_SPSCQueue_t * pQueue, ES_Event * pReturnEvent )
+{
+   uint16_t Head = _HW_AtomicLoad16( &pQueue->Head );
+   uint16_t Tail = _HW_AtomicLoad16( &pQueue->Tail );
+
+   if ( Head == Tail ){
+      (*pReturnEvent).EventType = ES_NO_EVENT;
+      (*pReturnEvent).EventParam = 0;
+      return 0;
+   }
+   *pReturnEvent = pQueue->pSlots[ Head & pQueue->Mask ];
+   Head++;
+   _HW_AtomicStore16( &pQueue->Head, Head );
+   return (uint16_t)(Tail - Head);
+}
+
+/****************************************************************************
+ Function
+   ES_SPSCQueueDepth
+ Parameters
+   ES_SPSCQueue_t * pQueue : the queue
+ Returns
+   uint16_t : the number of entries in the Queue
+ Description
+   see above
+ Notes
+   may be called by either side, the answer may be out of date by the time
+   that it is used
+ Author
+   Drew Bell, 10/17/26, 16:00
+****************************************************************************/
+uint16_t ES_SPSCQueueDepth( ES_SPSCQueue_t * pQueue )
+{
+   uint16_t Head = _HW_AtomicLoad16( &pQueue->Head );
+
+   return (uint16_t)(_HW_AtomicLoad16( &pQueue->Tail ) - Head);
+}
+
+/****************************************************************************
+ Function
+   ES_SPSCQueuePeek
+ Parameters
+   ES_SPSCQueue_t * pQueue : the queue to look at
+   ES_Event * pReturnEvent : used to return a copy of the next event
+ Returns
+   bool : false if the Queue was empty
+ Description
+   copies the event that the next ES_SPSCDeQueue would take, and leaves it
+   in the Queue
+ Notes
+   only the consumer may call this, the producer never writes a slot that
+   has not been taken
+ Author
+   Drew Bell, 10/17/26, 18:30
+****************************************************************************/
+bool ES_SPSCQueuePeek( ES_SPSCQueue_t * pQueue, ES_Event * pReturnEvent )
+{
+   uint16_t Head = _HW_AtomicLoad16( &pQueue->Head );
+
+   if ( Head == _HW_AtomicLoad16( &pQueue->Tail ) )
+      return(false);
+   *pReturnEvent = pQueue->pSlots[ Head & pQueue->Mask ];
+   return(true);
+}
+
 #if 0
 /****************************************************************************
  Function
@@ -238,7 +683,7 @@ void QueueFlushQueue( uint8_t * pBlock )
 /***************************************************************************
  private functions
  ***************************************************************************/
-#ifdef TEST
+#if defined(TEST) && !defined(ES_PORT_POSIX)
 
 #include <stdio.h>
 #include "ES_General.h"
@@ -304,6 +749,167 @@ void main(void){
     ;
 }
 
+#endif
+
+#if defined(TEST) && defined(ES_PORT_POSIX)
+/* benchmark and stress test for the queues, runs on the host. With TEST
+   defined at the top of this file:
+   gcc -std=gnu11 -O2 -DES_PORT_POSIX -IHeaders Source/ES_Queue.c
+       -lpthread -o queue_test
+
+   The benchmark times a FIFO post and a take, with the queue kept half
+   full so that the indices keep wrapping, for the in-block queues and the
+   ring queues at a power of two size and at sizes that are not. The
+   critical regions are empty here, so it compares the indexing alone.
+
+   For the stress test, a producer thread stands in for an interrupt response. It posts
+   TEST_EVENTS numbered events, retrying when the queue is full, and sets a
+   ready bit after each one the way ES_PostToServiceISR does. The main
+   thread stands in for ES_Run: it only looks at the queue while the ready
+   bit is set, and clears it with the same re-check as ES_Run. Any lost,
+   repeated or re-ordered event, or a ready bit lost with events still in
+   the queue, fails the test.
+*/
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#define TEST_EVENTS 5000000UL
+#define TEST_SLOTS 16
+#define READY_BIT 0x0040
+
+#define BENCH_ROUNDS 20000000UL
+#define BENCH_MAX_SIZE 200
+
+static ES_Event BenchBlock[BENCH_MAX_SIZE + 1];
+static ES_Event BenchSlots[BENCH_MAX_SIZE];
+static volatile uint16_t BenchSink;
+
+static ES_Event TestSlots[TEST_SLOTS];
+static ES_SPSCQueue_t TestQueue;
+static ES_Atomic16_t TestReady;
+static unsigned long NumFull;
+
+// nothing here uses the critical regions, but the queue code links to them
+void _HW_EnterCritical(void) {}
+void _HW_ExitCritical(void) {}
+
+static void * Producer( void * pArg )
+{
+   ES_Event NewEvent;
+   unsigned long Num;
+
+   (void)pArg;
+   NewEvent.EventType = ES_NEW_KEY;
+   for ( Num = 0; Num < TEST_EVENTS; Num++ ){
+      NewEvent.EventParam = (uint16_t)Num;
+      while ( !ES_SPSCEnQueue( &TestQueue, NewEvent ) ){
+         NumFull++;
+         sched_yield(); // let the consumer in on a single core host
+      }
+      _HW_AtomicSetBits16( &TestReady, READY_BIT );
+   }
+   return NULL;
+}
+
+static double Seconds( void )
+{
+   struct timespec Now;
+
+   clock_gettime( CLOCK_MONOTONIC, &Now );
+   return Now.tv_sec + Now.tv_nsec * 1e-9;
+}
+
+static void Benchmark( uint8_t Size )
+{
+   ES_RingQueue_t Ring;
+   ES_Event ThisEvent;
+   unsigned long Round;
+   double Start, BlockNs, RingNs;
+
+   ThisEvent.EventType = ES_NEW_KEY;
+   ThisEvent.EventParam = 0;
+
+   ES_InitQueue( BenchBlock, Size + 1 );
+   for ( Round = 0; Round < Size / 2; Round++ )
+      ES_EnQueueFIFO( BenchBlock, ThisEvent );
+   Start = Seconds();
+   for ( Round = 0; Round < BENCH_ROUNDS; Round++ ){
+      ThisEvent.EventParam = (uint16_t)Round;
+      ES_EnQueueFIFO( BenchBlock, ThisEvent );
+      ES_DeQueue( BenchBlock, &ThisEvent );
+      BenchSink = ThisEvent.EventParam;
+   }
+   BlockNs = (Seconds() - Start) * 1e9 / BENCH_ROUNDS;
+
+   ES_InitRingQueue( &Ring, BenchSlots, Size );
+   for ( Round = 0; Round < Size / 2; Round++ )
+      ES_RingEnQueueFIFO( &Ring, ThisEvent );
+   Start = Seconds();
+   for ( Round = 0; Round < BENCH_ROUNDS; Round++ ){
+      ThisEvent.EventParam = (uint16_t)Round;
+      ES_RingEnQueueFIFO( &Ring, ThisEvent );
+      ES_RingDeQueue( &Ring, &ThisEvent );
+      BenchSink = ThisEvent.EventParam;
+   }
+   RingNs = (Seconds() - Start) * 1e9 / BENCH_ROUNDS;
+
+   printf("size %3u%s: in-block %5.2f ns, ring %5.2f ns per post & take\n",
+          Size, (Ring.Mask != 0) ? " (mask)" : "       ", BlockNs, RingNs);
+}
+
+static int StressTest( void )
+{
+   pthread_t Thread;
+   ES_Event ThisEvent;
+   unsigned long NumTaken = 0;
+   unsigned long NumWrong = 0;
+   double Start = Seconds();
+   double LastProgress = Start;
+
+   ES_InitSPSCQueue( &TestQueue, TestSlots, TEST_SLOTS );
+   pthread_create( &Thread, NULL, Producer, NULL );
+   while ( NumTaken < TEST_EVENTS ){
+      if ( (_HW_AtomicLoad16( &TestReady ) & READY_BIT) == 0 ){
+         // a lost ready bit would leave us here with events in the queue
+         if ( Seconds() - LastProgress > 2.0 ){
+            printf("stalled: ready bit clear with %u queued\n",
+                   ES_SPSCQueueDepth( &TestQueue ));
+            return 1;
+         }
+         sched_yield();
+         continue;
+      }
+      if ( ES_SPSCDeQueue( &TestQueue, &ThisEvent ) == 0 ){
+         _HW_AtomicClearBits16( &TestReady, READY_BIT );
+         if ( ES_SPSCQueueDepth( &TestQueue ) != 0 ){
+            _HW_AtomicSetBits16( &TestReady, READY_BIT );
+         }
+      }
+      if ( ThisEvent.EventType == ES_NO_EVENT ){
+         continue; // a ready bit set after we had already taken the event
+      }
+      if ( ThisEvent.EventParam != (uint16_t)NumTaken ){
+         NumWrong++;
+      }
+      NumTaken++;
+      LastProgress = Seconds();
+   }
+   pthread_join( Thread, NULL );
+   printf("%lu events in %.2f s, %lu out of sequence, producer found the "
+          "queue full %lu times\n", NumTaken, Seconds() - Start, NumWrong,
+          NumFull);
+   return ( NumWrong != 0 ) || ( ES_SPSCQueueDepth( &TestQueue ) != 0 );
+}
+
+int main(void)
+{
+   Benchmark( 16 );
+   Benchmark( 10 );
+   Benchmark( 128 );
+   Benchmark( BENCH_MAX_SIZE );
+   return StressTest();
+}
 #endif
 /*------------------------------- Footnotes -------------------------------*/
 /*------------------------------ End of file ------------------------------*/
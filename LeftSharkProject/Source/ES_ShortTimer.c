@@ -7,23 +7,34 @@
    1.0.1
 
  Description
-   This is a library to provide for the creation of short time-outs 
-   (shorter than the resolution of the ES_Timer library). 
+   This is a library to provide for the creation of short time-outs
+   (shorter than the resolution of the ES_Timer library).
 
  Notes
    This module uses the Tiva Peripheral Driver Library functions and
    the ability that it provides to 'hook' a function into an interrupt
    response routine without modifying the vector table directly.
-   Uses timers A & B on 16/32 bit Timer Module 5
-   
+   Uses timer A on 16/32 bit Timer Module 5
+
+   There are ES_NUM_SHORT_TIMERS timers, each of which can belong to a
+   different service. Their deadlines are kept in microseconds on the
+   ES_Timer_GetTimeUs time base, in a list sorted by deadline, and timer A
+   is loaded for the first one. Its interrupt posts the ES_SHORT_TIMEOUTs
+   for every timer that is due and loads the hardware for the next.
+   Timers 0 and 1 are the original TIMER_A and TIMER_B, so
+   ES_ShortTimerInit and ES_ShortTimerStart work as they did.
+
  History
  When           Who     What/Why
  -------------- ---     --------
  10/11/15 10:30 jec     first pass
  10/11/15 18:10 jec     converted to post events to the framework
- 
+ 10/17/26 10:30 afb     widened the priorities to uint16_t for 256 services
+ 10/17/26 14:30 afb     multiplexed ES_NUM_SHORT_TIMERS timers onto timer A,
+                        fixed TIMER_B being logged with the TIMER_A service
+
 ****************************************************************************/
-// the common headers for I/O, C99 types 
+// the common headers for I/O, C99 types
 #include <stdio.h>
 #include <stdint.h>
 #include <stdbool.h>
@@ -59,115 +70,278 @@
 // the current values are based on a 40mHz clock rate to give 1uS resolution
 #define PRE_1uS 40
 
+// the most that the 16 bit timer A can count, longer waits are made in steps
+#define MAX_LOAD_uS 0xFFFF
+// there is about 10uS of overhead in getting a timeout posted, so anything
+// due within this long is treated as due now
+#define MIN_LEAD_uS 11
+
+// marks the end of the pending list
+#define END_OF_LIST 0xFF
+
+// the slots used by the original two timer API
+#define TIMER_A_SLOT 0
+#define TIMER_B_SLOT 1
+
+typedef struct {
+  uint64_t Deadline;  // when it is due, on the ES_Timer_GetTimeUs time base
+  uint16_t Owner;     // the service to post the timeout to
+  uint16_t Param;     // the EventParam for the timeout
+  uint8_t  Next;      // while pending, the timer due after this one
+  bool     Pending;
+} ShortTimer_t;
+
+// make sure that the timer numbers fit in the links, with 2 for TIMER_A/B
+typedef char ES_ShortTimerCountCheck[((ES_NUM_SHORT_TIMERS >= 2) &&
+                        (ES_NUM_SHORT_TIMERS < END_OF_LIST)) ? 1 : -1];
+
 void ShortTimerAHandler(void);
 void ShortTimerBHandler(void);
+static void StartSlot( uint8_t Num, uint16_t Owner, uint16_t Param,
+                       uint32_t TimeoutuS );
+static void InsertPending( uint8_t Num );
+static void RemovePending( uint8_t Num );
+static void LoadHardware( uint64_t Now );
 
 // module level variables
 
-static uint8_t Timer_A_Priority = SHORT_TIMER_UNUSED;
-static uint8_t Timer_B_Priority = SHORT_TIMER_UNUSED;
+// uint16_t so that SHORT_TIMER_UNUSED (MAX_NUM_SERVICES) stays out of range
+// of the real service numbers with up to 256 services
+static uint16_t Timer_A_Priority = SHORT_TIMER_UNUSED;
+static uint16_t Timer_B_Priority = SHORT_TIMER_UNUSED;
+
+static ShortTimer_t ShortTimers[ES_NUM_SHORT_TIMERS];
+// the first (soonest due) pending timer
+static uint8_t PendingHead = END_OF_LIST;
+
+static bool HardwareReady = false;
 
 //******************************
 // ES_ShortTimerInit()
-// Initialize the timer subsystem and log the services to which the timeout
-// messages will be posted
+// Initialize the timer subsystem and log the services to which the
+// TIMER_A & TIMER_B timeout messages will be posted.
+// Passing SHORT_TIMER_UNUSED leaves that timer's service as it was, so that
+// two services can each log one of them
 //******************************
-void ES_ShortTimerInit(uint8_t TimeAPrio, uint8_t TimeBPrio){
+void ES_ShortTimerInit(uint16_t TimeAPrio, uint16_t TimeBPrio){
+  if (!HardwareReady){
 #ifdef DEBUG
 // set up I/O lines for debugging
-  SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOB);
-  GPIOPinTypeGPIOOutput(GPIO_PORTB_BASE, GPIO_PIN_0 | GPIO_PIN_1);
+    SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOB);
+    GPIOPinTypeGPIOOutput(GPIO_PORTB_BASE, GPIO_PIN_0 | GPIO_PIN_1);
 // start with the lines low
-  GPIOPinWrite(GPIO_PORTB_BASE, GPIO_PIN_0 | GPIO_PIN_1, BIT0LO & BIT1LO);  
-#endif  
-
-// enable the clock to the timer module  
-  SysCtlPeripheralEnable(SYSCTL_PERIPH_TIMER5); 
-// configure as 2 16 bit timers  
-  TimerConfigure(TIMER5_BASE, TIMER_CFG_SPLIT_PAIR | TIMER_CFG_A_ONE_SHOT | 
-                 TIMER_CFG_B_ONE_SHOT);
-// set prescale to get 1uS resolution  
-  TimerPrescaleSet(TIMER5_BASE, TIMER_BOTH, PRE_1uS);
+    GPIOPinWrite(GPIO_PORTB_BASE, GPIO_PIN_0 | GPIO_PIN_1, BIT0LO & BIT1LO);
+#endif
+
+// enable the clock to the timer module
+    SysCtlPeripheralEnable(SYSCTL_PERIPH_TIMER5);
+// configure as 2 16 bit timers, only A is used
+    TimerConfigure(TIMER5_BASE, TIMER_CFG_SPLIT_PAIR | TIMER_CFG_A_ONE_SHOT |
+                   TIMER_CFG_B_ONE_SHOT);
+// set prescale to get 1uS resolution
+    TimerPrescaleSet(TIMER5_BASE, TIMER_BOTH, PRE_1uS);
+// local enable
+    TimerIntEnable(TIMER5_BASE, TIMER_TIMA_TIMEOUT);
+// NVIC Enable
+    IntEnable(INT_TIMER5A_TM4C123);
+    HardwareReady = true;
+  }
 // log the service to which the timeout will be posted
-  Timer_A_Priority = TimeAPrio;
-  Timer_B_Priority = TimeAPrio;
-      
+  if (TimeAPrio != SHORT_TIMER_UNUSED)
+    Timer_A_Priority = TimeAPrio;
+  if (TimeBPrio != SHORT_TIMER_UNUSED)
+    Timer_B_Priority = TimeBPrio;
 }
 
+//******************************
+// ES_ShortTimerStart()
+// Start TIMER_A or TIMER_B for TimeoutValue uS, the ES_SHORT_TIMEOUT goes
+// to the service logged by ES_ShortTimerInit with EventParam of TIMER_A or
+// TIMER_B
+//******************************
 void ES_ShortTimerStart( uint32_t Which, uint16_t TimeoutValue){
-  if ((Which != TIMER_A) && (Which != TIMER_B))
-    return;
-  // for very short delays. just immediatly post. There is 10us of overhead
-  if( TimeoutValue < 11){
-    if(Which == TIMER_A){
-      ShortTimerAHandler();
-    }else{
-      ShortTimerBHandler();
-    }
+  if (Which == TIMER_A){
+    StartSlot(TIMER_A_SLOT, Timer_A_Priority, TIMER_A, TimeoutValue);
+  }else if (Which == TIMER_B){
+    StartSlot(TIMER_B_SLOT, Timer_B_Priority, TIMER_B, TimeoutValue);
   }
-  TimerLoadSet(TIMER5_BASE, Which, TimeoutValue);
-  
-  if(Which == TIMER_A)
-  { // local enable
-    TimerIntEnable(TIMER5_BASE, TIMER_TIMA_TIMEOUT);
-    // NVIC Enable
-    IntEnable(INT_TIMER5A_TM4C123);
-  }else{
-    // local enable
-    TimerIntEnable(TIMER5_BASE, TIMER_TIMB_TIMEOUT);
-    // NVIC Enable
-    IntEnable(INT_TIMER5B_TM4C123);
-  }
-  
-  TimerEnable(TIMER5_BASE, Which);
+}
 
-#ifdef DEBUG
-// raise I/O line to show we started
-  if( Which == TIMER_A)
-    GPIOPinWrite(GPIO_PORTB_BASE, BIT0HI, BIT0HI);
-  else
-    GPIOPinWrite(GPIO_PORTB_BASE, BIT1HI, BIT1HI);    
-#endif
-  return;
+//******************************
+// ES_ShortTimerStartuS()
+// Start short timer Num (2 to ES_NUM_SHORT_TIMERS-1, 0 & 1 are TIMER_A &
+// TIMER_B) for TimeoutuS uS. The ES_SHORT_TIMEOUT goes to WhichService with
+// Num as its EventParam. Restarting a pending timer moves its deadline.
+// Returns false if there is no such timer.
+//******************************
+bool ES_ShortTimerStartuS( uint16_t Num, uint16_t WhichService,
+                           uint32_t TimeoutuS ){
+  if ((Num < 2) || (Num >= ES_NUM_SHORT_TIMERS))
+    return false;
+  StartSlot((uint8_t)Num, WhichService, Num, TimeoutuS);
+  return true;
 }
 
+//******************************
+// ES_ShortTimerStop()
+// Cancel short timer Num (0 & 1 are TIMER_A & TIMER_B), returns false if
+// it was not pending
+//******************************
+bool ES_ShortTimerStop( uint16_t Num ){
+  bool WasPending;
+
+  if (Num >= ES_NUM_SHORT_TIMERS)
+    return false;
+  EnterCritical();
+  WasPending = ShortTimers[Num].Pending;
+  if (WasPending){
+    RemovePending((uint8_t)Num);
+  }
+  ExitCritical();
+  return WasPending;
+}
+
+//******************************
+// ShortTimerAHandler()
+// Timer A interrupt response. Posts the timeouts for all of the timers that
+// are due, then loads timer A for the next one. It is also triggered from
+// software when a timer is started with less than MIN_LEAD_uS to go.
+//******************************
 void ShortTimerAHandler(void){
   ES_Event ThisEvent;
+  uint64_t Now;
+  uint8_t Expired;
+  uint16_t Owner;
 
 // start by clearing the source of the interrupt
-    TimerIntClear(TIMER5_BASE, TIMER_TIMA_TIMEOUT);
+  TimerIntClear(TIMER5_BASE, TIMER_TIMA_TIMEOUT);
 #ifdef DEBUG
 // lower I/O line to show we arrived
-  GPIOPinWrite(GPIO_PORTB_BASE, BIT0HI, BIT0LO);  
+  GPIOPinWrite(GPIO_PORTB_BASE, BIT0HI, BIT0LO);
 #endif
- 
-// post the timeout for this timer  
+
   ThisEvent.EventType = ES_SHORT_TIMEOUT;
-  ThisEvent.EventParam = TIMER_A;
-// protect against timer that was not correctly initialized  
-  if (Timer_A_Priority != SHORT_TIMER_UNUSED)
-  {
-    ES_PostToService( Timer_A_Priority, ThisEvent);
+  while (1){
+    // ES_Timer_GetTimeUs has its own critical region, so read it first
+    Now = ES_Timer_GetTimeUs();
+    EnterCritical();
+    Expired = PendingHead;
+    if ((Expired == END_OF_LIST) ||
+        (ShortTimers[Expired].Deadline > Now + MIN_LEAD_uS)){
+      LoadHardware(Now);
+      ExitCritical();
+      break;
+    }
+    PendingHead = ShortTimers[Expired].Next;
+    ShortTimers[Expired].Pending = false;
+    Owner = ShortTimers[Expired].Owner;
+    ThisEvent.EventParam = ShortTimers[Expired].Param;
+    ExitCritical();
+// protect against timer that was not correctly initialized
+    if (Owner != SHORT_TIMER_UNUSED){
+      ES_PostToService( Owner, ThisEvent);
+    }
   }
 }
 
+//******************************
+// ShortTimerBHandler()
+// Timer B is no longer used, TIMER_B is multiplexed onto timer A
+//******************************
 void ShortTimerBHandler(void){
-  ES_Event ThisEvent;
+  TimerIntClear(TIMER5_BASE, TIMER_TIMB_TIMEOUT);
+}
 
-// start by clearing the source of the interrupt
-    TimerIntClear(TIMER5_BASE, TIMER_TIMB_TIMEOUT);
+//******************************
+// StartSlot()
+// put a timer on the pending list for TimeoutuS from now, and reload the
+// hardware if it is now the first due
+//******************************
+static void StartSlot( uint8_t Num, uint16_t Owner, uint16_t Param,
+                       uint32_t TimeoutuS ){
+  uint64_t Now = ES_Timer_GetTimeUs();
+
+  EnterCritical();
+  if (ShortTimers[Num].Pending){
+    RemovePending(Num);
+  }
+  ShortTimers[Num].Deadline = Now + TimeoutuS;
+  ShortTimers[Num].Owner = Owner;
+  ShortTimers[Num].Param = Param;
+  InsertPending(Num);
+  if (PendingHead == Num){
+    LoadHardware(Now);
+  }
+  ExitCritical();
 #ifdef DEBUG
-// lower I/O line to show we arrived
-  GPIOPinWrite(GPIO_PORTB_BASE, BIT1HI, BIT1LO);    
-#endif 
-  
-// post the timeout for this timer  
-  ThisEvent.EventType = ES_SHORT_TIMEOUT;
-  ThisEvent.EventParam = TIMER_B;
-// protect against timer that was not correctly initialized  
-  if (Timer_B_Priority != SHORT_TIMER_UNUSED)
-  {
-    ES_PostToService( Timer_B_Priority, ThisEvent);
+// raise I/O line to show we started
+  GPIOPinWrite(GPIO_PORTB_BASE, BIT0HI, BIT0HI);
+#endif
+}
+
+//******************************
+// InsertPending()
+// link a timer in after the last one that is due no later than it.
+// call with interrupts off
+//******************************
+static void InsertPending( uint8_t Num ){
+  uint8_t Before = END_OF_LIST;
+  uint8_t After = PendingHead;
+
+  while ((After != END_OF_LIST) &&
+         (ShortTimers[After].Deadline <= ShortTimers[Num].Deadline)){
+    Before = After;
+    After = ShortTimers[After].Next;
+  }
+  ShortTimers[Num].Next = After;
+  ShortTimers[Num].Pending = true;
+  if (Before == END_OF_LIST){
+    PendingHead = Num;
+  }else{
+    ShortTimers[Before].Next = Num;
+  }
+}
+
+//******************************
+// RemovePending()
+// unlink a pending timer. Timer A is left alone if it was the first due,
+// the interrupt will find nothing due and reload for the new first.
+// call with interrupts off
+//******************************
+static void RemovePending( uint8_t Num ){
+  uint8_t Before;
+
+  if (PendingHead == Num){
+    PendingHead = ShortTimers[Num].Next;
+  }else{
+    for (Before = PendingHead; ShortTimers[Before].Next != Num;
+         Before = ShortTimers[Before].Next)
+      ;
+    ShortTimers[Before].Next = ShortTimers[Num].Next;
+  }
+  ShortTimers[Num].Pending = false;
+}
+
+//******************************
+// LoadHardware()
+// load timer A to interrupt when the first pending timer is due, in steps
+// of MAX_LOAD_uS for long waits. If it is already due, trigger the
+// interrupt from software instead.
+// call with interrupts off
+//******************************
+static void LoadHardware( uint64_t Now ){
+  uint64_t Wait;
+
+  TimerDisable(TIMER5_BASE, TIMER_A);
+  if (PendingHead == END_OF_LIST)
+    return;
+  if (ShortTimers[PendingHead].Deadline <= Now + MIN_LEAD_uS){
+    IntTrigger(INT_TIMER5A_TM4C123);
+    return;
   }
-  
+  Wait = ShortTimers[PendingHead].Deadline - Now;
+  if (Wait > MAX_LOAD_uS)
+    Wait = MAX_LOAD_uS;
+  TimerLoadSet(TIMER5_BASE, TIMER_A, (uint32_t)Wait);
+  TimerEnable(TIMER5_BASE, TIMER_A);
 }
@@ -0,0 +1,434 @@
+//#define TEST
+/****************************************************************************
+ Module
+   ES_Sim_POSIX.c
+
+ Description
+   A discrete event simulator for the host build of the Events & Services
+   framework. Time is the count of ticks that ES_SimRun has credited to the
+   port, and it only moves when every queue is empty, straight to the next
+   thing that can happen.
+
+ Notes
+   The scheduled stimuli are kept in a binary heap ordered by tick and then
+   by the order they were posted in, so ties come out the same way every
+   run. The next timer expiry comes from ES_Timer_GetTicksToNextExpiry, and
+   the ticks up to it go to the timers through _HW_AddTicks and the port's
+   bulk tick response, which costs the same however long the gap is.
+
+   Time is never moved past a timer expiry, so the services see every
+   timeout before any later one is posted, as they would in real time.
+
+   This file is only part of a host build with ES_ENABLE_SIM.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/17/26 21:30 afb     send the log after each ES_RunToIdle
+ 10/17/26 20:30 afb     started coding
+****************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "ES_Configure.h"
+#include "ES_Framework.h"
+#include "ES_Sim.h"
+#include "ES_Log.h"
+
+#ifdef ES_ENABLE_SIM
+
+/*----------------------------- Module Defines ----------------------------*/
+// the most ticks handed to the port at a time, so that its count can't wrap
+#define MAX_STEP 0x7FFFFFFFUL
+
+/*------------------------------ Module Types -----------------------------*/
+typedef struct {
+    uint64_t AtTick;
+    uint32_t Order;           // when it was posted, to break ties
+    ES_SimStimulus_t * pStimulus;
+    uint32_t Param;
+}Stimulus_t;
+
+/*---------------------------- Module Functions ---------------------------*/
+static bool Earlier( Stimulus_t const * pA, Stimulus_t const * pB );
+static void TakeFirst( Stimulus_t * pFirst );
+static void AdvanceTo( uint64_t Tick );
+
+/*---------------------------- Module Variables ---------------------------*/
+// the waiting stimuli, a binary heap with the earliest at Stimuli[0]
+static Stimulus_t Stimuli[ES_SIM_MAX_STIMULI];
+static uint16_t NumStimuli;
+static uint32_t NextOrder;
+
+// the ticks credited so far
+static uint64_t SimTicks;
+
+/*------------------------------ Module Code ------------------------------*/
+/****************************************************************************
+ Function
+     ES_SimInitialize
+ Parameters
+     TimerRate_t NewRate, the tick rate, which sets the time scale of
+                 ES_Timer_GetTimeUs
+ Returns
+     ES_Return_t, the result of ES_Initialize
+ Description
+     starts a simulation at tick 0 with nothing scheduled, and initializes
+     the framework and the services
+ Notes
+     may be called again to run a simulation over from the start
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+ES_Return_t ES_SimInitialize( TimerRate_t NewRate ){
+  NumStimuli = 0;
+  NextOrder = 0;
+  SimTicks = 0;
+  return ES_Initialize( NewRate );
+}
+
+/****************************************************************************
+ Function
+     ES_SimPostAt
+ Parameters
+     uint64_t AtTick, when to call the stimulus, now if it has passed
+     ES_SimStimulus_t * pStimulus, what to call
+     uint32_t Param, what to call it with
+ Returns
+     bool, false if ES_SIM_MAX_STIMULI are already waiting
+ Description
+     schedules a stimulus
+ Notes
+     may be called from a stimulus, a service or a timer post function
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+bool ES_SimPostAt( uint64_t AtTick, ES_SimStimulus_t * pStimulus,
+                   uint32_t Param ){
+  uint16_t Hole;
+  uint16_t Parent;
+  Stimulus_t New;
+
+  if ( NumStimuli == ES_SIM_MAX_STIMULI ){
+    return false;
+  }
+  New.AtTick = (AtTick < SimTicks) ? SimTicks : AtTick;
+  New.Order = NextOrder++;
+  New.pStimulus = pStimulus;
+  New.Param = Param;
+
+  // sift the new one up from the end
+  Hole = NumStimuli++;
+  while ( Hole > 0 ){
+    Parent = (Hole - 1) / 2;
+    if ( !Earlier( &New, &Stimuli[Parent] ) ){
+      break;
+    }
+    Stimuli[Hole] = Stimuli[Parent];
+    Hole = Parent;
+  }
+  Stimuli[Hole] = New;
+  return true;
+}
+
+/****************************************************************************
+ Function
+     ES_SimRun
+ Parameters
+     uint64_t UntilTick, when to stop
+ Returns
+     ES_Return_t, FailedRun if a run function failed, Success once the time
+     has reached UntilTick and there is nothing left to do on it
+ Description
+     runs the simulation: the services until their queues are empty, then
+     the stimuli that are due, and once there is nothing left to do on this
+     tick, on to the next timer expiry or stimulus, whichever comes first
+ Notes
+     the event checkers are not run, so nothing happens that the stimuli
+     do not start. Call it again with a later UntilTick to carry on.
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+ES_Return_t ES_SimRun( uint64_t UntilTick ){
+  Stimulus_t Due;
+  uint64_t NextTick;
+  uint32_t ToExpiry;
+
+  while(1){
+    if ( ES_RunToIdle() != Success ){
+      return FailedRun;
+    }
+    // there is no idle time in a simulation, send the log as it comes
+    while ( ES_LOG_DRAIN() ){
+    }
+    if ( (NumStimuli != 0) && (Stimuli[0].AtTick <= SimTicks) ){
+      TakeFirst( &Due );
+      Due.pStimulus( Due.Param );
+      continue;
+    }
+    if ( SimTicks >= UntilTick ){
+      return Success;
+    }
+
+    // nothing more happens on this tick, find the next one that something
+    // does happen on
+    NextTick = UntilTick;
+    ToExpiry = ES_Timer_GetTicksToNextExpiry();
+    if ( (ToExpiry != ES_TIMER_NO_EXPIRY) &&
+         (SimTicks + ToExpiry < NextTick) ){
+      NextTick = SimTicks + ToExpiry;
+    }
+    if ( (NumStimuli != 0) && (Stimuli[0].AtTick < NextTick) ){
+      NextTick = Stimuli[0].AtTick;
+    }
+    AdvanceTo( NextTick );
+  }
+}
+
+/****************************************************************************
+ Function
+     ES_SimNow
+ Parameters
+     None
+ Returns
+     uint64_t, the ticks since ES_SimInitialize
+ Description
+     the simulation's clock
+ Notes
+     ES_Timer_GetTime is the same, cut to 16 bits
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+uint64_t ES_SimNow( void ){
+  return SimTicks;
+}
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+
+// the heap order: by tick, and on the same tick by the order posted
+static bool Earlier( Stimulus_t const * pA, Stimulus_t const * pB ){
+  if ( pA->AtTick != pB->AtTick ){
+    return pA->AtTick < pB->AtTick;
+  }
+  return pA->Order < pB->Order;
+}
+
+// takes the earliest stimulus off the heap, which must not be empty
+static void TakeFirst( Stimulus_t * pFirst ){
+  Stimulus_t Last;
+  uint16_t Hole = 0;
+  uint16_t Child;
+
+  *pFirst = Stimuli[0];
+  Last = Stimuli[--NumStimuli];
+  // sift the last one down from the top
+  while ( (Child = 2 * Hole + 1) < NumStimuli ){
+    if ( (Child + 1 < NumStimuli) &&
+         Earlier( &Stimuli[Child + 1], &Stimuli[Child] ) ){
+      Child++;
+    }
+    if ( !Earlier( &Stimuli[Child], &Last ) ){
+      break;
+    }
+    Stimuli[Hole] = Stimuli[Child];
+    Hole = Child;
+  }
+  Stimuli[Hole] = Last;
+}
+
+// credits the ticks up to Tick, in pieces that the port's count can hold,
+// and hands them to the timers. The clock is moved first, so that the
+// timer post functions see the tick that they expire on.
+static void AdvanceTo( uint64_t Tick ){
+  uint32_t Step;
+
+  while ( SimTicks < Tick ){
+    Step = (Tick - SimTicks > MAX_STEP) ? MAX_STEP
+                                        : (uint32_t)(Tick - SimTicks);
+    SimTicks += Step;
+    _HW_AddTicks( Step );
+    _HW_Process_Pending_Ints();
+  }
+}
+
+#ifdef TEST
+/* a link that pairs, drops and pairs again, for hours of virtual time.
+   Define ES_ENABLE_SIM (in ES_Configure.h or on the command line) and TEST
+   at the top of this file only, since the other modules have TEST mains
+   of their own, then from the project directory build the host sources
+   as ES_Port_POSIX.c describes, with this file in place of main_POSIX.c:
+       ./sim_test | ./es_log_decode - > packets.txt
+   While unpaired a beacon goes out every TEST_BEACON_TICKS, and each one
+   is answered (after a short delay) with a chance of 1 in TEST_ANSWER_ODDS.
+   Once paired, frames arrive as key strokes to MapKeys every 100 to 1300
+   ticks, with a long silence now and then, and each one restarts the link
+   timer. When that runs out the link is lost and the beacons start again.
+   Every stimulus and timeout is folded into a hash with its tick. The
+   whole TEST_HOURS run is done twice, and the two hashes (and the packets
+   that RxSM logs to stdout, see ES_Log.h) must match, run after run.
+*/
+#include <stdio.h>
+#include <time.h>
+#include "MapKeys.h"
+
+#define TEST_HOURS         4
+#define TEST_TICKS_PER_HR  3600000ULL
+#define TEST_SEED          218
+#define TEST_LINK_TIMER    1
+#define TEST_LINK_TICKS    1000
+#define TEST_BEACON_TIMER  2
+#define TEST_BEACON_TICKS  200
+#define TEST_ANSWER_ODDS   8
+
+// 0x7E, a length of 5, 5 bytes of data and the check sum, see RunMapKeys
+static char const TestFrame[] = "123444444";
+
+enum { TEST_FRAME, TEST_LINK_LOST, TEST_BEACON, TEST_ANSWER };
+
+static uint32_t TestRandom;
+static bool TestPaired;
+static uint64_t TestHash;
+static uint32_t TestCounts[4];
+
+static void TestFrameArrives( uint32_t Param );
+static void TestAnswer( uint32_t Param );
+
+// 0 .. Range-1, from a generator that gives the same numbers every run
+static uint32_t TestRand( uint32_t Range ){
+  TestRandom = TestRandom * 1103515245u + 12345u;
+  return (TestRandom >> 8) % Range;
+}
+
+// FNV-1a over the tick and what happened on it
+static void TestRecord( uint32_t What ){
+  uint64_t Data = (ES_SimNow() << 8) | What;
+  uint16_t i;
+
+  for ( i = 0; i < 8; i++ ){
+    TestHash ^= (Data >> (8 * i)) & 0xFF;
+    TestHash *= 0x100000001B3ULL;
+  }
+  TestCounts[What]++;
+}
+
+static void TestLinkLost( uint32_t Param ){
+  (void)Param;
+  TestRecord( TEST_LINK_LOST );
+  TestPaired = false;
+  ES_Timer_InitPeriodicTimer( TEST_BEACON_TIMER, TEST_BEACON_TICKS );
+}
+
+static void TestBeacon( uint32_t Param ){
+  (void)Param;
+  TestRecord( TEST_BEACON );
+  if ( TestRand( TEST_ANSWER_ODDS ) == 0 ){
+    ES_SimPostAt( ES_SimNow() + 5 + TestRand( 45 ), TestAnswer, 0 );
+  }
+}
+
+static void TestAnswer( uint32_t Param ){
+  (void)Param;
+  if ( TestPaired ){
+    return; // a second answer to an earlier beacon
+  }
+  TestRecord( TEST_ANSWER );
+  TestPaired = true;
+  ES_Timer_StopTimer( TEST_BEACON_TIMER );
+  ES_Timer_InitTimer( TEST_LINK_TIMER, TEST_LINK_TICKS );
+  ES_SimPostAt( ES_SimNow() + 100 + TestRand( 1200 ), TestFrameArrives, 0 );
+}
+
+static void TestFrameArrives( uint32_t Param ){
+  ES_Event ThisEvent;
+  char const * pKey;
+  uint32_t Gap;
+
+  (void)Param;
+  if ( !TestPaired ){
+    return; // the link was lost while the frame was on its way
+  }
+  TestRecord( TEST_FRAME );
+  ThisEvent.EventType = ES_NEW_KEY;
+  for ( pKey = TestFrame; *pKey != '\0'; pKey++ ){
+    ThisEvent.EventParam = *pKey;
+    PostMapKeys( ThisEvent );
+    // MapKeys' queue only holds a few, so let each key through
+    ES_RunToIdle();
+  }
+  ES_Timer_InitTimer( TEST_LINK_TIMER, TEST_LINK_TICKS );
+  // now and then the other end goes quiet for a while
+  Gap = (TestRand( 50 ) == 0) ? 2000 + TestRand( 8000 )
+                              : 100 + TestRand( 1200 );
+  ES_SimPostAt( ES_SimNow() + Gap, TestFrameArrives, 0 );
+}
+
+// the timers' post functions, called from the tick response, so they leave
+// the work to a stimulus on the same tick
+static bool TestLinkTimeout( ES_Event ThisEvent ){
+  (void)ThisEvent;
+  return ES_SimPostAt( ES_SimNow(), TestLinkLost, 0 );
+}
+
+static bool TestBeaconTimeout( ES_Event ThisEvent ){
+  ES_Timer_TimeoutDispatched( ThisEvent.EventParam );
+  return ES_SimPostAt( ES_SimNow(), TestBeacon, 0 );
+}
+
+static bool TestRun( uint64_t * pHash ){
+  uint16_t i;
+
+  TestRandom = TEST_SEED;
+  TestPaired = false;
+  TestHash = 0xCBF29CE484222325ULL;
+  for ( i = 0; i < 4; i++ ){
+    TestCounts[i] = 0;
+  }
+  if ( ES_SimInitialize( ES_Timer_RATE_1mS ) != Success ){
+    return false;
+  }
+  ES_Timer_SetPostFunc( TEST_LINK_TIMER, TestLinkTimeout );
+  ES_Timer_SetPostFunc( TEST_BEACON_TIMER, TestBeaconTimeout );
+  ES_Timer_InitPeriodicTimer( TEST_BEACON_TIMER, TEST_BEACON_TICKS );
+  if ( ES_SimRun( TEST_HOURS * TEST_TICKS_PER_HR ) != Success ){
+    return false;
+  }
+  *pHash = TestHash;
+  return true;
+}
+
+int main(void)
+{
+   uint64_t Hashes[2];
+   struct timespec Start, End;
+   double Seconds;
+   uint16_t Run;
+
+   for (Run = 0; Run < 2; Run++)
+   {
+      clock_gettime(CLOCK_MONOTONIC, &Start);
+      if (TestRun(&Hashes[Run]) != true)
+      {
+         fprintf(stderr, "run %u failed\n", Run);
+         return 1;
+      }
+      clock_gettime(CLOCK_MONOTONIC, &End);
+      Seconds = (End.tv_sec - Start.tv_sec) +
+                (End.tv_nsec - Start.tv_nsec) / 1e9;
+      fprintf(stderr, "%u h in %.3f s (x%.0f): %u frames, %u links lost, "
+              "%u beacons, %u pairings, hash %016llx\n", TEST_HOURS,
+              Seconds, TEST_HOURS * 3600.0 / Seconds,
+              TestCounts[TEST_FRAME], TestCounts[TEST_LINK_LOST],
+              TestCounts[TEST_BEACON], TestCounts[TEST_ANSWER],
+              (unsigned long long)Hashes[Run]);
+   }
+   fprintf(stderr, "%s\n", (Hashes[0] == Hashes[1]) ? "the runs match"
+                                                    : "THE RUNS DIFFER");
+   return Hashes[0] != Hashes[1];
+}
+#endif
+
+#endif /* ES_ENABLE_SIM */
+/*------------------------------- Footnotes -------------------------------*/
+/*------------------------------ End of file ------------------------------*/
@@ -0,0 +1,806 @@
+//#define TEST
+/****************************************************************************
+ Module
+   ES_Threads_POSIX.c
+
+ Description
+   The multi-threaded runtime for the host build of the Events & Services
+   framework. Each service is owned by one worker thread, which takes the
+   events from the service's mailbox and hands them to its run function one
+   at a time, so a service never sees two events at once and sees the
+   events from any one poster in the order they were posted.
+
+ Notes
+   A mailbox is a bounded multi-producer, single consumer ring. Every slot
+   carries a sequence count: a producer claims the slot at Tail with a
+   compare-and-swap, copies the event in and then releases the slot by
+   moving its count on, and the owner only takes the slot once that has
+   happened. Posting never takes a lock, so any thread (or a signal
+   handler) may post to any service, and a full mailbox fails the post just
+   as a full queue does on the target.
+
+   LIFO posts (ES_RecallEvents) go to a small stack beside the mailbox that
+   only the owner touches, and are taken before anything in the mailbox.
+
+   A worker with nothing to do sets Sleeping and checks its mailboxes once
+   more before it waits on its semaphore. A poster checks Sleeping after
+   its event is in and only then posts the semaphore, so a busy worker
+   costs its posters no system call and an idle one can not miss a wakeup.
+   Both sides fence between the store and the load, since each has to see
+   the other's store.
+
+   The workers are started with every signal blocked, so the tick, the
+   simulated interrupts and SIGINT/SIGTERM still go to the framework's
+   thread, which keeps running the timers and the event checkers. ES_Run
+   only runs the checkers once every mailbox is empty, as it does with
+   the queues, so that a checker can not post faster than the services
+   keep up. Until then it waits in ES_ThreadsWaitIdle, which a worker wakes
+   as it runs out of events, the same way the posters wake the workers.
+
+   This file is only part of a host build with ES_ENABLE_THREADS (or TEST).
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/17/26 19:30 afb     started coding
+****************************************************************************/
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#include "ES_Configure.h"
+#include "ES_Port.h"
+#include "ES_Threads.h"
+
+#if defined(ES_ENABLE_THREADS) || defined(TEST)
+
+/*----------------------------- Module Defines ----------------------------*/
+// the current thread is not a worker
+#define NO_WORKER (-1)
+
+// the longest ES_ThreadsWaitIdle waits, a tick at ES_Timer_RATE_1mS, so
+// that the tick is collected on time while the services are busy
+#define IDLE_WAIT_NS  1000000L
+#define NS_PER_SEC    1000000000L
+
+/*------------------------------ Module Types -----------------------------*/
+typedef struct {
+    _Atomic uint32_t Seq;     // == the position when free, position + 1 when
+                              // it holds the event for that position
+    ES_Event Event;
+}MailSlot_t;
+
+typedef struct {
+    MailSlot_t * pSlots;
+    uint32_t Mask;            // number of slots - 1, a power of two
+    _Atomic uint32_t Tail;    // the next position to claim, by any poster
+    _Atomic uint32_t Head;    // the next position to take, by the owner
+    ES_Event * pFront;        // the owner's LIFO posts, taken first
+    _Atomic uint16_t NumFront;
+    uint16_t FrontSize;
+}Mailbox_t;
+
+typedef struct {
+    pthread_t Thread;
+    sem_t Wake;
+    atomic_int Sleeping;      // 1 while the worker may be waiting on Wake
+    uint16_t Number;
+    uint16_t TopService;      // the highest priority service it owns
+}Worker_t;
+
+/*---------------------------- Module Functions ---------------------------*/
+static void * WorkerLoop( void * pArg );
+static bool TakeNext( Worker_t const * pWorker, uint8_t * pWhichService,
+                      ES_Event * pEvent );
+static bool HasEvents( Worker_t const * pWorker );
+static void WakeOwner( uint8_t WhichService );
+static void WakeFramework( void );
+static uint32_t RoundUpPow2( uint32_t Size );
+static void FreeAll( void );
+
+/*---------------------------- Module Variables ---------------------------*/
+static Mailbox_t * Mailboxes;
+static Worker_t * Workers;
+static uint16_t NumMailboxes;
+static uint16_t NumWorkers;
+static ES_ThreadRunFunc_t * pServiceRun;
+static bool Started;
+static atomic_bool Stopping;
+static atomic_bool Failed;
+
+// for ES_ThreadsWaitIdle, IdleWaiting is 1 while the framework's thread may
+// be waiting on IdleWake
+static sem_t IdleWake;
+static atomic_int IdleWaiting;
+
+// which worker the calling thread is, for the owner checks
+static __thread int CurrentWorker = NO_WORKER;
+
+/*------------------------------ Module Code ------------------------------*/
+/****************************************************************************
+ Function
+     ES_ThreadsInit
+ Parameters
+     uint16_t NumServices, the number of services
+     uint16_t NumThreads, the number of worker threads, 0 for one per
+              service
+     uint16_t const * pMailboxSizes, the queue size of each service, rounded
+              up to a power of two for its mailbox
+     ES_ThreadRunFunc_t * pRunFunc, what the workers hand the events to
+ Returns
+     bool, false if the memory could not be had
+ Description
+     sets up the mailboxes and assigns the services to the workers, without
+     starting them
+ Notes
+     called by ES_Initialize before the service inits, which may post
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+bool ES_ThreadsInit( uint16_t NumServices, uint16_t NumThreads,
+                     uint16_t const * pMailboxSizes,
+                     ES_ThreadRunFunc_t * pRunFunc ){
+  uint16_t i;
+  uint32_t Size;
+  uint32_t Slot;
+
+  if ( (NumThreads == 0) || (NumThreads > NumServices) ){
+    NumThreads = NumServices;
+  }
+  Mailboxes = calloc( NumServices, sizeof(Mailbox_t) );
+  Workers = calloc( NumThreads, sizeof(Worker_t) );
+  if ( (Mailboxes == NULL) || (Workers == NULL) ){
+    FreeAll();
+    return false;
+  }
+  NumMailboxes = NumServices;
+  NumWorkers = NumThreads;
+  pServiceRun = pRunFunc;
+  Started = false;
+  atomic_store( &Stopping, false );
+  atomic_store( &Failed, false );
+
+  for ( i = 0; i < NumServices; i++ ){
+    Size = RoundUpPow2( pMailboxSizes[i] );
+    Mailboxes[i].pSlots = calloc( Size, sizeof(MailSlot_t) );
+    Mailboxes[i].pFront = calloc( pMailboxSizes[i], sizeof(ES_Event) );
+    if ( (Mailboxes[i].pSlots == NULL) || (Mailboxes[i].pFront == NULL) ){
+      FreeAll();
+      return false;
+    }
+    Mailboxes[i].Mask = Size - 1;
+    Mailboxes[i].FrontSize = pMailboxSizes[i];
+    for ( Slot = 0; Slot < Size; Slot++ ){
+      atomic_init( &Mailboxes[i].pSlots[Slot].Seq, Slot );
+    }
+    // the last service that lands on a worker is its highest
+    Workers[i % NumThreads].TopService = i;
+  }
+  for ( i = 0; i < NumThreads; i++ ){
+    Workers[i].Number = i;
+    sem_init( &Workers[i].Wake, 0, 0 );
+  }
+  sem_init( &IdleWake, 0, 0 );
+  return true;
+}
+
+/****************************************************************************
+ Function
+     ES_ThreadsStart
+ Parameters
+     None
+ Returns
+     bool, false if a thread could not be created
+ Description
+     starts the workers, which run whatever the inits have already posted
+ Notes
+     the signals are blocked while they are created, so that they inherit
+     a mask with all of them blocked
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+bool ES_ThreadsStart( void ){
+  sigset_t AllSignals;
+  sigset_t OldMask;
+  uint16_t i;
+  bool AllCreated = true;
+
+  sigfillset( &AllSignals );
+  pthread_sigmask( SIG_BLOCK, &AllSignals, &OldMask );
+  for ( i = 0; i < NumWorkers; i++ ){
+    if ( pthread_create( &Workers[i].Thread, NULL, WorkerLoop,
+                         &Workers[i] ) != 0 ){
+      AllCreated = false;
+      break;
+    }
+  }
+  pthread_sigmask( SIG_SETMASK, &OldMask, NULL );
+  Started = true;
+  if ( AllCreated != true ){
+    NumWorkers = i; // so that ES_ThreadsStop only joins those that started
+  }
+  return AllCreated;
+}
+
+/****************************************************************************
+ Function
+     ES_ThreadsStop
+ Parameters
+     None
+ Returns
+     nothing
+ Description
+     stops and joins the workers and frees the mailboxes
+ Notes
+     the events still in the mailboxes are dropped without being run. The
+     framework never stops, this is for the benchmark and for tests that
+     set the runtime up more than once.
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+void ES_ThreadsStop( void ){
+  uint16_t i;
+
+  atomic_store( &Stopping, true );
+  if ( Started ){
+    for ( i = 0; i < NumWorkers; i++ ){
+      sem_post( &Workers[i].Wake );
+    }
+    for ( i = 0; i < NumWorkers; i++ ){
+      pthread_join( Workers[i].Thread, NULL );
+    }
+  }
+  for ( i = 0; i < NumWorkers; i++ ){
+    sem_destroy( &Workers[i].Wake );
+  }
+  sem_destroy( &IdleWake );
+  FreeAll();
+  Started = false;
+}
+
+/****************************************************************************
+ Function
+     ES_ThreadsFailed
+ Parameters
+     None
+ Returns
+     bool, true once a run function has reported an error
+ Description
+     lets ES_Run return FailedRun, since the workers have nobody to return
+     it to
+ Notes
+
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+bool ES_ThreadsFailed( void ){
+  return atomic_load( &Failed );
+}
+
+/****************************************************************************
+ Function
+     ES_ThreadsPending
+ Parameters
+     None
+ Returns
+     bool, true if any service has an event waiting
+ Description
+     the test that ES_Run makes of Ready, for the mailboxes
+ Notes
+     an event that a worker has already taken does not count
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+bool ES_ThreadsPending( void ){
+  uint16_t i;
+
+  for ( i = 0; i < NumWorkers; i++ ){
+    if ( HasEvents( &Workers[i] ) ){
+      return true;
+    }
+  }
+  return false;
+}
+
+/****************************************************************************
+ Function
+     ES_ThreadsWaitIdle
+ Parameters
+     None
+ Returns
+     nothing
+ Description
+     waits until a worker runs out of events, or for up to a millisecond,
+     when the services have events waiting
+ Notes
+     called by ES_Run in place of running the event checkers. It returns
+     when any one worker goes idle, ES_Run calls it again while there are
+     events left for the others.
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+void ES_ThreadsWaitIdle( void ){
+  struct timespec Until;
+
+  atomic_store( &IdleWaiting, 1 );
+  atomic_thread_fence( memory_order_seq_cst );
+  if ( ES_ThreadsPending() ){
+    clock_gettime( CLOCK_REALTIME, &Until );
+    Until.tv_nsec += IDLE_WAIT_NS;
+    if ( Until.tv_nsec >= NS_PER_SEC ){
+      Until.tv_nsec -= NS_PER_SEC;
+      Until.tv_sec++;
+    }
+    // a signal or the timeout ends it early, which ES_Run copes with
+    sem_timedwait( &IdleWake, &Until );
+  }
+  atomic_store( &IdleWaiting, 0 );
+}
+
+/****************************************************************************
+ Function
+     ES_ThreadPost
+ Parameters
+     uint8_t WhichService, the service to post to
+     ES_Event ThisEvent, the event to post
+ Returns
+     bool, false if the mailbox was full or WhichService is out of range
+ Description
+     puts the event in the service's mailbox and wakes its worker if it is
+     waiting
+ Notes
+     lock-free, safe to call from any thread
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+bool ES_ThreadPost( uint8_t WhichService, ES_Event ThisEvent ){
+  Mailbox_t * pBox;
+  MailSlot_t * pSlot;
+  uint32_t Pos;
+  int32_t Diff;
+
+  if ( WhichService >= NumMailboxes ){
+    return false;
+  }
+  pBox = &Mailboxes[WhichService];
+  Pos = atomic_load_explicit( &pBox->Tail, memory_order_relaxed );
+  for ( ;; ){
+    pSlot = &pBox->pSlots[Pos & pBox->Mask];
+    Diff = (int32_t)(atomic_load_explicit( &pSlot->Seq,
+                                           memory_order_acquire ) - Pos);
+    if ( Diff == 0 ){
+      // the slot is free, claim it if nobody else has
+      if ( atomic_compare_exchange_weak_explicit( &pBox->Tail, &Pos, Pos + 1,
+                                                  memory_order_relaxed,
+                                                  memory_order_relaxed ) ){
+        break;
+      }
+    }else if ( Diff < 0 ){
+      return false; // the owner has not taken the event a lap ago yet
+    }else{
+      Pos = atomic_load_explicit( &pBox->Tail, memory_order_relaxed );
+    }
+  }
+  pSlot->Event = ThisEvent;
+  atomic_store_explicit( &pSlot->Seq, Pos + 1, memory_order_release );
+  WakeOwner( WhichService );
+  return true;
+}
+
+/****************************************************************************
+ Function
+     ES_ThreadPostFront
+ Parameters
+     uint8_t WhichService, the service to post to
+     ES_Event ThisEvent, the event to post
+ Returns
+     bool, false if the stack is full, WhichService is out of range or the
+     caller is not the service's worker
+ Description
+     posts the event so that the service gets it before anything else, for
+     ES_PostToServiceLIFO
+ Notes
+     only the worker that owns the service may do this once the workers are
+     running, which covers ES_RecallEvents from the service itself
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+bool ES_ThreadPostFront( uint8_t WhichService, ES_Event ThisEvent ){
+  Mailbox_t * pBox;
+  uint16_t NumFront;
+
+  if ( WhichService >= NumMailboxes ){
+    return false;
+  }
+  if ( Started && (CurrentWorker != (int)(WhichService % NumWorkers)) ){
+    return false;
+  }
+  pBox = &Mailboxes[WhichService];
+  NumFront = atomic_load_explicit( &pBox->NumFront, memory_order_relaxed );
+  if ( NumFront >= pBox->FrontSize ){
+    return false;
+  }
+  pBox->pFront[NumFront] = ThisEvent;
+  atomic_store_explicit( &pBox->NumFront, NumFront + 1,
+                         memory_order_relaxed );
+  return true;
+}
+
+/****************************************************************************
+ Function
+     ES_ThreadQueueDepth
+ Parameters
+     uint8_t WhichService, the service to look at
+ Returns
+     uint16_t, the number of events waiting for it, 0 for a bad index
+ Description
+     for ES_GetQueueDepth
+ Notes
+     only a snapshot when called from another thread, the posters and the
+     owner carry on while it is taken
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+uint16_t ES_ThreadQueueDepth( uint8_t WhichService ){
+  Mailbox_t * pBox;
+  uint32_t Depth;
+
+  if ( WhichService >= NumMailboxes ){
+    return 0;
+  }
+  pBox = &Mailboxes[WhichService];
+  Depth = atomic_load( &pBox->Tail ) - atomic_load( &pBox->Head );
+  if ( Depth > pBox->Mask + 1 ){
+    Depth = pBox->Mask + 1; // a claimed slot that is not filled yet
+  }
+  Depth += atomic_load_explicit( &pBox->NumFront, memory_order_relaxed );
+  return (Depth > UINT16_MAX) ? UINT16_MAX : (uint16_t)Depth;
+}
+
+//*********************************
+// private functions
+//*********************************
+/****************************************************************************
+ Function
+     WorkerLoop
+ Parameters
+     void * pArg, the worker
+ Returns
+     NULL, once ES_ThreadsStop has been called
+ Description
+     runs the worker's services until told to stop, waiting on its
+     semaphore while they have nothing to do
+ Notes
+     sem_wait is retried, since a signal sent to the process can land in
+     it even with the signals blocked here
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+static void * WorkerLoop( void * pArg ){
+  Worker_t * pWorker = pArg;
+  ES_Event ThisEvent;
+  uint8_t WhichService;
+
+  CurrentWorker = pWorker->Number;
+  while ( atomic_load_explicit( &Stopping, memory_order_relaxed ) != true ){
+    if ( TakeNext( pWorker, &WhichService, &ThisEvent ) ){
+      if ( pServiceRun( WhichService, ThisEvent ) != true ){
+        atomic_store( &Failed, true );
+      }
+      continue;
+    }
+    atomic_store( &pWorker->Sleeping, 1 );
+    atomic_thread_fence( memory_order_seq_cst );
+    if ( HasEvents( pWorker ) || atomic_load( &Stopping ) ){
+      // a poster may have cleared Sleeping and posted Wake already, which
+      // only costs an extra trip round the loop
+      atomic_store( &pWorker->Sleeping, 0 );
+      continue;
+    }
+    WakeFramework();
+    while ( (sem_wait( &pWorker->Wake ) != 0) && (errno == EINTR) ){
+    }
+  }
+  return NULL;
+}
+
+/****************************************************************************
+ Function
+     TakeNext
+ Parameters
+     Worker_t const * pWorker, the worker
+     uint8_t * pWhichService, used to return the service the event is for
+     ES_Event * pEvent, used to return the event
+ Returns
+     bool, false if none of the worker's services have an event
+ Description
+     takes the next event for the highest priority of the worker's services
+     that has one, from its LIFO stack first and then its mailbox
+ Notes
+     only the worker calls this
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+static bool TakeNext( Worker_t const * pWorker, uint8_t * pWhichService,
+                      ES_Event * pEvent ){
+  Mailbox_t * pBox;
+  MailSlot_t * pSlot;
+  uint32_t Head;
+  uint16_t NumFront;
+  int32_t WhichService;
+
+  for ( WhichService = pWorker->TopService; WhichService >= 0;
+        WhichService -= NumWorkers ){
+    pBox = &Mailboxes[WhichService];
+    NumFront = atomic_load_explicit( &pBox->NumFront, memory_order_relaxed );
+    if ( NumFront != 0 ){
+      *pEvent = pBox->pFront[NumFront - 1];
+      atomic_store_explicit( &pBox->NumFront, NumFront - 1,
+                             memory_order_relaxed );
+      *pWhichService = (uint8_t)WhichService;
+      return true;
+    }
+    Head = atomic_load_explicit( &pBox->Head, memory_order_relaxed );
+    pSlot = &pBox->pSlots[Head & pBox->Mask];
+    if ( atomic_load_explicit( &pSlot->Seq, memory_order_acquire ) ==
+         Head + 1 ){
+      *pEvent = pSlot->Event;
+      // free the slot for the poster a lap from now
+      atomic_store_explicit( &pSlot->Seq, Head + pBox->Mask + 1,
+                             memory_order_release );
+      atomic_store_explicit( &pBox->Head, Head + 1, memory_order_release );
+      *pWhichService = (uint8_t)WhichService;
+      return true;
+    }
+  }
+  return false;
+}
+
+/****************************************************************************
+ Function
+     HasEvents
+ Parameters
+     Worker_t const * pWorker, the worker
+ Returns
+     bool, true if any of the worker's services have an event waiting
+ Description
+     the last look before the worker waits
+ Notes
+
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+static bool HasEvents( Worker_t const * pWorker ){
+  Mailbox_t * pBox;
+  uint32_t Head;
+  int32_t WhichService;
+
+  for ( WhichService = pWorker->TopService; WhichService >= 0;
+        WhichService -= NumWorkers ){
+    pBox = &Mailboxes[WhichService];
+    Head = atomic_load_explicit( &pBox->Head, memory_order_relaxed );
+    if ( (atomic_load_explicit( &pBox->NumFront, memory_order_relaxed ) != 0)
+         || (atomic_load_explicit( &pBox->pSlots[Head & pBox->Mask].Seq,
+                                   memory_order_acquire ) == Head + 1) ){
+      return true;
+    }
+  }
+  return false;
+}
+
+/****************************************************************************
+ Function
+     WakeOwner
+ Parameters
+     uint8_t WhichService, the service that was just posted to
+ Returns
+     nothing
+ Description
+     posts the semaphore of the service's worker if it is (about to be)
+     waiting on it
+ Notes
+     the exchange makes sure that only one poster posts it per wait
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+static void WakeOwner( uint8_t WhichService ){
+  Worker_t * pWorker = &Workers[WhichService % NumWorkers];
+
+  atomic_thread_fence( memory_order_seq_cst );
+  if ( (atomic_load_explicit( &pWorker->Sleeping, memory_order_relaxed ) != 0)
+       && (atomic_exchange( &pWorker->Sleeping, 0 ) != 0) ){
+    sem_post( &pWorker->Wake );
+  }
+}
+
+/****************************************************************************
+ Function
+     WakeFramework
+ Parameters
+     None
+ Returns
+     nothing
+ Description
+     posts IdleWake if the framework's thread is waiting in
+     ES_ThreadsWaitIdle, as a worker runs out of events
+ Notes
+
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+static void WakeFramework( void ){
+  if ( (atomic_load_explicit( &IdleWaiting, memory_order_relaxed ) != 0) &&
+       (atomic_exchange( &IdleWaiting, 0 ) != 0) ){
+    sem_post( &IdleWake );
+  }
+}
+
+/****************************************************************************
+ Function
+     RoundUpPow2
+ Parameters
+     uint32_t Size, the size that was asked for
+ Returns
+     uint32_t, the smallest power of two that is at least Size, and at
+     least 2
+ Description
+     mailbox sizes, so that the positions wrap with a mask
+ Notes
+     the sequence counts need at least two slots to tell a full slot from
+     a free one
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+static uint32_t RoundUpPow2( uint32_t Size ){
+  uint32_t Pow2 = 2;
+
+  while ( Pow2 < Size ){
+    Pow2 <<= 1;
+  }
+  return Pow2;
+}
+
+/****************************************************************************
+ Function
+     FreeAll
+ Parameters
+     None
+ Returns
+     nothing
+ Description
+     frees the mailboxes and the workers
+ Notes
+
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+static void FreeAll( void ){
+  uint16_t i;
+
+  if ( Mailboxes != NULL ){
+    for ( i = 0; i < NumMailboxes; i++ ){
+      free( Mailboxes[i].pSlots );
+      free( Mailboxes[i].pFront );
+    }
+  }
+  free( Mailboxes );
+  free( Workers );
+  Mailboxes = NULL;
+  Workers = NULL;
+  NumMailboxes = 0;
+  NumWorkers = 0;
+}
+
+#ifdef TEST
+/* throughput benchmark. With TEST defined at the top of this file, from the
+   project directory:
+   gcc -std=gnu99 -O2 -DES_PORT_POSIX -IHeaders Source/ES_Threads_POSIX.c
+       -lpthread -o threads_test
+   TEST_SERVICES services pass TEST_TOKENS events each round a ring, every
+   event doing TEST_WORK rounds of arithmetic before it is posted on to the
+   next service, so every post crosses to another service's mailbox (and
+   another thread, once there is more than one). It runs the ring on 1, 2,
+   4 .. TEST_SERVICES threads for TEST_SECONDS each and prints the events
+   per second, which should scale with the threads up to the number of
+   cores.
+*/
+#include <string.h>
+#include <unistd.h>
+
+#define TEST_SERVICES 8
+#define TEST_TOKENS   4
+#define TEST_WORK     2000
+#define TEST_SECONDS  1
+
+static atomic_uint TestLost;
+// each written only by the service's worker, read once they are joined
+static uint64_t TestCounts[TEST_SERVICES];
+
+static bool TestRun( uint8_t WhichService, ES_Event ThisEvent ){
+  uint16_t Work = ThisEvent.EventParam;
+  uint16_t i;
+
+  for ( i = 0; i < TEST_WORK; i++ ){
+    Work = (uint16_t)(Work * 25173u + 13849u);
+  }
+  ThisEvent.EventParam = Work;
+  TestCounts[WhichService]++;
+  if ( ES_ThreadPost( (uint8_t)((WhichService + 1) % TEST_SERVICES),
+                      ThisEvent ) != true ){
+    atomic_fetch_add( &TestLost, 1 );
+  }
+  return true;
+}
+
+int main(void)
+{
+   uint16_t Sizes[TEST_SERVICES];
+   ES_Event ThisEvent;
+   struct timespec Start, End;
+   uint64_t NumEvents;
+   double Seconds;
+   double Rate;
+   double OneThreadRate = 0;
+   uint16_t NumThreads;
+   uint16_t i;
+   uint16_t Token;
+
+   for (i = 0; i < TEST_SERVICES; i++)
+   {
+      Sizes[i] = TEST_SERVICES * TEST_TOKENS; // every token can pile up
+   }
+   printf("%u services, %u events each in flight, %ld cores\n\r",
+          TEST_SERVICES, TEST_TOKENS, sysconf(_SC_NPROCESSORS_ONLN));
+   for (NumThreads = 1; NumThreads <= TEST_SERVICES; NumThreads *= 2)
+   {
+      if (ES_ThreadsInit(TEST_SERVICES, NumThreads, Sizes, TestRun) != true)
+      {
+         printf("no memory\n\r");
+         return 1;
+      }
+      ThisEvent.EventType = ES_NO_EVENT;
+      for (i = 0; i < TEST_SERVICES; i++)
+      {
+         for (Token = 0; Token < TEST_TOKENS; Token++)
+         {
+            ThisEvent.EventParam = i * TEST_TOKENS + Token;
+            ES_ThreadPost((uint8_t)i, ThisEvent);
+         }
+      }
+      memset(TestCounts, 0, sizeof(TestCounts));
+      clock_gettime(CLOCK_MONOTONIC, &Start);
+      ES_ThreadsStart();
+      sleep(TEST_SECONDS);
+      ES_ThreadsStop();
+      clock_gettime(CLOCK_MONOTONIC, &End);
+      NumEvents = 0;
+      for (i = 0; i < TEST_SERVICES; i++)
+      {
+         NumEvents += TestCounts[i];
+      }
+      Seconds = (End.tv_sec - Start.tv_sec) +
+                (End.tv_nsec - Start.tv_nsec) / 1e9;
+      Rate = NumEvents / Seconds;
+      if (NumThreads == 1)
+      {
+         OneThreadRate = Rate;
+      }
+      printf("%2u threads: %10.0f events/s  x%.2f\n\r", NumThreads, Rate,
+             Rate / OneThreadRate);
+   }
+   printf("lost posts: %u\n\r", atomic_load(&TestLost));
+   return 0;
+}
+#endif
+
+#endif /* ES_ENABLE_THREADS || TEST */
+/*------------------------------- Footnotes -------------------------------*/
+/*------------------------------ End of file ------------------------------*/
@@ -1,18 +1,57 @@
+//#define TEST
 /****************************************************************************
  Module
      ES_Timers.c
 
  Description
-     This is a module implementing  8 16 bit timers all using the RTI
-     timebase
+     This is a module implementing ES_NUM_TIMERS 32 bit timers all using the
+     RTI timebase
 
  Notes
      Everything is done in terms of RTI Ticks, which can change from
      application to application.
 
+     The active timers are kept in a list sorted by expiry time, where each
+     entry holds the number of ticks between its expiry and the expiry of
+     the entry before it (a delta list). The tick only has to decrement the
+     first entry, so it costs the same however many timers are running.
+     Starting a timer walks the list to find its place.
+
+     A periodic timer is put straight back on the list by the tick response
+     when it expires, so it keeps its phase however late the service is in
+     handling the ES_TIMEOUT. While an ES_TIMEOUT from it is still waiting
+     in a queue, further expiries are counted as missed periods rather than
+     posted, ES_Run tells us when it has been dispatched.
+
+     With ES_ENABLE_PREEMPTION a service may preempt another one (or the
+     tick response) in the middle of a change to the list, so the changes
+     are made with the scheduler locked. With ES_ENABLE_THREADS the services
+     call in from their own threads while the tick runs on the framework's,
+     and the same locks take the critical region lock instead. The locks
+     compile out otherwise.
+
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/17/26 22:00 afb      a periodic timeout that could not be posted counts
+                         as missed rather than leaving the timer waiting for
+                         a dispatch that never comes, and restarting a
+                         periodic timer clears the pending flag
+ 10/17/26 21:00 afb      trace the timeouts, see ES_Trace.h
+ 10/17/26 20:30 afb      added ES_Timer_Ticks_Resp, the tick response's
+                         event is no longer static (the nodes share it) and
+                         ES_Timer_Init clears every timer, so it can restart
+ 10/17/26 20:00 afb      moved the active list into TimerVars_t, one per node
+                         with ES_ENABLE_NODES
+ 10/17/26 19:30 afb      lock ES_Timer_TimeoutDispatched too, for the service
+                         threads
+ 10/17/26 19:00 afb      lock the scheduler around changes to the active list
+ 10/17/26 14:00 afb      added periodic timers
+ 10/17/26 13:30 afb      timers are 32 bits, added ES_Timer_GetTimeUs
+ 10/17/26 13:00 afb      replaced the per tick decrement of every active timer
+                         with a delta list, and made the number of timers
+                         configurable (ES_NUM_TIMERS)
+ 10/17/26 12:30 afb      added ES_Timer_GetTicksToNextExpiry for tickless idle
  10/27/14 14:02 jec      moved ticking of 'time' to ES_Port to allow it to tick
                          even while blocking. required change to ES_GetTime too
  10/20/13 10:48 jec      moved definition of BITS_PER_BYTE to ES_General.h
@@ -41,6 +80,7 @@
 ****************************************************************************/
 
 /*----------------------------- Include Files -----------------------------*/
+#include <string.h>
 #include "ES_Configure.h"
 #include "ES_Framework.h"
 #include "ES_ServiceHeaders.h"
@@ -50,47 +90,56 @@
 #include "ES_LookupTables.h"
 #include "ES_Timers.h"
 #include "ES_Port.h"
+#include "ES_Context.h"
+#include "ES_Trace.h"
 /*--------------------------- External Variables --------------------------*/
 
 /*----------------------------- Module Defines ----------------------------*/
+// marks the end of the active list
+#define NO_TIMER 0xFFFF
 
-/*------------------------------ Module Types -----------------------------*/
+// the timers that have their post functions set in ES_Configure.h
+#define NUM_CONFIGURED_TIMERS 16
 
-/*
-   the size of Tflag sets the number of timers, uint8 = 8, uint16 = 16 ...)
-   to add more timers, you will need to change the data type and modify
-   the initialization of TMR_TimerArray and TMR_MaskArray
-*/
+/*------------------------------ Module Types -----------------------------*/
 
-typedef uint16_t Tflag_t;
+typedef uint32_t Timer_t; // sets size of timers to 32 bits
 
-typedef uint16_t Timer_t; // sets size of timers to 16 bits
+typedef struct {
+   Timer_t  Time;     // ticks to count when (re)started, 0 once expired
+   Timer_t  Delta;    // while active, ticks after the timer before it
+   Timer_t  Period;   // reload value for a periodic timer, 0 for one-shot
+   uint16_t Next;     // while active, the timer after it in the list
+   uint16_t Prev;     // while active, the timer before it in the list
+   uint16_t Missed;   // periods that expired while a timeout was pending
+   bool     Active;
+   bool     TimeoutPending; // an ES_TIMEOUT is waiting to be dispatched
+} TimerEntry_t;
 
+// make sure that the timer numbers fit, and that the configured timers do
+typedef char ES_TimerCountCheck[((ES_NUM_TIMERS < NO_TIMER) &&
+                    (ES_NUM_TIMERS >= NUM_CONFIGURED_TIMERS)) ? 1 : -1];
 
 /*---------------------------- Module Functions ---------------------------*/
+static void InsertTimer( uint16_t Num, Timer_t Ticks );
+static void RemoveTimer( uint16_t Num );
 
 /*---------------------------- Module Variables ---------------------------*/
-static Timer_t TMR_TimerArray[sizeof(Tflag_t)*BITS_PER_BYTE]=
-                                            { 0x0,
-                                              0x0,
-                                              0x0,
-                                              0x0,
-                                              0x0,
-                                              0x0,
-                                              0x0,
-                                              0x0, 
-                                              0x0,
-                                              0x0,
-                                              0x0,
-                                              0x0,
-                                              0x0,
-                                              0x0,
-                                              0x0,
-                                              0x0 };
-
-static Tflag_t TMR_ActiveFlags;
-
-static pPostFunc const Timer2PostFunc[sizeof(Tflag_t)*BITS_PER_BYTE] = 
+// one set per node with ES_ENABLE_NODES (see ES_Context.h)
+typedef struct {
+   TimerEntry_t TMR_TimerArray[ES_NUM_TIMERS];
+
+   // the first (soonest to expire) active timer, set by ES_Timer_Init
+   uint16_t TMR_ActiveHead;
+} TimerVars_t;
+
+ES_CONTEXT_VARS( TimerVars_t, ES_Timers );
+#define pVars ES_CONTEXT( TimerVars_t, ES_Timers )
+
+// timers past the configured ones are bound at run time with
+// ES_Timer_SetPostFunc, until then they are TIMER_UNUSED. Every node binds
+// them the same way, so they are shared.
+static pPostFunc Timer2PostFunc[ES_NUM_TIMERS] = 
                                             { TIMER0_RESP_FUNC,
                                               TIMER1_RESP_FUNC,
                                               TIMER2_RESP_FUNC,
@@ -129,10 +178,41 @@ static pPostFunc const Timer2PostFunc[sizeof(Tflag_t)*BITS_PER_BYTE] =
 ****************************************************************************/
 void ES_Timer_Init(TimerRate_t Rate)
 {
+   // no timers are running yet, even if this is a restart (ES_Sim)
+   memset(pVars->TMR_TimerArray, 0, sizeof(pVars->TMR_TimerArray));
+   pVars->TMR_ActiveHead = NO_TIMER;
    // call the hardware init routine
    _HW_Timer_Init(Rate);
 }
 
+/****************************************************************************
+ Function
+     ES_Timer_SetPostFunc
+ Parameters
+     uint16_t Num, the number of the timer to bind
+     pPostFunc PostFunc, the post function to call when it expires, or
+        TIMER_UNUSED
+ Returns
+     ES_Timer_ERR if requested timer does not exist or is running
+     ES_Timer_OK  otherwise
+ Description
+     binds a timer to the service that should get its ES_TIMEOUT events.
+     This is how the timers past the 16 set up with TIMERn_RESP_FUNC in
+     ES_Configure.h get used.
+ Notes
+     call it from the service's init function
+ Author
+     Drew Bell, 10/17/26 13:00
+****************************************************************************/
+ES_TimerReturn_t ES_Timer_SetPostFunc(uint16_t Num, pPostFunc PostFunc)
+{
+   if( (Num >= ES_NUM_TIMERS) ||
+       (pVars->TMR_TimerArray[Num].Active) )
+      return ES_Timer_ERR;
+   Timer2PostFunc[Num] = PostFunc;
+   return ES_Timer_OK;
+}
+
 /****************************************************************************
  Function
      ES_Timer_SetTimer
@@ -145,19 +225,27 @@ void ES_Timer_Init(TimerRate_t Rate)
  Description
      sets the time for a timer, but does not make it active.
  Notes
-     None.
+     as before, setting the time on a running timer changes the time left
+     on it
  Author
      J. Edward Carryer, 02/24/97 17:11
 ****************************************************************************/
-ES_TimerReturn_t ES_Timer_SetTimer(uint8_t Num, uint16_t NewTime)
+ES_TimerReturn_t ES_Timer_SetTimer(uint16_t Num, uint32_t NewTime)
 {
    /* tried to set a timer that doesn't exist */
-   if( (Num >= ARRAY_SIZE(TMR_TimerArray)) ||
+   if( (Num >= ES_NUM_TIMERS) ||
    /* tried to set a timer without a service */
        (Timer2PostFunc[Num] == TIMER_UNUSED) ||
        (NewTime == 0) ) /* no time being set */
       return ES_Timer_ERR;  
-   TMR_TimerArray[Num] = NewTime;
+   ES_SCHED_LOCK();
+   pVars->TMR_TimerArray[Num].Time = NewTime;
+   if (pVars->TMR_TimerArray[Num].Active)
+   {
+      RemoveTimer(Num);
+      InsertTimer(Num, NewTime);
+   }
+   ES_SCHED_UNLOCK();
    return ES_Timer_OK;
 }
 
@@ -169,21 +257,26 @@ ES_TimerReturn_t ES_Timer_SetTimer(uint8_t Num, uint16_t NewTime)
  Returns
      ES_Timer_ERR for error ES_Timer_OK for success
  Description
-     simply sets the active flag in TMR_ActiveFlags to (re)start a
-     stopped timer.
+     (re)starts a stopped timer with the time that it had left.
  Notes
-     None.
+     starting a timer that is already running leaves it alone
  Author
      J. Edward Carryer, 02/24/97 14:45
 ****************************************************************************/
-ES_TimerReturn_t ES_Timer_StartTimer(uint8_t Num)
+ES_TimerReturn_t ES_Timer_StartTimer(uint16_t Num)
 {
    /* tried to set a timer that doesn't exist */
-   if( (Num >= ARRAY_SIZE(TMR_TimerArray)) ||
+   if( (Num >= ES_NUM_TIMERS) ||
        /* tried to set a timer with no time on it */
-       (TMR_TimerArray[Num] == 0) )
+       (pVars->TMR_TimerArray[Num].Time == 0) )
       return ES_Timer_ERR;  
-   TMR_ActiveFlags |= BitNum2SetMask[Num]; /* set timer as active */
+   ES_SCHED_LOCK();
+   if (!pVars->TMR_TimerArray[Num].Active)
+   {
+      /* set timer as active */
+      InsertTimer(Num, pVars->TMR_TimerArray[Num].Time);
+   }
+   ES_SCHED_UNLOCK();
    return ES_Timer_OK;
 }
 
@@ -195,18 +288,33 @@ ES_TimerReturn_t ES_Timer_StartTimer(uint8_t Num)
  Returns
      ES_Timer_ERR for error (timer doesn't exist) ES_Timer_OK for success.
  Description
-     simply clears the bit in TMR_ActiveFlags associated with this
-     timer. This will cause it to stop counting.
+     takes the timer out of the active list, remembering how much time it
+     had left so that ES_Timer_StartTimer can resume it.
  Notes
-     None.
+     finding the time left means walking the list up to the timer
  Author
      J. Edward Carryer, 02/24/97 14:48
 ****************************************************************************/
-ES_TimerReturn_t ES_Timer_StopTimer(uint8_t Num)
+ES_TimerReturn_t ES_Timer_StopTimer(uint16_t Num)
 {
-   if( Num >= ARRAY_SIZE(TMR_TimerArray) )
+   uint16_t ThisTimer;
+   Timer_t TimeLeft = 0;
+
+   if( Num >= ES_NUM_TIMERS )
       return ES_Timer_ERR;  /* tried to set a timer that doesn't exist */
-   TMR_ActiveFlags &= BitNum2ClrMask[Num]; /* set timer as inactive */
+   ES_SCHED_LOCK();
+   if (pVars->TMR_TimerArray[Num].Active)
+   {
+      for (ThisTimer = pVars->TMR_ActiveHead; ThisTimer != Num;
+           ThisTimer = pVars->TMR_TimerArray[ThisTimer].Next)
+      {
+         TimeLeft += pVars->TMR_TimerArray[ThisTimer].Delta;
+      }
+      pVars->TMR_TimerArray[Num].Time =
+          TimeLeft + pVars->TMR_TimerArray[Num].Delta;
+      RemoveTimer(Num); /* set timer as inactive */
+   }
+   ES_SCHED_UNLOCK();
    return ES_Timer_OK;
 }
 
@@ -226,20 +334,117 @@ ES_TimerReturn_t ES_Timer_StopTimer(uint8_t Num)
  Author
      J. Edward Carryer, 02/24/97 14:51
 ****************************************************************************/
-ES_TimerReturn_t ES_Timer_InitTimer(uint8_t Num, uint16_t NewTime)
+ES_TimerReturn_t ES_Timer_InitTimer(uint16_t Num, uint32_t NewTime)
 {
    /* tried to set a timer that doesn't exist */
-   if( (Num >= ARRAY_SIZE(TMR_TimerArray)) ||
+   if( (Num >= ES_NUM_TIMERS) ||
    /* tried to set a timer without a service */
        (Timer2PostFunc[Num] == TIMER_UNUSED) ||
        /* tried to set a timer without putting any time on it */
        (NewTime == 0) )
       return ES_Timer_ERR;  
-   TMR_TimerArray[Num] = NewTime;
-   TMR_ActiveFlags |= BitNum2SetMask[Num]; /* set timer as active */
+   ES_SCHED_LOCK();
+   pVars->TMR_TimerArray[Num].Time = NewTime;
+   pVars->TMR_TimerArray[Num].Period = 0; /* one-shot */
+   if (pVars->TMR_TimerArray[Num].Active)
+   {
+      RemoveTimer(Num);
+   }
+   InsertTimer(Num, NewTime); /* set timer as active */
+   ES_SCHED_UNLOCK();
    return ES_Timer_OK;
 }
 
+/****************************************************************************
+ Function
+     ES_Timer_InitPeriodicTimer
+ Parameters
+     uint16_t Num, the number of the timer to start
+     uint32_t Period, the number of ticks between timeouts
+ Returns
+     ES_Timer_ERR if the requested timer does not exist, ES_Timer_OK otherwise.
+ Description
+     starts the timer counting, it will post an ES_TIMEOUT every Period
+     ticks until it is stopped or re-initialized with ES_Timer_InitTimer
+ Notes
+     the timer is reloaded in the tick response, so the timeouts keep to
+     a fixed phase from now. If the last ES_TIMEOUT from this timer has not
+     been dispatched yet when it expires again, no event is posted and the
+     period is counted as missed instead (see ES_Timer_GetMissedPeriods).
+ Author
+     Drew Bell, 10/17/26 14:00
+****************************************************************************/
+ES_TimerReturn_t ES_Timer_InitPeriodicTimer(uint16_t Num, uint32_t Period)
+{
+   ES_TimerReturn_t Result;
+
+   ES_SCHED_LOCK(); /* so that it can't expire as a one-shot */
+   Result = ES_Timer_InitTimer(Num, Period);
+   if (Result == ES_Timer_OK)
+   {
+      pVars->TMR_TimerArray[Num].Period = Period;
+      pVars->TMR_TimerArray[Num].Missed = 0;
+      pVars->TMR_TimerArray[Num].TimeoutPending = false;
+   }
+   ES_SCHED_UNLOCK();
+   return Result;
+}
+
+/****************************************************************************
+ Function
+     ES_Timer_GetMissedPeriods
+ Parameters
+     uint16_t Num, the number of the periodic timer to check
+ Returns
+     uint16_t the number of periods that expired without an ES_TIMEOUT being
+     posted since the last call, because the service was still behind
+ Description
+     lets a service that handles a periodic timeout catch up on the periods
+     that it fell behind by
+ Notes
+     reading the count clears it. The count sticks at 0xFFFF.
+ Author
+     Drew Bell, 10/17/26 14:00
+****************************************************************************/
+uint16_t ES_Timer_GetMissedPeriods(uint16_t Num)
+{
+   uint16_t Missed;
+
+   if (Num >= ES_NUM_TIMERS)
+      return 0;
+   ES_SCHED_LOCK();
+   Missed = pVars->TMR_TimerArray[Num].Missed;
+   pVars->TMR_TimerArray[Num].Missed = 0;
+   ES_SCHED_UNLOCK();
+   return Missed;
+}
+
+/****************************************************************************
+ Function
+     ES_Timer_TimeoutDispatched
+ Parameters
+     uint16_t Num, the timer number from the EventParam of the ES_TIMEOUT
+ Returns
+     None.
+ Description
+     called by ES_Run as it hands an ES_TIMEOUT to a service, so that the
+     next period of a periodic timer gets posted
+ Notes
+     ES_TIMEOUTs from other sources (ES_PostAll, test harnesses) may have
+     any EventParam, so anything that is not a timer is ignored
+ Author
+     Drew Bell, 10/17/26 14:00
+****************************************************************************/
+void ES_Timer_TimeoutDispatched(uint16_t Num)
+{
+   if (Num < ES_NUM_TIMERS)
+   {
+      ES_SCHED_LOCK(); /* the tick reads it, maybe from another thread */
+      pVars->TMR_TimerArray[Num].TimeoutPending = false;
+      ES_SCHED_UNLOCK();
+   }
+}
+
 
 /****************************************************************************
  Function
@@ -262,6 +467,54 @@ uint16_t ES_Timer_GetTime(void)
    return (_HW_GetTickCount());
 }
 
+/****************************************************************************
+ Function
+     ES_Timer_GetTimeUs
+ Parameters
+     None.
+ Returns
+     uint64_t microseconds since the framework was initialized
+ Description
+     a monotonic time with microsecond resolution that will not wrap, for
+     measuring intervals without any wrap handling
+ Notes
+     the port combines the tick count with the tick hardware's count within
+     the current tick
+ Author
+     Drew Bell, 10/17/26 13:30
+****************************************************************************/
+uint64_t ES_Timer_GetTimeUs(void)
+{
+   return (_HW_GetTimeUs());
+}
+
+/****************************************************************************
+ Function
+     ES_Timer_GetTicksToNextExpiry
+ Parameters
+     None.
+ Returns
+     uint32_t the number of ticks until the next active timer expires, or
+     ES_TIMER_NO_EXPIRY if no timer is active
+ Description
+     lets the port know how long it may stop the tick for while idle
+ Notes
+     a timer with n ticks left expires on the n'th call to
+     ES_Timer_Tick_Resp, so the port may skip n-1 tick interrupts as long as
+     it makes all n calls when it wakes up.
+     The first timer in the active list is the next to expire.
+ Author
+     Drew Bell, 10/17/26 12:30
+****************************************************************************/
+uint32_t ES_Timer_GetTicksToNextExpiry(void)
+{
+   if (pVars->TMR_ActiveHead == NO_TIMER)
+   {
+      return ES_TIMER_NO_EXPIRY;
+   }
+   return pVars->TMR_TimerArray[pVars->TMR_ActiveHead].Delta;
+}
+
 /****************************************************************************
  Function
      ES_Timer_Tick_Resp
@@ -271,45 +524,345 @@ uint16_t ES_Timer_GetTime(void)
      None.
  Description
      This is the new Tick response routine to support the timer module.
-     It will increment time, to maintain the functionality of the
-     GetTime() timer and it will check through the active timers,
-     decrementing each active timers count, if the count goes to 0, it
-     will post an event to the corresponding SM and clear the active flag to
-     prevent further counting.
+     It counts down the first timer in the active list. When that gets to
+     0, it and any timers after it with no time left (those that expire on
+     the same tick) are taken off the list and an ES_TIMEOUT event is posted
+     to the corresponding SM for each of them. Periodic timers go straight
+     back on the list for the next period.
  Notes
      Called from _Timer_Int_Resp in ES_Port.c.
+     Timers that expire on the same tick post in the order they were
+     started. Each timer is off the list before its event is posted, so
+     the post function may restart it. With ES_ENABLE_PREEMPTION, the
+     services that the timeouts go to run once the last one is posted.
  Author
      J. Edward Carryer, 02/24/97 15:06
 ****************************************************************************/
 void ES_Timer_Tick_Resp(void)
 {
-	static Tflag_t NeedsProcessing;
-	static uint8_t NextTimer2Process;
-	static ES_Event NewEvent;
+	ES_Event NewEvent;
+	uint16_t Expired;
 
-	if (TMR_ActiveFlags != 0) /* if !=0 , then at least 1 timer is active */
+	ES_SCHED_LOCK();
+	if (pVars->TMR_ActiveHead != NO_TIMER) /* then at least 1 timer is active */
 	{
-		// start by getting a list of all the active timers
-		NeedsProcessing = TMR_ActiveFlags;
-		do{
-			// find the MSB that is set
-			NextTimer2Process = ES_GetMSBitSet(NeedsProcessing);
-			/* decrement that timer, check if timed out */
-			if(--TMR_TimerArray[NextTimer2Process] == 0)
-			{
+		if (--pVars->TMR_TimerArray[pVars->TMR_ActiveHead].Delta == 0)
+		{
+			do{
+				Expired = pVars->TMR_ActiveHead;
+				RemoveTimer(Expired);
+				if (pVars->TMR_TimerArray[Expired].Period != 0)
+				{
+					/* reload for the next period */
+					InsertTimer(Expired, pVars->TMR_TimerArray[Expired].Period);
+					if (pVars->TMR_TimerArray[Expired].TimeoutPending)
+					{
+						/* the service has not seen the last one yet */
+						if (pVars->TMR_TimerArray[Expired].Missed != 0xFFFF)
+						{
+							pVars->TMR_TimerArray[Expired].Missed++;
+						}
+						continue;
+					}
+					pVars->TMR_TimerArray[Expired].TimeoutPending = true;
+				}
+				else
+				{
+					/* stop counting, and mark it as expired */
+					pVars->TMR_TimerArray[Expired].Time = 0;
+				}
 				NewEvent.EventType = ES_TIMEOUT;
-				NewEvent.EventParam = NextTimer2Process;
+				NewEvent.EventParam = Expired;
+				ES_TRACE_TIMEOUT(Expired);
 				/* post the timeout event to the right Service */
-				Timer2PostFunc[NextTimer2Process](NewEvent);
-				/* and stop counting */
-				TMR_ActiveFlags &= BitNum2ClrMask[NextTimer2Process];
-			}
-			// mark off the active timer that we just processed
-			NeedsProcessing &= BitNum2ClrMask[NextTimer2Process];
-		}while(NeedsProcessing != 0);
-      
+				if ((Timer2PostFunc[Expired](NewEvent) != true) &&
+				    (pVars->TMR_TimerArray[Expired].Period != 0))
+				{
+					/* it never got there, so nothing will dispatch it */
+					pVars->TMR_TimerArray[Expired].TimeoutPending = false;
+					if (pVars->TMR_TimerArray[Expired].Missed != 0xFFFF)
+					{
+						pVars->TMR_TimerArray[Expired].Missed++;
+					}
+				}
+			}while((pVars->TMR_ActiveHead != NO_TIMER) &&
+			       (pVars->TMR_TimerArray[pVars->TMR_ActiveHead].Delta == 0));
+		}
 	}
+	ES_SCHED_UNLOCK();
 }
+
+/****************************************************************************
+ Function
+     ES_Timer_Ticks_Resp
+ Parameters
+     uint32_t NumTicks, the number of ticks that have passed
+ Returns
+     None.
+ Description
+     the tick response for NumTicks ticks at once. The ticks up to each
+     expiry are taken off the first timer in one go, and ES_Timer_Tick_Resp
+     handles the tick that it expires on, so this takes as long as the
+     number of expiries, however many ticks there are.
+ Notes
+     the same as calling ES_Timer_Tick_Resp NumTicks times: every timeout
+     in the ticks is posted before any service runs. To have the services
+     see each timeout before the next, hand the ticks over no further than
+     ES_Timer_GetTicksToNextExpiry at a time, as ES_Sim does.
+ Author
+     Drew Bell, 10/17/26 20:30
+****************************************************************************/
+void ES_Timer_Ticks_Resp(uint32_t NumTicks)
+{
+	Timer_t ToExpiry;
+
+	while (NumTicks > 0)
+	{
+		ES_SCHED_LOCK();
+		if (pVars->TMR_ActiveHead == NO_TIMER)
+		{
+			ES_SCHED_UNLOCK();
+			return;
+		}
+		ToExpiry = pVars->TMR_TimerArray[pVars->TMR_ActiveHead].Delta;
+		if (NumTicks < ToExpiry)
+		{
+			pVars->TMR_TimerArray[pVars->TMR_ActiveHead].Delta -= NumTicks;
+			ES_SCHED_UNLOCK();
+			return;
+		}
+		/* up to the tick before the expiry, the tick response does the rest */
+		pVars->TMR_TimerArray[pVars->TMR_ActiveHead].Delta = 1;
+		ES_SCHED_UNLOCK();
+		NumTicks -= ToExpiry;
+		ES_Timer_Tick_Resp();
+	}
+}
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+/****************************************************************************
+ Function
+     InsertTimer
+ Parameters
+     uint16_t Num, the timer to make active
+     Timer_t Ticks, the number of ticks until it expires, must be > 0
+ Returns
+     None.
+ Description
+     walks the active list to the last timer that expires no later than
+     this one and links it in after it, taking the deltas before it off
+     Ticks and its delta off the timer after it
+ Notes
+     a timer that expires on the same tick as an earlier one goes after it,
+     with a delta of 0
+ Author
+     Drew Bell, 10/17/26 13:00
+****************************************************************************/
+static void InsertTimer( uint16_t Num, Timer_t Ticks )
+{
+   uint16_t Before = NO_TIMER;
+   uint16_t After = pVars->TMR_ActiveHead;
+
+   while ((After != NO_TIMER) && (pVars->TMR_TimerArray[After].Delta <= Ticks))
+   {
+      Ticks -= pVars->TMR_TimerArray[After].Delta;
+      Before = After;
+      After = pVars->TMR_TimerArray[After].Next;
+   }
+   pVars->TMR_TimerArray[Num].Delta = Ticks;
+   pVars->TMR_TimerArray[Num].Prev = Before;
+   pVars->TMR_TimerArray[Num].Next = After;
+   pVars->TMR_TimerArray[Num].Active = true;
+   if (Before == NO_TIMER)
+   {
+      pVars->TMR_ActiveHead = Num;
+   }
+   else
+   {
+      pVars->TMR_TimerArray[Before].Next = Num;
+   }
+   if (After != NO_TIMER)
+   {
+      pVars->TMR_TimerArray[After].Prev = Num;
+      pVars->TMR_TimerArray[After].Delta -= Ticks;
+   }
+}
+
+/****************************************************************************
+ Function
+     RemoveTimer
+ Parameters
+     uint16_t Num, the active timer to take off the list
+ Returns
+     None.
+ Description
+     unlinks the timer, passing its delta on to the timer after it so that
+     that one still expires at the same time
+ Notes
+
+ Author
+     Drew Bell, 10/17/26 13:00
+****************************************************************************/
+static void RemoveTimer( uint16_t Num )
+{
+   uint16_t Before = pVars->TMR_TimerArray[Num].Prev;
+   uint16_t After = pVars->TMR_TimerArray[Num].Next;
+
+   if (Before == NO_TIMER)
+   {
+      pVars->TMR_ActiveHead = After;
+   }
+   else
+   {
+      pVars->TMR_TimerArray[Before].Next = After;
+   }
+   if (After != NO_TIMER)
+   {
+      pVars->TMR_TimerArray[After].Prev = Before;
+      pVars->TMR_TimerArray[After].Delta += pVars->TMR_TimerArray[Num].Delta;
+   }
+   pVars->TMR_TimerArray[Num].Active = false;
+}
+
+#ifdef TEST
+/* test harness for the timer engine, runs on the host. With TEST defined
+   at the top of this file:
+   gcc -std=gnu99 -O2 -DES_PORT_POSIX -IHeaders Source/ES_Timers.c
+       Source/ES_LookupTables.c -o timer_test
+   Starts ES_NUM_TIMERS timers with scattered times, checks that every one
+   expires on exactly the right tick and reports the cost of a tick, once
+   ticking one at a time and once jumping from expiry to expiry with
+   ES_Timer_Ticks_Resp.
+   Timers 0, 1 & 2 are periodic, the timeouts from timer 0 are dispatched
+   at once and those from timer 1 never are, so it should miss every period
+   after the first. The posts from timer 2 fail, so it should still post
+   every period, and count each one as missed.
+   Set ES_NUM_TIMERS to a few hundred in ES_Configure.h to load it up.
+*/
+#include <stdio.h>
+#include <time.h>
+
+// long enough that some of the timers need more than 16 bits
+#define TEST_TICKS 100000UL
+
+static uint32_t TicksSoFar;
+static uint32_t NumExpired;
+static uint32_t NumWrong;
+static uint32_t ExpectedTick[ES_NUM_TIMERS];
+
+#define PERIOD0 50
+#define PERIOD1 30
+#define PERIOD2 70
+#define NUM_PERIODIC 3
+static uint32_t NumPeriodic[NUM_PERIODIC];
+
+static bool TestPost( ES_Event ThisEvent )
+{
+   if (ThisEvent.EventParam < NUM_PERIODIC)
+   {
+      NumPeriodic[ThisEvent.EventParam]++;
+      if (ThisEvent.EventParam == 2)
+      {
+         return false; /* as if its queue were full */
+      }
+      if (ThisEvent.EventParam == 0)
+      {
+         ES_Timer_TimeoutDispatched(0);
+         if ((TicksSoFar % PERIOD0) != 0)
+         {
+            NumWrong++;
+         }
+      }
+      return true;
+   }
+   NumExpired++;
+   if (ExpectedTick[ThisEvent.EventParam] != TicksSoFar)
+   {
+      NumWrong++;
+   }
+   return true;
+}
+
+// the test does not need the tick or the services
+void _HW_Timer_Init(TimerRate_t Rate) { (void)Rate; }
+uint16_t _HW_GetTickCount(void) { return (uint16_t)TicksSoFar; }
+uint64_t _HW_GetTimeUs(void) { return TicksSoFar * 1000ULL; }
+
+// one run of the test, a tick at a time or, InBulk, straight from one
+// expiry to the next with ES_Timer_Ticks_Resp. true if it all came out right
+static bool RunTest( bool InBulk )
+{
+   uint16_t Num;
+   uint16_t Missed;
+   uint32_t Step;
+   struct timespec Start, End;
+   double TickNs;
+
+   TicksSoFar = 0;
+   NumExpired = 0;
+   NumWrong = 0;
+   NumPeriodic[0] = NumPeriodic[1] = NumPeriodic[2] = 0;
+   ES_Timer_Init(ES_Timer_RATE_1mS);
+   for (Num = 0; Num < ES_NUM_TIMERS; Num++)
+   {
+      ES_Timer_SetPostFunc(Num, TestPost);
+      ExpectedTick[Num] = 1 + (Num * 7919UL) % TEST_TICKS;
+      ES_Timer_InitTimer(Num, ExpectedTick[Num]);
+   }
+   ES_Timer_InitPeriodicTimer(0, PERIOD0);
+   ES_Timer_InitPeriodicTimer(1, PERIOD1);
+   ES_Timer_InitPeriodicTimer(2, PERIOD2);
+   // stop and resume a few on the way, they should still expire on time
+   for (Num = 5; Num < ES_NUM_TIMERS; Num += 5)
+   {
+      ES_Timer_StopTimer(Num);
+      ES_Timer_StartTimer(Num);
+   }
+   clock_gettime(CLOCK_MONOTONIC, &Start);
+   while (TicksSoFar < TEST_TICKS)
+   {
+      if (InBulk)
+      {
+         Step = ES_Timer_GetTicksToNextExpiry();
+         if (Step > TEST_TICKS - TicksSoFar)
+         {
+            Step = TEST_TICKS - TicksSoFar;
+         }
+         TicksSoFar += Step;
+         ES_Timer_Ticks_Resp(Step);
+      }
+      else
+      {
+         TicksSoFar++;
+         ES_Timer_Tick_Resp();
+      }
+   }
+   clock_gettime(CLOCK_MONOTONIC, &End);
+   TickNs = ((End.tv_sec - Start.tv_sec) * 1e9 + (End.tv_nsec - Start.tv_nsec))
+            / TicksSoFar;
+   printf("%s: %u timers, %lu expired, %lu on the wrong tick, %.1f ns/tick\n",
+          InBulk ? "in bulk" : "by tick", ES_NUM_TIMERS,
+          (unsigned long)NumExpired, (unsigned long)NumWrong, TickNs);
+   Missed = ES_Timer_GetMissedPeriods(2);
+   printf("periodic: %lu timeouts from timer 0, %lu from timer 1 which "
+          "missed %u, %lu failed posts from timer 2 which missed %u\n",
+          (unsigned long)NumPeriodic[0], (unsigned long)NumPeriodic[1],
+          ES_Timer_GetMissedPeriods(1), (unsigned long)NumPeriodic[2], Missed);
+   return (NumWrong == 0) && (NumExpired == ES_NUM_TIMERS - NUM_PERIODIC) &&
+          (NumPeriodic[0] == TEST_TICKS / PERIOD0) && (NumPeriodic[1] == 1) &&
+          (NumPeriodic[2] == TEST_TICKS / PERIOD2) &&
+          (Missed == TEST_TICKS / PERIOD2);
+}
+
+int main(void)
+{
+   bool ByTickOK = RunTest(false);
+   bool InBulkOK = RunTest(true);
+
+   return !(ByTickOK && InBulkOK);
+}
+#endif
 /*------------------------------- Footnotes -------------------------------*/
 /*------------------------------ End of file ------------------------------*/
-
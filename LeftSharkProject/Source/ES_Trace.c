@@ -0,0 +1,182 @@
+/****************************************************************************
+ Module
+     ES_Trace.c
+
+ Description
+     This module keeps a binary trace of the last ES_TRACE_SIZE posts,
+     dispatches and timeouts, and dumps it over the console.
+
+ Notes
+     The hooks in ES_Framework.c and ES_Timers.c call ES_TraceWrite, which
+     takes the next record number with _HW_AtomicFetchInc32 and fills in the
+     record in the slot for it. Posts from the interrupt responses get their
+     own slots that way, without a critical region.
+
+     The ring is in ES_NOINIT memory, so it is still there after a reset
+     that did not take the power away. ES_TraceInit keeps it if the magic
+     number and the size in it are right, and otherwise clears it.
+
+     While ES_TraceDump is sending the ring, writes are dropped rather than
+     let them overwrite records that have not gone out yet.
+
+     The whole module compiles to nothing unless ES_ENABLE_TRACE is defined
+     in ES_Configure.h
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/17/26 21:00 afb      Began Coding
+****************************************************************************/
+
+/*----------------------------- Include Files -----------------------------*/
+#include "ES_Configure.h"
+#include "ES_Trace.h"
+
+#ifdef ES_ENABLE_TRACE
+
+#include <stdio.h>
+#include <string.h>
+
+/*--------------------------- External Variables --------------------------*/
+
+/*----------------------------- Module Defines ----------------------------*/
+// marks a ring that ES_TraceInit set up, rather than what the RAM powered
+// up with
+#define TRACE_MAGIC 0x54524345UL
+
+/*------------------------------ Module Types -----------------------------*/
+typedef struct {
+    uint32_t Magic;
+    uint32_t Size;
+    ES_Atomic32_t Head;  // records written since the ring was cleared
+    ES_TraceRecord_t Records[ES_TRACE_SIZE];
+}TraceRing_t;
+
+/*---------------------------- Module Functions ---------------------------*/
+static void PutWord16( uint16_t Word );
+static void PutWord32( uint32_t Word );
+
+/*---------------------------- Module Variables ---------------------------*/
+static ES_NOINIT TraceRing_t Ring;
+
+// set while ES_TraceDump is sending the ring
+static volatile bool Frozen;
+
+/*------------------------------ Module Code ------------------------------*/
+/****************************************************************************
+ Function
+     ES_TraceInit
+ Parameters
+     none
+ Returns
+     none
+ Description
+     starts the cycle counter, keeps or clears the ring and records the reset
+ Notes
+     called from ES_Initialize
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+void ES_TraceInit( void ){
+  _HW_CycleCounterInit();
+  if ( ( Ring.Magic != TRACE_MAGIC ) || ( Ring.Size != ES_TRACE_SIZE ) ){
+    memset(Ring.Records, 0, sizeof(Ring.Records));
+    Ring.Head = 0;
+    Ring.Size = ES_TRACE_SIZE;
+    Ring.Magic = TRACE_MAGIC;
+  }
+  Frozen = false;
+  ES_TraceWrite( ES_TRACE_RESET, 0, 0, 0 );
+}
+
+/****************************************************************************
+ Function
+     ES_TraceWrite
+ Parameters
+     ES_TraceKind_t Kind, what happened
+     uint8_t Service, the service that it happened to, or the timer
+     uint16_t EventType, uint16_t EventParam, the event
+ Returns
+     none
+ Description
+     adds a record to the ring, over the oldest one
+ Notes
+     may be called from the interrupt responses. Use the ES_TRACE_ macros
+     (ES_Trace.h) rather than calling this directly.
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+void ES_TraceWrite( ES_TraceKind_t Kind, uint8_t Service,
+                    uint16_t EventType, uint16_t EventParam ){
+  uint32_t RecordNum;
+  ES_TraceRecord_t * pRecord;
+
+  if ( Frozen ){
+    return;
+  }
+  RecordNum = _HW_AtomicFetchInc32( &Ring.Head );
+  pRecord = &Ring.Records[RecordNum & ( ES_TRACE_SIZE - 1 )];
+  pRecord->Stamp = _HW_GetCycleCount();
+  pRecord->EventType = EventType;
+  pRecord->EventParam = EventParam;
+  pRecord->Seq = (uint16_t)RecordNum;
+  pRecord->Service = Service;
+  pRecord->Kind = (uint8_t)Kind;
+}
+
+/****************************************************************************
+ Function
+     ES_TraceDump
+ Parameters
+     none
+ Returns
+     none
+ Description
+     sends the ring over the console, in the binary format that is laid out
+     in ES_Trace.h
+ Notes
+     blocks until the whole ring has gone out, about 1.5kB with the default
+     ES_TRACE_SIZE. Anything that happens in the meantime is not recorded.
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+void ES_TraceDump( void ){
+  uint16_t i;
+  ES_TraceRecord_t const * pRecord;
+
+  Frozen = true;
+  for ( i = 0; i < ES_TRACE_SYNC_LEN; i++ ){
+    putchar(ES_TRACE_SYNC[i]);
+  }
+  PutWord32(ES_TRACE_SIZE);
+  PutWord32(Ring.Head);
+  PutWord32(ES_CYCLE_COUNT_HZ);
+  for ( i = 0; i < ES_TRACE_SIZE; i++ ){
+    pRecord = &Ring.Records[i];
+    PutWord32(pRecord->Stamp);
+    PutWord16(pRecord->EventType);
+    PutWord16(pRecord->EventParam);
+    PutWord16(pRecord->Seq);
+    putchar(pRecord->Service);
+    putchar(pRecord->Kind);
+  }
+  fflush(stdout);
+  Frozen = false;
+}
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+
+// the dump is little endian whatever the port is
+static void PutWord16( uint16_t Word ){
+  putchar(Word & 0xFF);
+  putchar(Word >> 8);
+}
+
+static void PutWord32( uint32_t Word ){
+  PutWord16((uint16_t)(Word & 0xFFFF));
+  PutWord16((uint16_t)(Word >> 16));
+}
+
+#endif /* ES_ENABLE_TRACE */
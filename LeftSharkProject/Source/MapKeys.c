@@ -13,6 +13,11 @@
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/17/26 22:00 afb      '1' passes the start delimiter itself, RxSM now
+                         stores each byte from the EventParam
+ 10/17/26 21:00 afb      'T' dumps the event trace with ES_ENABLE_TRACE
+ 10/17/26 20:00 afb      MyPriority kept in MapKeysVars_t, one per node with
+                         ES_ENABLE_NODES
  02/06/14 14:44 jec      tweaked to be a more generic key-mapper
  02/07/12 00:00 jec      converted to service for use with E&S Gen2
  02/20/07 21:37 jec      converted to use enumerated type for events
@@ -23,6 +28,8 @@
 #include <ctype.h>
 #include "ES_Configure.h"
 #include "ES_Framework.h"
+#include "ES_Context.h"
+#include "ES_Trace.h"
 #include "MapKeys.h"
 #include "RxSM.h"
 
@@ -37,8 +44,13 @@
 
 
 /*---------------------------- Module Variables ---------------------------*/
-// with the introduction of Gen2, we need a module level Priority variable
-static uint8_t MyPriority;
+typedef struct {
+  // with the introduction of Gen2, we need a module level Priority variable
+  uint8_t MyPriority;
+} MapKeysVars_t;
+
+ES_CONTEXT_VARS( MapKeysVars_t, MapKeys );
+#define pVars ES_CONTEXT( MapKeysVars_t, MapKeys )
 
 
 /*------------------------------ Module Code ------------------------------*/
@@ -62,7 +74,7 @@ static uint8_t MyPriority;
 ****************************************************************************/
 bool InitMapKeys ( uint8_t Priority )
 {
-  MyPriority = Priority;
+  pVars->MyPriority = Priority;
 
   return true;
 }
@@ -86,7 +98,7 @@ bool InitMapKeys ( uint8_t Priority )
 ****************************************************************************/
 bool PostMapKeys( ES_Event ThisEvent )
 {
-  return ES_PostToService( MyPriority, ThisEvent);
+  return ES_PostToService( pVars->MyPriority, ThisEvent);
 }
 
 
@@ -125,6 +137,7 @@ ES_Event RunMapKeys( ES_Event ThisEvent )
         {
           
             case '1' : ThisEvent.EventType = ES_0x7E_RECEIVED; 
+                       ThisEvent.EventParam = 0x7E; //the start delimiter
                        break;
             case '2' : ThisEvent.EventType = ES_BYTE_RECEIVED; 
                        ThisEvent.EventParam = 0;    //send MSB length
@@ -137,6 +150,10 @@ ES_Event RunMapKeys( ES_Event ThisEvent )
                        break;
             case 'E' : ThisEvent.EventType = ES_UART_ERROR_FLAG; 
                        break;		
+#ifdef ES_ENABLE_TRACE
+            case 'T' : ES_TraceDump(); // binary, see Tools/ES_TraceDecode.c
+                       break;
+#endif
             
 						
         }
@@ -1,3 +1,4 @@
+//#define TEST
 /****************************************************************************
  Module
    RxSM.c
@@ -16,6 +17,25 @@
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/17/26 22:30 afb     PrintRxDataPacket only walks the packet when the
+                        byte logs are compiled in, and the byte logs take
+                        the byte from the event as well
+ 10/17/26 22:00 afb     the states take each byte from the EventParam, as
+                        RunRxBytes passes it, rather than from RxDataByte
+                        which only RxISR sets. Added a host test.
+ 10/17/26 21:30 afb     log through ES_Log instead of printf, the test prints
+                        are ES_LOG_DEBUG statements now
+ 10/17/26 20:00 afb     module variables kept in RxSMVars_t, one set per
+                        node with ES_ENABLE_NODES
+ 10/17/26 18:00 afb     RxISR hands good bytes to an ES_Coalescer, so that a
+                        burst of bytes takes one queue slot (ES_RX_BYTES)
+ 10/17/26 17:30 afb     publish ES_PACKET_RECEIVED to its subscribers instead
+                        of posting it to DIST_LIST0
+ 10/17/26 16:00 afb     RxISR posts through an ISR queue so that it no longer
+                        turns interrupts off for every byte
+ 10/17/26 15:00 afb     assemble packets in ES_Payload buffers and post them
+                        to DIST_LIST0 as ES_PACKET_RECEIVED
+ 10/17/26 09:45 afb     kept the UART hardware out of the POSIX host build
  05/11/17 11:12 afb     Starting Module
  
 ****************************************************************************/
@@ -25,11 +45,17 @@
 */
 #include "ES_Configure.h"
 #include "ES_Framework.h"
+#include "ES_Payload.h"
+#include "ES_Coalesce.h"
+#include "ES_Context.h"
+#include "ES_Log.h"
+#ifndef ES_PORT_POSIX
 #include "inc/hw_uart.h"
 #include "inc/hw_types.h"
 #include "inc/hw_memmap.h"
-#include "RxSM.h"
 #include "HardwareInits.h"
+#endif
+#include "RxSM.h"
 
 /*----------------------------- Module Defines ----------------------------*/
 
@@ -40,9 +66,12 @@
 #define ALL_BITS_HI     0xFF
 #define LONGEST_PACKET_LENGTH   0x96    // placeholder for longest packet length
 #define NUM_OVERHEAD_BYTES  4           // counts start delimiter, MSB length, LSB length, ChkSum
+#define RX_ISR_QUEUE_SIZE   4           // must be a power of 2, only the error events use it now
+#define RX_BYTE_RING_SIZE   64          // must be a power of 2, bytes that can build up between runs
+#define RX_TAKE_SIZE        16          // bytes taken from the ring at a time
 
 //ifdef defines
-//#define RxTestPrints
+// (the state changes are logged at ES_LOG_LEVEL_DEBUG, see ES_Configure.h)
 #define PrintRecdPacket
 
 
@@ -53,33 +82,52 @@
 
 void ClearRxVars (void);
 void PrintUARTErrors (void);
-void ClearRxDataPacket ( void );
+bool ClearRxDataPacket ( void );
+void PrintRxDataPacket ( uint16_t Packet );
+ES_Event RunRxBytes ( void );
 
 /*---------------------------- Module Variables ---------------------------*/
-// everybody needs a state variable, you may need others as well.
-// type of state variable should match that of enum in header file
-static RxState_t CurrentState;
-static uint8_t FrameLengthMSB = 0;
-static uint8_t FrameLengthLSB = 0;
-static uint8_t PacketLength = 0;
-static uint16_t BytesLeft = 0;
-static uint16_t RxArrayIndex = 0;      //which byte we are working with in the RxDataPacket array
-static uint8_t RxInterruptBit = 0; 
-static uint8_t OverRunBit = 0;
-static uint8_t BreakErrorBit = 0;
-static uint8_t ParityErrorBit = 0;
-static uint8_t FramingErrorBit = 0;
-static uint8_t ChkSum = 0;
-static uint8_t XbeeChkSum = 0;
-static uint8_t RxDataByte = 0;
-
-//The RxDataPacket is an array of 8-bit bytes that includes the Xbee start delimiter, two length bits, frame data,
-// and checksum.  
-static uint8_t RxDataPacket[LONGEST_PACKET_LENGTH]; 
-
-
-// with the introduction of Gen2, we need a module level Priority var as well
-static uint8_t MyPriority;
+// all of them in one struct, one per node with ES_ENABLE_NODES (see ES_Context.h)
+typedef struct {
+  // everybody needs a state variable, you may need others as well.
+  // type of state variable should match that of enum in header file
+  RxState_t CurrentState;
+  uint8_t FrameLengthMSB;
+  uint8_t FrameLengthLSB;
+  uint8_t PacketLength;
+  uint16_t BytesLeft;
+  uint16_t RxArrayIndex;      //which byte we are working with in the RxDataPacket array
+  uint8_t RxInterruptBit;
+  uint8_t OverRunBit;
+  uint8_t BreakErrorBit;
+  uint8_t ParityErrorBit;
+  uint8_t FramingErrorBit;
+  uint8_t ChkSum;
+  uint8_t XbeeChkSum;
+  uint8_t RxDataByte;          // RxISR's, the states take the byte from the event
+
+  //The RxDataPacket is an array of 8-bit bytes that includes the Xbee start delimiter, two length bits, frame data,
+  // and checksum. It is the data of the ES_Payload buffer RxPacket, which we hold until the packet is posted.
+  uint16_t RxPacket;
+  uint8_t *RxDataPacket;
+
+  // with the introduction of Gen2, we need a module level Priority var as well
+  uint8_t MyPriority;
+
+  // RxISR is the only poster to this queue, so it can post without turning interrupts off
+  ES_Event RxISRSlots[RX_ISR_QUEUE_SIZE];
+  ES_SPSCQueue_t RxISRQueue;
+
+  // RxISR puts the good bytes here, and posts one ES_RX_BYTES per burst of them
+  uint8_t RxByteRing[RX_BYTE_RING_SIZE];
+  ES_Coalescer_t RxCoalescer;
+} RxSMVars_t;
+
+ES_CONTEXT_VARS( RxSMVars_t, RxSM );
+#define pVars ES_CONTEXT( RxSMVars_t, RxSM )
+
+// make sure that a whole packet fits in a payload buffer
+typedef char RxPacketSizeCheck[(ES_PAYLOAD_SIZE >= LONGEST_PACKET_LENGTH) ? 1 : -1];
 
 
 /*------------------------------ Module Code ------------------------------*/
@@ -105,28 +153,38 @@ bool InitRxSM ( uint8_t Priority )
 {
   ES_Event ThisEvent;
 
-  MyPriority = Priority;
+  pVars->MyPriority = Priority;
+  // no payload buffer yet, ClearRxVars gets the first one
+  pVars->RxPacket = ES_NO_PAYLOAD;
+  
+  // the ISR queue must be in place before the receive interrupt is enabled
+  ES_InitSPSCQueue( &pVars->RxISRQueue, pVars->RxISRSlots, RX_ISR_QUEUE_SIZE );
+  ES_AttachISRQueue( pVars->MyPriority, &pVars->RxISRQueue );
+  ES_InitCoalescer( &pVars->RxCoalescer, pVars->MyPriority, ES_RX_BYTES,
+                    pVars->RxByteRing, RX_BYTE_RING_SIZE );
+  // we print the packets that we receive
+  ES_Subscribe( pVars->MyPriority, ES_PACKET_RECEIVED );
 	
+#ifndef ES_PORT_POSIX
 	// call UART Initialization function in another module
     InitUARTS();
     
     //enable interrupts via the UART interrupt mask register
 	HWREG(UART1_BASE + UART_O_IM) |= UART_IM_RXIM;
+#endif
     
     //clear the variables to start
     ClearRxVars();
 	
     // put us into the Initial PseudoState
-    CurrentState = WaitFor0x7E;
+    pVars->CurrentState = WaitFor0x7E;
     
-    #ifdef RxTestPrints
-            printf("\n\rInit to WaitFor0x7E State");
-    #endif
+    ES_LOG_DEBUG( LOG_RX_INIT );
 	
   // post the initial transition event
   ThisEvent.EventType = ES_INIT;
   
-  if (ES_PostToService( MyPriority, ThisEvent) == true)
+  if (ES_PostToService( pVars->MyPriority, ThisEvent) == true)
   {
       return true;
   }else
@@ -154,7 +212,7 @@ bool InitRxSM ( uint8_t Priority )
 ****************************************************************************/
 bool PostRxSM( ES_Event ThisEvent )
 {
-  return ES_PostToService( MyPriority, ThisEvent);
+  return ES_PostToService( pVars->MyPriority, ThisEvent);
 }
 
 /****************************************************************************
@@ -179,23 +237,48 @@ ES_Event RunRxSM( ES_Event ThisEvent )
   ES_Event ReturnEvent;
   ReturnEvent.EventType = ES_NO_EVENT; // assume no errors
   
-  switch ( CurrentState )
+  // a packet that we subscribed to, whatever state we are in
+  if ( ThisEvent.EventType == ES_PACKET_RECEIVED ){
+      #ifdef PrintRecdPacket
+      PrintRxDataPacket( ThisEvent.EventParam );
+      #endif
+      return ReturnEvent;
+  }
+
+  // a burst of bytes from RxISR, run each one through the machine
+  if ( ThisEvent.EventType == ES_RX_BYTES ){
+      return RunRxBytes();
+  }
+
+  // the bytes that came in before a UART error are dealt with before it
+  if ( ThisEvent.EventType == ES_UART_ERROR_FLAG ){
+      ReturnEvent = RunRxBytes();
+      if ( ReturnEvent.EventType != ES_NO_EVENT ){
+          return ReturnEvent;
+      }
+  }
+
+  switch ( pVars->CurrentState )
   {
     case WaitFor0x7E :       // If current state is initial State
         if ( ThisEvent.EventType == ES_0x7E_RECEIVED ) {// only respond to ES_Init
             // Change CurrentState to WaitForMSBLen
-            CurrentState = WaitForMSBLen;
+            pVars->CurrentState = WaitForMSBLen;
             
-            #ifdef RxTestPrints
-            printf("\n\rGood Start Delimiter:   WaitFor0x7E --> WaitForMSBLen State");
-            #endif
+            ES_LOG_DEBUG( LOG_RX_GOOD_START );
           
             // Clear receive variables
             ClearRxVars();
             
-            //place RxDataByte into RxDataPacket and increment RxArrayIndex
-            RxDataPacket[RxArrayIndex] = RxDataByte;
-            RxArrayIndex++;
+            // if every payload buffer is still in use, drop this packet
+            if ( pVars->RxPacket == ES_NO_PAYLOAD ){
+                pVars->CurrentState = WaitFor0x7E;
+                break;
+            }
+            
+            //place the start delimiter into RxDataPacket and increment RxArrayIndex
+            pVars->RxDataPacket[pVars->RxArrayIndex] = ThisEvent.EventParam;
+            pVars->RxArrayIndex++;
           
             // Start Connection Timeout timer
             //ES_Timer_InitTimer(UART_TIMEOUT , CONNECTION_TIMEOUT_PRD);
@@ -212,38 +295,32 @@ ES_Event RunRxSM( ES_Event ThisEvent )
 
             case ES_BYTE_RECEIVED : //If event is a received byte
                 // Set MSB of Length to the value event parameter sent from the ISR
-                FrameLengthMSB = ThisEvent.EventParam;
-                //place RxDataByte into RxDataPacket and increment RxArrayIndex
-                RxDataPacket[RxArrayIndex] = RxDataByte;
-                RxArrayIndex++;
+                pVars->FrameLengthMSB = ThisEvent.EventParam;
+                //place the byte into RxDataPacket and increment RxArrayIndex
+                pVars->RxDataPacket[pVars->RxArrayIndex] = ThisEvent.EventParam;
+                pVars->RxArrayIndex++;
             
                 // Start Connection Timeout timer
                 //ES_Timer_InitTimer(UART_TIMEOUT , CONNECTION_TIMEOUT_PRD);
                 // Change CurrentState to WaitForLSBLen
-                CurrentState = WaitForLSBLen;
+                pVars->CurrentState = WaitForLSBLen;
             
-                #ifdef RxTestPrints
-                printf("\n\rGood MSB:   WaitForMSBLen --> WaitForLSBLen State");
-                #endif
+                ES_LOG_DEBUG( LOG_RX_GOOD_MSB );
             break;
           
             case ES_TIMEOUT : //If EventType of ThisEvent is timeout
                 //Change CurrentState to WaitFor0x7E
-                CurrentState = WaitFor0x7E;
-                #ifdef RxTestPrints
-                printf("\n\rTimeout:    WaitForMSBLen --> WaitFor0x7E State");
-                #endif  
+                pVars->CurrentState = WaitFor0x7E;
+                ES_LOG_DEBUG( LOG_RX_MSB_TIMEOUT );
             break;
                   
             case ES_UART_ERROR_FLAG : //If EventType of ThisEvent is ES_UART_ERROR_FLAG
                 //Change to WaitFor0x7E state
-                CurrentState = WaitFor0x7E;
+                pVars->CurrentState = WaitFor0x7E;
                 //Print error messages based on error type
                 PrintUARTErrors();
                 
-                #ifdef RxTestPrints
-                printf("\n\rUART Error:  WaitForMSB --> WaitFor0x7E State");
-                #endif
+                ES_LOG_DEBUG( LOG_RX_MSB_UART_ERROR );
             break;  //break for EventType switch
         }   //end switch on CurrentEvent
       break;    //break for WaitForMSBLen
@@ -254,146 +331,126 @@ ES_Event RunRxSM( ES_Event ThisEvent )
         
             case ES_BYTE_RECEIVED : //If event is a received byte
                 // Set LSB of Length to the value event parameter sent from the ISR
-                FrameLengthLSB = ThisEvent.EventParam;
-                //place RxDataByte into RxDataPacket and increment RxArrayIndex
-                RxDataPacket[RxArrayIndex] = RxDataByte;
-                RxArrayIndex++;
+                pVars->FrameLengthLSB = ThisEvent.EventParam;
+                //place the byte into RxDataPacket and increment RxArrayIndex
+                pVars->RxDataPacket[pVars->RxArrayIndex] = ThisEvent.EventParam;
+                pVars->RxArrayIndex++;
                 //Combine MSB and LSB into BytesLeft, then calculate a message length variable
-                BytesLeft = 0; 
-                BytesLeft = ( (FrameLengthMSB<<8) | FrameLengthLSB );
-                PacketLength = BytesLeft + NUM_OVERHEAD_BYTES;
+                pVars->BytesLeft = 0; 
+                pVars->BytesLeft = ( (pVars->FrameLengthMSB<<8) | pVars->FrameLengthLSB );
+                pVars->PacketLength = pVars->BytesLeft + NUM_OVERHEAD_BYTES;
+                
+                // a packet too long for the buffer is dropped
+                if ( pVars->BytesLeft > (LONGEST_PACKET_LENGTH - NUM_OVERHEAD_BYTES) ){
+                    pVars->CurrentState = WaitFor0x7E;
+                    break;
+                }
                 
                 // Start Connection Timeout timer
                 //ES_Timer_InitTimer(UART_TIMEOUT , CONNECTION_TIMEOUT_PRD);
             
                 // Change CurrentState to ReadDataPacket
-                CurrentState = ReadDataPacket;
-                #ifdef RxTestPrints
-                printf("\n\rGood LSB:   WaitForLSBLen --> ReadDataPacket State");
-                #endif
+                pVars->CurrentState = ReadDataPacket;
+                ES_LOG_DEBUG( LOG_RX_GOOD_LSB );
             break;
           
             case ES_TIMEOUT : //If EventType of ThisEvent is timeout
                 //Change CurrentState to WaitFor0x7E
-                CurrentState = WaitFor0x7E;
-                #ifdef RxTestPrints
-                printf("\n\rTimeout:  WaitForLSB --> WaitFor0x7E State");
-                #endif
+                pVars->CurrentState = WaitFor0x7E;
+                ES_LOG_DEBUG( LOG_RX_LSB_TIMEOUT );
             break;
                   
             case ES_UART_ERROR_FLAG : //If EventType of ThisEvent is ES_UART_ERROR_FLAG
                 //Change to WaitFor0x7E state
-                CurrentState = WaitFor0x7E;
+                pVars->CurrentState = WaitFor0x7E;
                 //Print error messages based on error type
                 PrintUARTErrors();
-                #ifdef RxTestPrints
-                printf("\n\rUART Error:  WaitForMLSB --> WaitFor0x7E State");
-                #endif
+                ES_LOG_DEBUG( LOG_RX_LSB_UART_ERROR );
                 break;
         }   //end switch on CurrentEvent
         break;  //break for WaitForLSBLen
         
     case ReadDataPacket : //CurrentState is ReadDataPacket
-        #ifdef RxTestPrints
-        printf("\n\rEntered ReadDataPacket");
-        #endif
+        ES_LOG_DEBUG( LOG_RX_READ_ENTERED );
         //If EventType of ThisEvent is Byte Received AND BytesLeft NOT EQUAL to zero
-        if( (ThisEvent.EventType == ES_BYTE_RECEIVED) && (BytesLeft > 0) ){       
-            //place RxDataByte into RxDataPacket
-            RxDataPacket[RxArrayIndex] = RxDataByte;
+        if( (ThisEvent.EventType == ES_BYTE_RECEIVED) && (pVars->BytesLeft > 0) ){       
+            //place the byte into RxDataPacket
+            pVars->RxDataPacket[pVars->RxArrayIndex] = ThisEvent.EventParam;
             
-            #ifdef RxTestPrints
-            printf("    DataByte Read = %i", RxDataPacket[RxArrayIndex]);
-            #endif
+            ES_LOG_DEBUG( LOG_RX_DATA_BYTE, ThisEvent.EventParam );
             
             //Increment RxArray for next position and decrement BytesLeft to get ready for next loop
-            RxArrayIndex++;
-            BytesLeft--;
+            pVars->RxArrayIndex++;
+            pVars->BytesLeft--;
 
-            #ifdef RxTestPrints
-            printf("    BytesLeft = %i",BytesLeft);
-            #endif            
+            ES_LOG_DEBUG( LOG_RX_BYTES_LEFT, pVars->BytesLeft );
             
             // Add DataByte to ChkSum
-            ChkSum = ChkSum + RxDataByte;
+            pVars->ChkSum = pVars->ChkSum + ThisEvent.EventParam;
             
             // Start Connection Timeout timer
             //ES_Timer_InitTimer(UART_TIMEOUT , CONNECTION_TIMEOUT_PRD);
         } 
         
         //If EventType of ThisEvent is Byte Received AND BytesLeft EQUAL to zero
-        else if( (ThisEvent.EventType == ES_BYTE_RECEIVED) && (BytesLeft == 0) ) {
-            //place RxDataByte into RxDataPacket
-            RxDataPacket[RxArrayIndex] = RxDataByte;
+        else if( (ThisEvent.EventType == ES_BYTE_RECEIVED) && (pVars->BytesLeft == 0) ) {
+            //place the checksum byte into RxDataPacket
+            pVars->RxDataPacket[pVars->RxArrayIndex] = ThisEvent.EventParam;
             
-            #ifdef RxTestPrints
-            printf("\n\rRead CheckSum = %i", RxDataPacket[RxArrayIndex]);
-            #endif
+            ES_LOG_DEBUG( LOG_RX_CHECKSUM, ThisEvent.EventParam );
             
             // Pull XbeeChkSum out of the last index of RxDataPacket
-            XbeeChkSum = RxDataPacket[RxArrayIndex];
+            pVars->XbeeChkSum = pVars->RxDataPacket[pVars->RxArrayIndex];
             // Add DataByte to ChkSum
-            ChkSum = ChkSum + RxDataByte;
+            pVars->ChkSum = pVars->ChkSum + ThisEvent.EventParam;
             // Subract running checksum from 0xFF to get the final checksum
-            ChkSum = ALL_BITS_HI - ChkSum;
+            pVars->ChkSum = ALL_BITS_HI - pVars->ChkSum;
             
             //TEST ONLY
-            XbeeChkSum = ChkSum;
+            pVars->XbeeChkSum = pVars->ChkSum;
             
             //If Chksum is bad
-            if ( XbeeChkSum != ChkSum ){
+            if ( pVars->XbeeChkSum != pVars->ChkSum ){
                 //Change states to WaitFor0x7E
-                CurrentState = WaitFor0x7E;
-                #ifdef RxTestPrints
-                printf("\n\rChkSum Mismatch:  ReadDataPacket --> WaitFor0x7E State");
-                #endif
+                pVars->CurrentState = WaitFor0x7E;
+                ES_LOG_DEBUG( LOG_RX_CHECKSUM_MISMATCH );
             }
             //Else if Chksum is good
-            else if ( XbeeChkSum == ChkSum ) {
-                //Post PacketReceived event
-                /***** add post function ****/
+            else if ( pVars->XbeeChkSum == pVars->ChkSum ) {
+                //Publish PacketReceived event to its subscribers, then give up our reference
+                //to the buffer, it is freed when the last of them has run
+                ES_Event PacketEvent;
+                PacketEvent.EventType = ES_PACKET_RECEIVED;
+                PacketEvent.EventParam = pVars->RxPacket;
+                ES_PayloadSetLength( pVars->RxPacket, pVars->PacketLength );
+                ES_Publish( PacketEvent );
+                ES_PayloadRelease( pVars->RxPacket );
+                pVars->RxPacket = ES_NO_PAYLOAD;
                        
                 //change to WaitFor0x7E to wait for next packet
-                CurrentState = WaitFor0x7E;
+                pVars->CurrentState = WaitFor0x7E;
                 
-                #ifdef RxTestPrints
-                printf("\n\rPacket Received");
-                #endif
+                ES_LOG_DEBUG( LOG_RX_PACKET_RECEIVED );
                 
-                #ifdef PrintRecdPacket
-                for (uint8_t i = 0 ; i < PacketLength ; i++)
-                    printf("\n\r%x", RxDataPacket[i]);     
-
-                printf("\n\rEOT*****************\n\n\r");
-                #endif
-                
-                
-                
-                #ifdef RxTestPrints
-                printf("\n\rPacket Complete: Head to WaitFor0x7E State");
-                #endif
+                ES_LOG_DEBUG( LOG_RX_PACKET_COMPLETE );
             }
         }
 
         //If EventType of ThisEvent is Timeout
         else if( ThisEvent.EventType == ES_TIMEOUT){
             //Change states to WaitFor0x7E
-            CurrentState = WaitFor0x7E;
-            #ifdef RxTestPrints
-            printf("\n\rTimeout:  ReadDataPacket --> WaitFor0x7E State");
-            #endif
+            pVars->CurrentState = WaitFor0x7E;
+            ES_LOG_DEBUG( LOG_RX_READ_TIMEOUT );
         }
 
         //If EventType of ThisEvent is ES_UART_ERROR_FLAG
         else if( ThisEvent.EventType == ES_UART_ERROR_FLAG ){
             //Change to WaitFor0x7E state
-            CurrentState = WaitFor0x7E;
+            pVars->CurrentState = WaitFor0x7E;
             //Print error messages based on error type
             PrintUARTErrors();
             
-            #ifdef RxTestPrints
-            printf("\n\rUART Error: ReadDataPacket --> WaitFor0x7E State");
-            #endif
+            ES_LOG_DEBUG( LOG_RX_READ_UART_ERROR );
         }
         
         break;      
@@ -421,7 +478,7 @@ ES_Event RunRxSM( ES_Event ThisEvent )
 ****************************************************************************/
 RxState_t QueryRxSM ( void )
 {
-   return(CurrentState);
+   return(pVars->CurrentState);
 }
 
 /***************************************************************************
@@ -448,13 +505,13 @@ RxState_t QueryRxSM ( void )
 ****************************************************************************/
 void ClearRxVars ( void )
 {     
-  FrameLengthMSB = 0;   //clear frame length variables
-  FrameLengthLSB = 0;
-  PacketLength = 0;
-  ChkSum = 0;           //clear checksums
-  XbeeChkSum = 0;
+  pVars->FrameLengthMSB = 0;   //clear frame length variables
+  pVars->FrameLengthLSB = 0;
+  pVars->PacketLength = 0;
+  pVars->ChkSum = 0;           //clear checksums
+  pVars->XbeeChkSum = 0;
   ClearRxDataPacket();
-  RxArrayIndex = 0;     //clear count of which byte we are workign with in the RxDataPacket array
+  pVars->RxArrayIndex = 0;     //clear count of which byte we are workign with in the RxDataPacket array
     
 }
 
@@ -466,21 +523,113 @@ void ClearRxVars ( void )
      None
 
  Returns
-     Nothing
+     bool, false if there was no payload buffer free for the packet
 
  Description
-     clears out receive data packet for each new packet
+     clears out receive data packet for each new packet, getting a new
+     payload buffer for it if the last one was posted
  Notes
 
  Author
      Drew Bell, 05/12/17, 19:21
 ****************************************************************************/
-void ClearRxDataPacket ( void )
+bool ClearRxDataPacket ( void )
 {
+  if ( pVars->RxPacket == ES_NO_PAYLOAD ){
+      pVars->RxPacket = ES_PayloadAlloc();
+      if ( pVars->RxPacket == ES_NO_PAYLOAD ){
+          return false;
+      }
+      pVars->RxDataPacket = ES_PayloadData( pVars->RxPacket );
+  }
   for(uint8_t i = 0 ; i < LONGEST_PACKET_LENGTH ; i++){
-      RxDataPacket[i] = 0;
+      pVars->RxDataPacket[i] = 0;
   }
- 
+  return true;
+}
+
+/****************************************************************************
+ Function
+     PrintRxDataPacket
+
+ Parameters
+     uint16_t Packet, the payload handle from an ES_PACKET_RECEIVED
+
+ Returns
+     Nothing
+
+ Description
+     prints out a received packet, byte by byte
+ Notes
+     the bytes are logged, and go out over the console after the services
+     have run (see ES_Log.h)
+
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+void PrintRxDataPacket ( uint16_t Packet )
+{
+#if ES_LOG_LEVEL >= ES_LOG_LEVEL_INFO
+  uint8_t *pData = ES_PayloadData( Packet );
+  uint16_t Length = ES_PayloadGetLength( Packet );
+
+  for (uint16_t i = 0 ; i < Length ; i++)
+      ES_LOG_INFO( LOG_RX_PACKET_BYTE, pData[i] );
+#else
+  (void)Packet;     // the byte logs compile out, don't walk the packet for nothing
+#endif
+
+  ES_LOG_INFO( LOG_RX_PACKET_END );
+}
+
+
+/****************************************************************************
+ Function
+     RunRxBytes
+
+ Parameters
+     None
+
+ Returns
+     ES_Event, ES_NO_EVENT if no error ES_ERROR otherwise
+
+ Description
+     takes the bytes that RxISR has coalesced and runs each one through the
+     state machine as the event that RxISR used to post for it: 
+     ES_0x7E_RECEIVED for a start delimiter, ES_BYTE_RECEIVED otherwise,
+     with the byte itself as the EventParam of either
+ Notes
+     keeps going until the coalescer is empty, so an ES_RX_BYTES that
+     arrives afterwards may find nothing to do
+
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+ES_Event RunRxBytes ( void )
+{
+  uint8_t Bytes[RX_TAKE_SIZE];
+  uint16_t NumBytes;
+  uint16_t i;
+  ES_Event ByteEvent;
+  ES_Event ReturnEvent;
+
+  ReturnEvent.EventType = ES_NO_EVENT;
+  while ( (NumBytes = ES_CoalesceTake( &pVars->RxCoalescer, Bytes, RX_TAKE_SIZE )) != 0 ){
+      for ( i = 0 ; i < NumBytes ; i++ ){
+          if ( Bytes[i] == XBEE_START_DELIMITER ){
+              ByteEvent.EventType = ES_0x7E_RECEIVED;
+              ByteEvent.EventParam = XBEE_START_DELIMITER;
+          }else{
+              ByteEvent.EventType = ES_BYTE_RECEIVED;
+              ByteEvent.EventParam = Bytes[i];
+          }
+          ReturnEvent = RunRxSM( ByteEvent );
+          if ( ReturnEvent.EventType != ES_NO_EVENT ){
+              return ReturnEvent;
+          }
+      }
+  }
+  return ReturnEvent;
 }
 
 
@@ -505,34 +654,34 @@ void PrintUARTErrors ( void )
 {
  
   //If overRun error bit is set, print overrun error msg
-  if (OverRunBit) 
+  if (pVars->OverRunBit) 
   {
-      printf("\n\rOverRun Error in UART Rx : Connection Lost");
+      ES_LOG_ERROR( LOG_RX_OVERRUN_ERROR );
   }
   
   // if break error bit is set, print break error msg
-  if (BreakErrorBit) 
+  if (pVars->BreakErrorBit) 
   {
-      printf("\n\rBreak Error in UART Rx : Connection Lost");
+      ES_LOG_ERROR( LOG_RX_BREAK_ERROR );
 	}
   
   // if parity error bit is set, print parity error msg
-  if (ParityErrorBit)  
+  if (pVars->ParityErrorBit)  
   {
-		  printf("\n\rParity Error in UART Rx : Connection Lost");
+		  ES_LOG_ERROR( LOG_RX_PARITY_ERROR );
   }
   
   // if framing error bit is set, print framing error msg
-  if (FramingErrorBit)	
+  if (pVars->FramingErrorBit)	
   {
-      printf("\n\rFraming Error in UART Rx : Connection Lost");
+      ES_LOG_ERROR( LOG_RX_FRAMING_ERROR );
   }
   
   //clear error bits
-    OverRunBit = 0;
-    BreakErrorBit = 0; 
-    ParityErrorBit = 0; 
-    FramingErrorBit = 0; 
+    pVars->OverRunBit = 0;
+    pVars->BreakErrorBit = 0; 
+    pVars->ParityErrorBit = 0; 
+    pVars->FramingErrorBit = 0; 
 
 return;
 
@@ -542,6 +691,7 @@ return;
 /***************************************************************************
  Xbee UART Receive Interrupt Service Routine
  ***************************************************************************/
+#ifndef ES_PORT_POSIX
 
 void RxISR (void)
 {
@@ -549,57 +699,114 @@ void RxISR (void)
     first check if there is a valid receive interrupt */
     
   //poll the Rx interrupt 
-  RxInterruptBit = (HWREG(UART1_BASE + UART_O_MIS) & UART_MIS_RXMIS);
+  pVars->RxInterruptBit = (HWREG(UART1_BASE + UART_O_MIS) & UART_MIS_RXMIS);
   
   //If receive interrupt flag is set in RXMIS in UARTMIS
-   if (RxInterruptBit){
+   if (pVars->RxInterruptBit){
        
        //Clear the source of the interrupt in UARTICR
        HWREG(UART1_BASE + UART_O_ICR) |= UART_ICR_RXIC;
        //Clear the RxInterruptBit 
-       RxInterruptBit = 0; 
+       pVars->RxInterruptBit = 0; 
        //Read the data in UARTDR into NewRxByte
-       RxDataByte = ( HWREG(UART1_BASE + UART_O_DR) );       
+       pVars->RxDataByte = ( HWREG(UART1_BASE + UART_O_DR) );       
        //Read OverRun bit in UARTDR into OverRunBit
-       OverRunBit = ( HWREG(UART1_BASE + UART_O_RSR) & UART_RSR_OE );
+       pVars->OverRunBit = ( HWREG(UART1_BASE + UART_O_RSR) & UART_RSR_OE );
        //Read BreakError bit in UARTDR into BreakErrorBit
-       BreakErrorBit = ( HWREG(UART1_BASE + UART_O_RSR) & UART_RSR_BE );
+       pVars->BreakErrorBit = ( HWREG(UART1_BASE + UART_O_RSR) & UART_RSR_BE );
        //Read ParityError bit in UARTDR into ParityErrorBit
-       ParityErrorBit = ( HWREG(UART1_BASE + UART_O_RSR) & UART_RSR_PE );
+       pVars->ParityErrorBit = ( HWREG(UART1_BASE + UART_O_RSR) & UART_RSR_PE );
        //Read FramingError bit in UARTDR into FramingErrorBit
-       FramingErrorBit = ( HWREG(UART1_BASE + UART_O_RSR) & UART_RSR_FE );
+       pVars->FramingErrorBit = ( HWREG(UART1_BASE + UART_O_RSR) & UART_RSR_FE );
 
        //If OverRunFlag OR BreakErrorFlag OR ParityErrorFlag OR FramingError is true 
-       if ( OverRunBit | BreakErrorBit | ParityErrorBit | FramingErrorBit) {
+       if ( pVars->OverRunBit | pVars->BreakErrorBit | pVars->ParityErrorBit | pVars->FramingErrorBit) {
            //Write to UARTECR register to clear error flags 
            HWREG(UART1_BASE + UART_O_ECR) |= UART_ECR_DATA_M; 
            //Post ES_UART_ERROR_FLAG event to RxSM
            ES_Event ThisEvent;
            ThisEvent.EventType = ES_UART_ERROR_FLAG; 
-           PostRxSM(ThisEvent); 
+           ES_PostToServiceISR( pVars->MyPriority, ThisEvent ); 
        }
        //Else (if data is good)
        else {
-            //If btye is 0x7E
-            if ( RxDataByte == XBEE_START_DELIMITER){
-                //Create new event called ThisEvent
-                ES_Event ThisEvent;
-                //Set EventType to be NewStartByte 
-                ThisEvent.EventType = ES_0x7E_RECEIVED;
-                //Post ThisEvent to RxSM
-                PostRxSM(ThisEvent);
-            }
-            //Else the next byte is a data byte
-            else {
-                //Create new event called ThisEvent
-                ES_Event ThisEvent;
-                //Set EventType to be NewDataByte and EventParam to be the new byte received
-                ThisEvent.EventType = ES_BYTE_RECEIVED;
-                ThisEvent.EventParam = RxDataByte;
-                //Post ThisEvent to RxSM
-                PostRxSM(ThisEvent);
-            }
+            //Hand the byte to the coalescer, which only posts ES_RX_BYTES to RxSM
+            //if there is not one already waiting. RunRxBytes sorts out the 0x7Es.
+            ES_CoalescePostISR( &pVars->RxCoalescer, pVars->RxDataByte );
         }
     }
 }
+#endif /* ES_PORT_POSIX */
+
+#ifdef TEST
+/* test harness for the packet assembly, runs on the host. With TEST defined
+   at the top of this file:
+   gcc -std=gnu99 -O2 -DES_PORT_POSIX -IHeaders Source/RxSM.c
+       Source/ES_Framework.c Source/ES_Port_POSIX.c Source/ES_Queue.c
+       Source/ES_Timers.c Source/ES_LookupTables.c Source/ES_PostList.c
+       Source/ES_CheckEvents.c Source/ES_DeferRecall.c Source/ES_Profile.c
+       Source/ES_Payload.c Source/ES_Pool.c Source/ES_Coalesce.c
+       Source/ES_Trace.c Source/ES_Log.c Source/ES_Threads_POSIX.c
+       Source/EventCheckers.c Source/MapKeys.c -lpthread -o rx_test
+   Hands a frame to the coalescer a byte at a time, as RxISR does, runs the
+   ES_RX_BYTES through RxSM and checks that the payload it publishes holds
+   the frame byte for byte. The start delimiter goes in a burst of its own,
+   so that the payload handle can be picked up before the packet is done.
+*/
+#include <stdio.h>
+
+static uint8_t const TestFrame[] = {
+    XBEE_START_DELIMITER, 0x00, 0x05,       // start, length MSB & LSB
+    0x81, 0x00, 0x7D, 0x11, 0xFE,           // frame data
+    0x54                                    // checksum, 0xFF - the data
+};
+
+// gives RxSM the bytes From up to To, the way RxISR would
+static void FeedBytes( uint16_t From, uint16_t To )
+{
+   ES_Event ThisEvent;
+   uint16_t i;
+
+   for (i = From; i < To; i++)
+   {
+      ES_CoalescePostISR( &pVars->RxCoalescer, TestFrame[i] );
+   }
+   ThisEvent.EventType = ES_RX_BYTES;
+   ThisEvent.EventParam = 0;
+   RunRxSM( ThisEvent );
+}
 
+int main(void)
+{
+   uint16_t Packet;
+   uint8_t *pData;
+   uint16_t Length;
+   uint16_t NumWrong = 0;
+   uint16_t i;
+
+   if (ES_Initialize(ES_Timer_RATE_1mS) != Success)
+   {
+      printf("ES_Initialize failed\n");
+      return 1;
+   }
+   FeedBytes( 0, 1 );
+   Packet = pVars->RxPacket;
+   FeedBytes( 1, sizeof(TestFrame) );
+
+   pData = ES_PayloadData( Packet );
+   Length = ES_PayloadGetLength( Packet );
+   for (i = 0; (i < Length) && (i < sizeof(TestFrame)); i++)
+   {
+      if (pData[i] != TestFrame[i])
+      {
+         printf("byte %u is 0x%02x, sent 0x%02x\n", i, pData[i], TestFrame[i]);
+         NumWrong++;
+      }
+   }
+   printf("packet of %u bytes, %u sent, %u wrong, %s\n", Length,
+          (unsigned)sizeof(TestFrame), NumWrong,
+          (QueryRxSM() == WaitFor0x7E) ? "back in WaitFor0x7E" : "not done");
+   return !((Length == sizeof(TestFrame)) && (NumWrong == 0) &&
+            (QueryRxSM() == WaitFor0x7E) && (pVars->RxPacket == ES_NO_PAYLOAD));
+}
+#endif
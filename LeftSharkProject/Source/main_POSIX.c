@@ -0,0 +1,134 @@
+/****************************************************************************
+ Module
+   main_POSIX.c
+
+ Description
+   main() for the Linux host build of the Events & Services framework. This
+   takes the place of main.c, which sets up the Tiva clocks and console.
+
+ Notes
+   see ES_Port_POSIX.c for how to build the host image
+
+   With LATENCY_TEST defined, a simulated interrupt posts to the highest
+   priority service every LATENCY_PERIOD_US, and every LATENCY_LOAD_EVERY'th
+   one also publishes a full length packet, which RxSM (the lowest) takes a
+   long time to print. Build it with ES_ENABLE_PROFILING, with and without
+   ES_ENABLE_PREEMPTION, and send stdout to a file: the QueueWait max of the
+   highest priority service in the report printed at the end is the worst
+   case dispatch latency. It stops after LATENCY_NUM_INTS interrupts.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/17/26 20:30 afb     not for ES_ENABLE_SIM builds either
+ 10/17/26 20:00 afb     not for ES_ENABLE_NODES builds
+ 10/17/26 19:00 afb     added the LATENCY_TEST load
+ 10/17/26 09:40 afb     first pass
+****************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "ES_Configure.h"
+#include "ES_Framework.h"
+#include "ES_Port.h"
+
+#ifdef ES_ENABLE_NODES
+#error a build with ES_ENABLE_NODES steps its nodes from a main of its own, see ES_Nodes_POSIX.c
+#endif
+#ifdef ES_ENABLE_SIM
+#error a build with ES_ENABLE_SIM runs its simulation from a main of its own, see ES_Sim_POSIX.c
+#endif
+
+//#define LATENCY_TEST
+
+#ifdef LATENCY_TEST
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include "ES_Payload.h"
+#include "ES_Profile.h"
+
+#define LATENCY_PERIOD_US     250
+#define LATENCY_LOAD_EVERY    4
+#define LATENCY_NUM_INTS      20000
+#define LATENCY_PACKET_LENGTH 0x96
+
+static void LatencyISR(void);
+#endif
+
+int main(void)
+{
+  ES_Return_t ErrorType;
+
+  // stdout is usually a pipe when load testing, don't let it hold output back
+  setvbuf(stdout, NULL, _IONBF, 0);
+
+  puts("Starting Team LeftShark Rx on the POSIX host port of");
+  printf("the 2nd Generation Events & Services Framework V2.2\n");
+  printf("%s %s\n", __TIME__, __DATE__);
+  printf("Type keys followed by <enter> to post key-stroke events\n");
+
+  // now initialize the Events and Services Framework and start it running
+  ErrorType = ES_Initialize(ES_Timer_RATE_1mS);
+  if ( ErrorType == Success ) {
+
+#ifdef LATENCY_TEST
+#ifdef ES_ENABLE_PROFILING
+    atexit(ES_Profile_Print);
+#endif
+    _HW_SimInterruptStart(LATENCY_PERIOD_US, LatencyISR);
+#endif
+    ErrorType = ES_Run();
+
+  }
+  //if we got to here, there was an error
+  switch (ErrorType){
+    case FailedPost:
+      printf("Failed on attempt to Post\n");
+      break;
+    case FailedPointer:
+      printf("Failed on NULL pointer\n");
+      break;
+    case FailedInit:
+      printf("Failed Initialization\n");
+      break;
+    default:
+      printf("Other Failure\n");
+      break;
+  }
+  return (int)ErrorType;
+}
+
+#ifdef LATENCY_TEST
+// the simulated interrupt response for LATENCY_TEST. MapKeys ignores the
+// ES_NO_EVENT, only the time that it took to get there matters.
+static void LatencyISR(void)
+{
+  static uint32_t NumInts;
+  ES_Event ThisEvent;
+  uint16_t Packet;
+
+  ThisEvent.EventType = ES_NO_EVENT;
+  ThisEvent.EventParam = 0;
+  ES_PostToService(NUM_SERVICES - 1, ThisEvent);
+
+  if ((++NumInts % LATENCY_LOAD_EVERY) == 0)
+  {
+    Packet = ES_PayloadAlloc();
+    if (Packet != ES_NO_PAYLOAD)
+    {
+      memset(ES_PayloadData(Packet), 0xA5, LATENCY_PACKET_LENGTH);
+      ES_PayloadSetLength(Packet, LATENCY_PACKET_LENGTH);
+      ThisEvent.EventType = ES_PACKET_RECEIVED;
+      ThisEvent.EventParam = Packet;
+      ES_Publish(ThisEvent);
+      ES_PayloadRelease(Packet);
+    }
+  }
+  if (NumInts == LATENCY_NUM_INTS)
+  {
+    raise(SIGTERM); // the port prints its report and exits
+  }
+}
+#endif
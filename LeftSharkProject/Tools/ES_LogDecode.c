@@ -0,0 +1,157 @@
+/****************************************************************************
+ Module
+     ES_LogDecode.c
+
+ Description
+     Linux tool that turns the binary frames of the deferred log (ES_Log.h)
+     back into text, passing the rest of the console output through as it is.
+
+ Notes
+     Build it on the host from the LeftSharkProject directory, against the
+     same ES_Configure.h as the firmware, since that holds the formats:
+         cc -IHeaders -o es_log_decode Tools/ES_LogDecode.c
+     and run it on a capture, or on the console as it comes, - for stdin:
+         ./es_log_decode /dev/ttyACM0
+         ./es_host | ./es_log_decode -
+
+     Each frame is printed with printf and the format of its message, so
+     the text is what the printf that the log statement replaced made.
+     A trace dump (ES_Trace.h) in the same capture is not text and comes
+     out garbled here, ES_TraceDecode.c reads those.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/17/26 21:30 afb      Began Coding
+****************************************************************************/
+
+/*----------------------------- Include Files -----------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include "ES_Configure.h"
+#include "ES_Log.h"
+
+/*----------------------------- Module Defines ----------------------------*/
+#define MAX_ARG_BYTES 5   // 7 bits a byte, for 32 bits
+
+/*---------------------------- Module Functions ---------------------------*/
+static void DecodeFrame( FILE * pIn );
+static bool GetArg( FILE * pIn, uint32_t * pArg );
+
+/*---------------------------- Module Variables ---------------------------*/
+// the formats, by message number
+#define ES_LOG_FORMAT( Name, Format ) Format,
+
+static char const * const Formats[ES_NUM_LOG_MESSAGES] = {
+  LOG_MESSAGE_LIST(ES_LOG_FORMAT)
+};
+
+/*------------------------------ Module Code ------------------------------*/
+int main( int argc, char * argv[] ){
+  FILE * pIn = stdin;
+  int Byte;
+
+  if ( argc != 2 ){
+    fprintf(stderr, "usage: %s capture | -\n", argv[0]);
+    return 2;
+  }
+  if ( strcmp(argv[1], "-") != 0 ){
+    pIn = fopen(argv[1], "rb");
+    if ( pIn == NULL ){
+      perror(argv[1]);
+      return 1;
+    }
+  }
+  while ( (Byte = getc(pIn)) != EOF ){
+    if ( Byte == ES_LOG_FRAME_START ){
+      DecodeFrame(pIn);
+      fflush(stdout);
+    }else{
+      putchar(Byte);
+    }
+  }
+  if ( pIn != stdin ){
+    fclose(pIn);
+  }
+  return 0;
+}
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+
+/****************************************************************************
+ Function
+     DecodeFrame
+ Parameters
+     FILE * pIn, the console, just after the ES_LOG_FRAME_START
+ Returns
+     nothing
+ Description
+     reads the rest of a frame and prints the text of its message
+ Notes
+     the formats take fewer arguments than are passed, which printf allows
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+static void DecodeFrame( FILE * pIn ){
+  uint32_t Args[ES_LOG_MAX_ARGS] = { 0 };
+  int Message = getc(pIn);
+  int NumArgs = getc(pIn);
+  int i;
+
+  if ( ( Message == EOF ) || ( NumArgs == EOF ) ){
+    return;
+  }
+  if ( NumArgs > ES_LOG_MAX_ARGS ){
+    printf("[bad log frame]");
+    return;
+  }
+  for ( i = 0; i < NumArgs; i++ ){
+    if ( GetArg(pIn, &Args[i]) != true ){
+      printf("[bad log frame]");
+      return;
+    }
+  }
+  if ( Message == ES_LOG_LOST_MESSAGES ){
+    printf("\n\r[%u log messages lost]", (unsigned)Args[0]);
+  }else if ( Message < ES_NUM_LOG_MESSAGES ){
+    printf(Formats[Message], Args[0], Args[1], Args[2], Args[3]);
+  }else{
+    printf("[log message %d]", Message);
+  }
+}
+
+/****************************************************************************
+ Function
+     GetArg
+ Parameters
+     FILE * pIn, the console
+     uint32_t * pArg, where to put the argument
+ Returns
+     bool, false if the input ended or the argument was too long
+ Description
+     reads an unsigned LEB128 argument
+ Notes
+
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+static bool GetArg( FILE * pIn, uint32_t * pArg ){
+  uint32_t Arg = 0;
+  int Byte;
+  int i;
+
+  for ( i = 0; i < MAX_ARG_BYTES; i++ ){
+    Byte = getc(pIn);
+    if ( Byte == EOF ){
+      return false;
+    }
+    Arg |= (uint32_t)( Byte & 0x7F ) << ( 7 * i );
+    if ( ( Byte & 0x80 ) == 0 ){
+      *pArg = Arg;
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,386 @@
+/****************************************************************************
+ Module
+     ES_TraceDecode.c
+
+ Description
+     Linux tool that turns a console capture holding ES_TraceDump output
+     into a timeline of the posts, dispatches and timeouts in it.
+
+ Notes
+     Build it on the host from the LeftSharkProject directory, against the
+     same ES_Configure.h as the firmware, so that it knows the services:
+         cc -DES_PORT_POSIX -IHeaders -o es_trace_decode Tools/ES_TraceDecode.c
+     and run it on the capture, a file or - for stdin:
+         ./es_trace_decode [-c Headers/ES_Configure.h] capture.bin
+     The event names are read from the ES_EventTyp_t enum in the
+     ES_Configure.h given with -c (Headers/ES_Configure.h by default). If it
+     can not be read the events are shown by number.
+
+     The capture may hold console text around the dumps, and more than one
+     dump. Each is found by its "ESTRACE1" and decoded from the oldest
+     record to the newest. The times are from the first record of the dump,
+     and start again at 0 after each reset, since the cycle counter does.
+     A slot whose Seq does not match was overwritten while the dump was
+     being taken, and is left out.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/17/26 21:00 afb      Began Coding
+****************************************************************************/
+
+/*----------------------------- Include Files -----------------------------*/
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ES_Configure.h"
+#include "ES_Trace.h"
+
+/*----------------------------- Module Defines ----------------------------*/
+#define HEADER_LEN ( ES_TRACE_SYNC_LEN + 3 * 4 )
+#define RECORD_LEN 12
+#define MAX_RING_SIZE 65536UL
+#define MAX_EVENT_NAMES 256
+#define MAX_NAME_LEN 48
+#define DEFAULT_CONFIGURE_H "Headers/ES_Configure.h"
+
+/*---------------------------- Module Functions ---------------------------*/
+static unsigned char * ReadAll( char const * pPath, size_t * pLen );
+static void LoadEventNames( char const * pPath );
+static size_t DecodeDump( unsigned char const * pDump, size_t Len );
+static void PrintRecord( double Us, double DeltaUs,
+                         ES_TraceRecord_t const * pRecord );
+static uint16_t GetWord16( unsigned char const * p );
+static uint32_t GetWord32( unsigned char const * p );
+
+/*---------------------------- Module Variables ---------------------------*/
+// the run function names, less "Run", for the service column
+#define ES_SERV_NAME( Init, Run, QueueSize, BurstLimit, RunBatch ) #Run,
+
+static char const * const ServiceNames[NUM_SERVICES] = {
+  SERVICE_LIST(ES_SERV_NAME)
+};
+
+static char const * const KindNames[] = {
+  "RESET", "POST", "POST FAILED", "DISPATCH", "TIMEOUT"
+};
+
+static char EventNames[MAX_EVENT_NAMES][MAX_NAME_LEN];
+
+/*------------------------------ Module Code ------------------------------*/
+int main( int argc, char * argv[] ){
+  char const * pConfigure = DEFAULT_CONFIGURE_H;
+  char const * pCapture = NULL;
+  unsigned char * pData;
+  size_t Len;
+  size_t i;
+  int NumDumps = 0;
+  int Arg;
+
+  for ( Arg = 1; Arg < argc; Arg++ ){
+    if ( ( strcmp(argv[Arg], "-c") == 0 ) && ( Arg + 1 < argc ) ){
+      pConfigure = argv[++Arg];
+    }else if ( pCapture == NULL ){
+      pCapture = argv[Arg];
+    }else{
+      pCapture = NULL;
+      break;
+    }
+  }
+  if ( pCapture == NULL ){
+    fprintf(stderr, "usage: %s [-c ES_Configure.h] capture | -\n", argv[0]);
+    return 2;
+  }
+  pData = ReadAll(pCapture, &Len);
+  if ( pData == NULL ){
+    perror(pCapture);
+    return 1;
+  }
+  LoadEventNames(pConfigure);
+
+  for ( i = 0; i + HEADER_LEN <= Len; i++ ){
+    if ( memcmp(&pData[i], ES_TRACE_SYNC, ES_TRACE_SYNC_LEN) == 0 ){
+      size_t Used = DecodeDump(&pData[i], Len - i);
+      if ( Used != 0 ){
+        NumDumps++;
+        i += Used - 1;
+      }
+    }
+  }
+  free(pData);
+  if ( NumDumps == 0 ){
+    fprintf(stderr, "%s: no trace dump found\n", pCapture);
+    return 1;
+  }
+  return 0;
+}
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+
+/****************************************************************************
+ Function
+     ReadAll
+ Parameters
+     char const * pPath, the file to read, - for stdin
+     size_t * pLen, where to put its length
+ Returns
+     unsigned char *, the contents (free it), NULL if it could not be read
+ Description
+     reads a whole capture into memory
+ Notes
+
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+static unsigned char * ReadAll( char const * pPath, size_t * pLen ){
+  FILE * pFile = stdin;
+  unsigned char * pData = NULL;
+  size_t Size = 0;
+  size_t Len = 0;
+  size_t Got;
+
+  if ( strcmp(pPath, "-") != 0 ){
+    pFile = fopen(pPath, "rb");
+    if ( pFile == NULL ){
+      return NULL;
+    }
+  }
+  do {
+    if ( Len == Size ){
+      unsigned char * pBigger;
+      Size = ( Size == 0 ) ? 65536 : 2 * Size;
+      pBigger = realloc(pData, Size);
+      if ( pBigger == NULL ){
+        free(pData);
+        pData = NULL;
+        break;
+      }
+      pData = pBigger;
+    }
+    Got = fread(&pData[Len], 1, Size - Len, pFile);
+    Len += Got;
+  }while ( Got != 0 );
+  if ( pFile != stdin ){
+    fclose(pFile);
+  }
+  *pLen = Len;
+  return pData;
+}
+
+/****************************************************************************
+ Function
+     LoadEventNames
+ Parameters
+     char const * pPath, the ES_Configure.h to read the event names from
+ Returns
+     nothing
+ Description
+     fills EventNames from the ES_EventTyp_t enum in the file
+ Notes
+     only as much of C as that enum uses: comments, names and = values
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+static void LoadEventNames( char const * pPath ){
+  size_t Len;
+  char * pText = (char *)ReadAll(pPath, &Len);
+  char * pStart;
+  char * pEnd;
+  char * p;
+  long Value = 0;
+
+  if ( pText == NULL ){
+    return;
+  }
+  pText = realloc(pText, Len + 1);
+  pText[Len] = '\0';
+  // blank out the comments, so that they can not hold a , or a }
+  for ( p = pText; *p != '\0'; p++ ){
+    if ( ( p[0] == '/' ) && ( p[1] == '*' ) ){
+      for ( ; ( *p != '\0' ) && !( ( p[0] == '*' ) && ( p[1] == '/' ) ); p++ ){
+        *p = ' ';
+      }
+      if ( *p != '\0' ){
+        p[0] = p[1] = ' ';
+      }
+    }else if ( ( p[0] == '/' ) && ( p[1] == '/' ) ){
+      for ( ; ( *p != '\0' ) && ( *p != '\n' ); p++ ){
+        *p = ' ';
+      }
+    }
+    if ( *p == '\0' ){
+      break;
+    }
+  }
+  pStart = strstr(pText, "ES_NO_EVENT");
+  pEnd = ( pStart != NULL ) ? strchr(pStart, '}') : NULL;
+  if ( pEnd == NULL ){
+    free(pText);
+    return;
+  }
+  *pEnd = '\0';
+  for ( p = strtok(pStart, ","); p != NULL; p = strtok(NULL, ",") ){
+    char * pName = p;
+    char * pEquals;
+    size_t NameLen;
+
+    while ( isspace((unsigned char)*pName) ){
+      pName++;
+    }
+    for ( NameLen = 0; isalnum((unsigned char)pName[NameLen]) ||
+                       ( pName[NameLen] == '_' ); NameLen++ ){
+    }
+    if ( NameLen == 0 ){
+      continue;
+    }
+    pEquals = strchr(pName, '=');
+    if ( pEquals != NULL ){
+      Value = strtol(pEquals + 1, NULL, 0);
+    }
+    if ( ( Value >= 0 ) && ( Value < MAX_EVENT_NAMES ) ){
+      if ( NameLen >= MAX_NAME_LEN ){
+        NameLen = MAX_NAME_LEN - 1;
+      }
+      memcpy(EventNames[Value], pName, NameLen);
+      EventNames[Value][NameLen] = '\0';
+    }
+    Value++;
+  }
+  free(pText);
+}
+
+/****************************************************************************
+ Function
+     DecodeDump
+ Parameters
+     unsigned char const * pDump, the dump, from its "ESTRACE1"
+     size_t Len, the bytes of the capture from there on
+ Returns
+     size_t, the length of the dump, 0 if it is not a whole dump
+ Description
+     prints the records of one dump, oldest first
+ Notes
+
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+static size_t DecodeDump( unsigned char const * pDump, size_t Len ){
+  uint32_t Size = GetWord32(&pDump[ES_TRACE_SYNC_LEN]);
+  uint32_t Head = GetWord32(&pDump[ES_TRACE_SYNC_LEN + 4]);
+  uint32_t ClockHz = GetWord32(&pDump[ES_TRACE_SYNC_LEN + 8]);
+  uint32_t First;
+  uint32_t RecordNum;
+  uint32_t NumSkipped = 0;
+  uint32_t LastStamp = 0;
+  double Us = 0.0;
+  bool Started = false;
+
+  if ( ( Size == 0 ) || ( Size > MAX_RING_SIZE ) ||
+       ( ( Size & ( Size - 1 ) ) != 0 ) || ( ClockHz == 0 ) ||
+       ( Len < HEADER_LEN + (size_t)Size * RECORD_LEN ) ){
+    return 0;
+  }
+  First = ( Head > Size ) ? Head - Size : 0;
+  printf("trace of %u records (%u written), %u Hz clock\n",
+         (unsigned)( Head - First ), (unsigned)Head, (unsigned)ClockHz);
+  printf("%14s %12s  %-11s %-12s %-20s %s\n", "time (us)", "+us", "what",
+         "service", "event", "param");
+
+  for ( RecordNum = First; RecordNum != Head; RecordNum++ ){
+    unsigned char const * p = &pDump[HEADER_LEN +
+                              ( RecordNum & ( Size - 1 ) ) * RECORD_LEN];
+    ES_TraceRecord_t Record;
+    double DeltaUs;
+
+    Record.Stamp = GetWord32(&p[0]);
+    Record.EventType = GetWord16(&p[4]);
+    Record.EventParam = GetWord16(&p[6]);
+    Record.Seq = GetWord16(&p[8]);
+    Record.Service = p[10];
+    Record.Kind = p[11];
+    if ( Record.Seq != (uint16_t)RecordNum ){
+      NumSkipped++;
+      continue;
+    }
+    if ( Record.Kind == ES_TRACE_RESET ){
+      printf("---------------- reset ----------------\n");
+      Started = false;
+      Us = 0.0;
+    }
+    // the counter wraps, but never between two records that are close
+    DeltaUs = Started ? (uint32_t)( Record.Stamp - LastStamp ) * 1e6 / ClockHz
+                      : 0.0;
+    Us += DeltaUs;
+    LastStamp = Record.Stamp;
+    Started = true;
+    PrintRecord(Us, DeltaUs, &Record);
+  }
+  if ( NumSkipped != 0 ){
+    printf("(%u records were overwritten during the dump)\n",
+           (unsigned)NumSkipped);
+  }
+  printf("\n");
+  return HEADER_LEN + (size_t)Size * RECORD_LEN;
+}
+
+/****************************************************************************
+ Function
+     PrintRecord
+ Parameters
+     double Us, time since the first record (or the reset)
+     double DeltaUs, time since the record before
+     ES_TraceRecord_t const * pRecord, what to print
+ Returns
+     nothing
+ Description
+     prints one line of the timeline
+ Notes
+
+ Author
+     Drew Bell, 10/17/26
+****************************************************************************/
+static void PrintRecord( double Us, double DeltaUs,
+                         ES_TraceRecord_t const * pRecord ){
+  char Service[MAX_NAME_LEN];
+  char Event[MAX_NAME_LEN];
+  char const * pKind = "?";
+
+  if ( pRecord->Kind < ( sizeof(KindNames) / sizeof(KindNames[0]) ) ){
+    pKind = KindNames[pRecord->Kind];
+  }
+  if ( pRecord->Kind == ES_TRACE_TIMEOUT ){
+    snprintf(Service, sizeof(Service), "timer %u", pRecord->Service);
+  }else if ( pRecord->Service < NUM_SERVICES ){
+    char const * pName = ServiceNames[pRecord->Service];
+    if ( strncmp(pName, "Run", 3) == 0 ){
+      pName += 3;
+    }
+    snprintf(Service, sizeof(Service), "%s", pName);
+  }else{
+    snprintf(Service, sizeof(Service), "service %u", pRecord->Service);
+  }
+  if ( ( pRecord->EventType < MAX_EVENT_NAMES ) &&
+       ( EventNames[pRecord->EventType][0] != '\0' ) ){
+    snprintf(Event, sizeof(Event), "%s", EventNames[pRecord->EventType]);
+  }else{
+    snprintf(Event, sizeof(Event), "%u", pRecord->EventType);
+  }
+  if ( pRecord->Kind == ES_TRACE_RESET ){
+    printf("%14.3f %12.3f  %s\n", Us, DeltaUs, pKind);
+    return;
+  }
+  printf("%14.3f %12.3f  %-11s %-12s %-20s 0x%04X\n", Us, DeltaUs, pKind,
+         Service, Event, pRecord->EventParam);
+}
+
+// the dump is little endian
+static uint16_t GetWord16( unsigned char const * p ){
+  return (uint16_t)( p[0] | ( p[1] << 8 ) );
+}
+
+static uint32_t GetWord32( unsigned char const * p ){
+  return (uint32_t)GetWord16(p) | ( (uint32_t)GetWord16(&p[2]) << 16 );
+}